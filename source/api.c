@@ -4,20 +4,82 @@
 
 #include "api.h"
 #include "log.h"
+#include "transport.h"
+#include "jsonstream.h"
+#include "arena.h"
+#include "jsonfields.h"
+#include "partfile.h"
+#include "md5.h"
+#include "chunkring.h"
+#include "thread.h"
+#include "storage.h"
+#include "ratelimit.h"
+#include "bodydecoder.h"
+#include "auth.h"
+#include "retry.h"
+#include "watchdog.h"
+#include "filesink.h"
+#include "reachability.h"
+#include "respcache.h"
+#include "coalesce.h"
 #include "cJSON/cJSON.h"
+#include <stdatomic.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <errno.h>
 #include <time.h>
-#include <3ds.h>
 
 #define MAX_URL_LEN 1024
-#define MAX_RESPONSE_SIZE (512 * 1024) // 512KB max response
-#define TRACE_BODY_PREVIEW_LEN 500     // Max chars to show for response body
+#define RESPONSE_INITIAL_SIZE (16 * 1024)           // First allocation when Content-Length is unknown
+#define DEFAULT_MAX_RESPONSE_SIZE (8 * 1024 * 1024) // Hard cap for a single JSON response
+#define TRACE_BODY_PREVIEW_LEN 500                  // Max chars to show for response body
+#define STREAM_CHUNK_SIZE (16 * 1024)               // Read size when stream-parsing a response
+#define ROM_PAGE_INITIAL_CAPACITY 64                // Rom array size when the page limit is unknown
+#define JSON_ARENA_CHUNK_SIZE (64 * 1024)           // cJSON arena grows in chunks of this size
+#define DOWNLOAD_CHUNK_SIZE (64 * 1024)             // Default read size for ROM downloads
+#define DOWNLOAD_RING_DEPTH 4                       // Default buffers between the network reader and file writer
+#define MAX_DOWNLOAD_RING_DEPTH 16                  // Upper bound for api_set_download_buffers()
+#define MIN_DOWNLOAD_CHUNK_SIZE (4 * 1024)
+#define MAX_DOWNLOAD_CHUNK_SIZE (1024 * 1024)
+#define WRITER_STACK_SIZE (16 * 1024)
+#define PART_SYNC_INTERVAL (1024 * 1024)            // Flush and record resume state this often while downloading
+#define MAX_DOWNLOAD_SEGMENTS 8                     // Upper bound for api_set_download_segments()
+#define SEGMENT_MIN_SIZE (1024 * 1024)              // Don't split a download into ranges smaller than this
+#define SEGMENT_POLL_MS 50                          // Progress polling interval during segmented downloads
+#define DEFAULT_MAX_CONNECTIONS 4                   // Download connections open to the server at once
+#define MAX_CONNECTIONS 16                          // Upper bound for api_set_max_connections()
+#define CONNECTION_WAIT_MS 100                      // Cancel polling interval while waiting for a connection
+#define DEFAULT_DOWNLOAD_RETRIES 6
+#define MAX_DOWNLOAD_RETRIES 20                     // Upper bound for api_set_download_retries()
 
 static char baseUrl[256] = "";
-static char authHeader[512] = "";
+static size_t maxResponseSize = DEFAULT_MAX_RESPONSE_SIZE;
+static int downloadSegments = 1;
+static bool compressJson = true;
+static int downloadRingDepth = DOWNLOAD_RING_DEPTH;
+static size_t downloadChunkSize = DOWNLOAD_CHUNK_SIZE;
+static ApiStats stats;
+static ThreadMutex statsLock; // Download counters are updated from worker threads
+static atomic_bool interrupting; // Set by api_interrupt_downloads(): a cancel keeps the part file
+
+// Download connections open to the server. Every download URL is built from baseUrl, so this one
+// count is the per-host limit, shared by concurrent downloads and the extra segments they open.
+static ThreadMutex connectionLock;
+static ThreadCond connectionFreed;
+static int openConnections = 0;
+static int maxConnections = DEFAULT_MAX_CONNECTIONS;
+
+// Browsing requests have the user waiting, so they get a couple of quick retries. Downloads run in the
+// background and can wait out a longer outage.
+static const RetryPolicy jsonRetry = {2, 250, 1000, 3000};
+static RetryPolicy downloadRetry = {DEFAULT_DOWNLOAD_RETRIES, 1000, 30000, 120000};
+
+// Shared by every download read; JSON requests mark themselves foreground so downloads can back off
+static RateLimit downloadLimit;
+
+// cJSON trees live in this arena for the duration of one API call. The hooks are global,
+// so DOM parsing must stay on the main thread.
+static Arena jsonArena;
 
 static void url_encode(const char *src, char *dst, size_t dstLen) {
     static const char *unreserved = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_.~";
@@ -35,42 +97,201 @@ static void url_encode(const char *src, char *dst, size_t dstLen) {
     dst[j] = '\0';
 }
 
-// Base64 encoding table
-static const char base64_table[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
-
-static void base64_encode(const char *input, char *output, size_t outlen) {
-    size_t i, j;
-    size_t len = strlen(input);
+static void *json_arena_malloc(size_t size) {
+    return arena_alloc(&jsonArena, size);
+}
 
-    for (i = 0, j = 0; i < len && j < outlen - 4;) {
-        uint32_t octet_a = i < len ? (unsigned char)input[i++] : 0;
-        uint32_t octet_b = i < len ? (unsigned char)input[i++] : 0;
-        uint32_t octet_c = i < len ? (unsigned char)input[i++] : 0;
-        uint32_t triple = (octet_a << 16) + (octet_b << 8) + octet_c;
+static void json_arena_free(void *ptr) {
+    (void)ptr; // Released in bulk by json_release()
+}
 
-        output[j++] = base64_table[(triple >> 18) & 0x3F];
-        output[j++] = base64_table[(triple >> 12) & 0x3F];
-        output[j++] = base64_table[(triple >> 6) & 0x3F];
-        output[j++] = base64_table[triple & 0x3F];
-    }
-    output[j] = '\0';
+// Parse a document with every cJSON node and string allocated from jsonArena
+static cJSON *json_parse(const char *text) {
+    cJSON_Hooks hooks = {json_arena_malloc, json_arena_free};
+    arena_reset(&jsonArena);
+    cJSON_InitHooks(&hooks);
+    cJSON *json = cJSON_Parse(text);
+    cJSON_InitHooks(NULL);
+    if (!json) arena_reset(&jsonArena);
+    return json;
+}
 
-    // Add padding based on input length
-    size_t remainder = len % 3;
-    if (remainder == 1 && j >= 2) {
-        output[j - 1] = '=';
-        output[j - 2] = '=';
-    } else if (remainder == 2 && j >= 1) {
-        output[j - 1] = '=';
-    }
+// Drop the whole tree from json_parse() at once, recording arena usage
+static void json_release(void) {
+    log_debug("JSON arena: %lu allocs, %zu bytes (%lu overflow chunks)", (unsigned long)jsonArena.allocs,
+              jsonArena.used, (unsigned long)jsonArena.overflow);
+    thread_mutex_lock(&statsLock);
+    stats.jsonAllocs += jsonArena.allocs;
+    stats.jsonArenaHighWater = jsonArena.highWater;
+    thread_mutex_unlock(&statsLock);
+    arena_reset(&jsonArena);
 }
 
 void api_init(void) {
-    // Nothing to initialize
+    arena_init(&jsonArena, JSON_ARENA_CHUNK_SIZE);
+    thread_mutex_init(&statsLock);
+    thread_mutex_init(&connectionLock);
+    thread_cond_init(&connectionFreed);
+    openConnections = 0;
+    atomic_store(&interrupting, false);
+    ratelimit_init(&downloadLimit);
+    auth_init();
+    respcache_init();
+    coalesce_init();
+    watchdog_init();
+    reachability_init();
+    transport_init();
 }
 
 void api_exit(void) {
-    // Nothing to cleanup
+    reachability_exit();
+    watchdog_exit();
+    transport_exit();
+    arena_free(&jsonArena);
+}
+
+void api_interrupt_downloads(void) {
+    atomic_store(&interrupting, true);
+}
+
+void api_get_stats(ApiStats *out) {
+    thread_mutex_lock(&statsLock);
+    *out = stats;
+    thread_mutex_unlock(&statsLock);
+    out->throttledMs = ratelimit_waited_ms(&downloadLimit);
+    CoalesceStats coalesced;
+    coalesce_get_stats(&coalesced);
+    out->coalesceHits = coalesced.hits;
+    out->coalesceMisses = coalesced.misses;
+}
+
+void api_set_max_response_size(size_t maxBytes) {
+    maxResponseSize = maxBytes > 0 ? maxBytes : DEFAULT_MAX_RESPONSE_SIZE;
+}
+
+void api_set_download_segments(int segments) {
+    if (segments < 1) segments = 1;
+    if (segments > MAX_DOWNLOAD_SEGMENTS) segments = MAX_DOWNLOAD_SEGMENTS;
+    downloadSegments = segments;
+}
+
+void api_set_download_buffers(int depth, size_t chunkSize) {
+    if (depth < 1) depth = 1;
+    if (depth > MAX_DOWNLOAD_RING_DEPTH) depth = MAX_DOWNLOAD_RING_DEPTH;
+    if (chunkSize == 0) chunkSize = DOWNLOAD_CHUNK_SIZE;
+    if (chunkSize < MIN_DOWNLOAD_CHUNK_SIZE) chunkSize = MIN_DOWNLOAD_CHUNK_SIZE;
+    if (chunkSize > MAX_DOWNLOAD_CHUNK_SIZE) chunkSize = MAX_DOWNLOAD_CHUNK_SIZE;
+    downloadRingDepth = depth;
+    downloadChunkSize = chunkSize;
+}
+
+void api_set_max_connections(int connections) {
+    if (connections < 1) connections = 1;
+    if (connections > MAX_CONNECTIONS) connections = MAX_CONNECTIONS;
+    thread_mutex_lock(&connectionLock);
+    maxConnections = connections;
+    thread_cond_broadcast(&connectionFreed);
+    thread_mutex_unlock(&connectionLock);
+}
+
+void api_set_json_compression(bool enabled) {
+    compressJson = enabled;
+}
+
+void api_set_download_retries(int retries) {
+    if (retries < 0) retries = 0;
+    if (retries > MAX_DOWNLOAD_RETRIES) retries = MAX_DOWNLOAD_RETRIES;
+    downloadRetry.maxRetries = retries;
+}
+
+void api_set_stall_timeout(uint32_t ms) {
+    watchdog_set_timeout(ms);
+}
+
+void api_set_timeouts(uint32_t connectMs, uint32_t responseMs) {
+    transport_set_timeouts(connectMs, responseMs);
+}
+
+void api_set_download_rate(uint32_t bytesPerSecond) {
+    ratelimit_set_rate(&downloadLimit, bytesPerSecond);
+}
+
+void api_set_download_backoff(uint32_t bytesPerSecond) {
+    ratelimit_set_backoff(&downloadLimit, bytesPerSecond);
+}
+
+// Wait for a free connection. The wait polls progressCb with (0, 0) so a queued download can still be
+// cancelled. Returns false if it was.
+static bool connection_acquire(DownloadProgressCb progressCb) {
+    thread_mutex_lock(&connectionLock);
+    while (openConnections >= maxConnections) {
+        if (thread_cond_wait_ms(&connectionFreed, &connectionLock, CONNECTION_WAIT_MS) || !progressCb) continue;
+        thread_mutex_unlock(&connectionLock);
+        bool keepGoing = progressCb(0, 0);
+        thread_mutex_lock(&connectionLock);
+        if (!keepGoing) {
+            thread_mutex_unlock(&connectionLock);
+            return false;
+        }
+    }
+    openConnections++;
+    thread_mutex_unlock(&connectionLock);
+    return true;
+}
+
+// Take up to want more connections without waiting. Returns how many were granted.
+static int connection_try_acquire(int want) {
+    thread_mutex_lock(&connectionLock);
+    int granted = maxConnections - openConnections;
+    if (granted > want) granted = want;
+    if (granted < 0) granted = 0;
+    openConnections += granted;
+    thread_mutex_unlock(&connectionLock);
+    return granted;
+}
+
+static void connection_release(int count) {
+    thread_mutex_lock(&connectionLock);
+    openConnections -= count;
+    thread_cond_broadcast(&connectionFreed);
+    thread_mutex_unlock(&connectionLock);
+}
+
+static void count_retry(void) {
+    thread_mutex_lock(&statsLock);
+    stats.retries++;
+    thread_mutex_unlock(&statsLock);
+}
+
+// Stop watching a transfer, counting it if the watchdog had to abort it
+static bool watch_stop(StallWatch *watch) {
+    if (!watchdog_stop(watch)) return false;
+    thread_mutex_lock(&statsLock);
+    stats.stalls++;
+    thread_mutex_unlock(&statsLock);
+    return true;
+}
+
+// Sleep before a retry, polling progressCb and *cancel (either may be NULL) so a cancel isn't held up.
+// Returns false if cancelled.
+static bool wait_for_retry(uint32_t delayMs, DownloadProgressCb progressCb, volatile bool *cancel) {
+    count_retry();
+    uint64_t end = transport_now_ms() + delayMs;
+    for (uint64_t now = transport_now_ms(); now < end; now = transport_now_ms()) {
+        thread_sleep_ms(end - now < CONNECTION_WAIT_MS ? (uint32_t)(end - now) : CONNECTION_WAIT_MS);
+        if ((progressCb && !progressCb(0, 0)) || (cancel && *cancel)) return false;
+    }
+    return true;
+}
+
+// Classify an error response for retrying, picking up the server's Retry-After
+static void classify_status(TransportRequest *req, int status, RetryCause *cause) {
+    cause->reason = retry_classify_status(status);
+    cause->retryAfterMs = 0;
+    char value[32];
+    if (cause->reason != RETRY_FATAL && transport_get_header(req, "Retry-After", value, sizeof(value))) {
+        cause->retryAfterMs = retry_parse_after(value);
+    }
 }
 
 void api_set_base_url(const char *url) {
@@ -80,113 +301,440 @@ void api_set_base_url(const char *url) {
     if (len > 0 && baseUrl[len - 1] == '/') {
         baseUrl[len - 1] = '\0';
     }
+
+    char tokenUrl[MAX_URL_LEN];
+    snprintf(tokenUrl, sizeof(tokenUrl), "%s/api/token", baseUrl);
+    auth_set_token_url(tokenUrl);
+
+    // Cached responses and reachability belong to the old server
+    char heartbeatUrl[MAX_URL_LEN];
+    snprintf(heartbeatUrl, sizeof(heartbeatUrl), "%s/api/heartbeat", baseUrl);
+    reachability_set_probe_url(heartbeatUrl);
+    respcache_clear();
 }
 
 void api_set_auth(const char *username, const char *password) {
-    if (!username || !password || username[0] == '\0') {
-        authHeader[0] = '\0';
-        return;
-    }
-
-    char credentials[256];
-    snprintf(credentials, sizeof(credentials), "%s:%s", username, password);
+    auth_set_credentials(username, password);
+}
 
-    char encoded[256];
-    base64_encode(credentials, encoded, sizeof(encoded));
+void api_set_token_auth(bool enabled) {
+    auth_set_tokens(enabled);
+}
 
-    snprintf(authHeader, sizeof(authHeader), "Basic %s", encoded);
+// Don't send a request while the server is known to be unreachable. Returns true if it should be skipped.
+static bool skip_offline(const char *url) {
+    if (!reachability_offline()) return false;
+    log_debug("Server offline, not sending %s", url);
+    thread_mutex_lock(&statsLock);
+    stats.offlineSkips++;
+    thread_mutex_unlock(&statsLock);
+    return true;
 }
 
-// Configure common headers on an open httpc context
-static void setup_http_headers(httpcContext *context, const char *accept) {
-    httpcSetSSLOpt(context, SSLCOPT_DisableVerify);
-    httpcSetKeepAlive(context, HTTPC_KEEPALIVE_ENABLED);
-    httpcAddRequestHeaderField(context, "User-Agent", "Rommlet/1.0");
-    httpcAddRequestHeaderField(context, "Accept", accept);
-    if (authHeader[0] != '\0') {
-        httpcAddRequestHeaderField(context, "Authorization", authHeader);
+// Open a GET request with the common headers plus extra (name/value pairs ending in NULL), send it and wait for
+// the response headers. A 401 for a token that expired or was revoked early is retried once with a fresh one.
+// Whether the server answered at all is reported to the reachability module. Returns NULL on failure, at once
+// while the server is offline.
+static TransportRequest *send_get(const char *url, const char *accept, const char *const *extra) {
+    for (int attempt = 0;; attempt++) {
+        if (skip_offline(url)) return NULL;
+        TransportRequest *req = transport_open(TRANSPORT_METHOD_GET, url);
+        if (!req) {
+            log_error("Failed to open request: %s", url);
+            return NULL;
+        }
+        char authHeader[AUTH_HEADER_LEN];
+        uint32_t token = auth_header(authHeader, sizeof(authHeader));
+        // The token request may just have found the server gone
+        if (skip_offline(url)) {
+            transport_close(req);
+            return NULL;
+        }
+        transport_add_header(req, "User-Agent", "Rommlet/1.0");
+        transport_add_header(req, "Accept", accept);
+        if (authHeader[0] != '\0') transport_add_header(req, "Authorization", authHeader);
+        for (int i = 0; extra[i]; i += 2) transport_add_header(req, extra[i], extra[i + 1]);
+
+        if (!transport_begin(req)) {
+            log_error("Request failed: %s", url);
+            reachability_report(!transport_unreachable(req));
+            transport_close(req);
+            return NULL;
+        }
+        reachability_report(true);
+        int status = 0;
+        if (attempt > 0 || !transport_get_status(req, &status) || status != 401 || !auth_rejected(token)) return req;
+        transport_close(req);
     }
 }
 
-static char *http_get(const char *url, int *statusCode) {
-    httpcContext context;
-    Result ret;
+// Open a GET request with common headers and send it. A non-zero rangeStart or rangeEnd (exclusive, 0 = end of
+// file) asks for part of the body, conditional on ifRange when given. Returns NULL on failure.
+static TransportRequest *begin_get_range(const char *url, const char *accept, uint32_t rangeStart, uint32_t rangeEnd,
+                                         const char *ifRange) {
+    const char *extra[5] = {NULL};
+    char range[48];
+    if (rangeStart > 0 || rangeEnd > 0) {
+        if (rangeEnd > 0) {
+            snprintf(range, sizeof(range), "bytes=%lu-%lu", (unsigned long)rangeStart, (unsigned long)rangeEnd - 1);
+        } else {
+            snprintf(range, sizeof(range), "bytes=%lu-", (unsigned long)rangeStart);
+        }
+        extra[0] = "Range";
+        extra[1] = range;
+        if (ifRange && ifRange[0] != '\0') {
+            extra[2] = "If-Range";
+            extra[3] = ifRange;
+        }
+    }
+    return send_get(url, accept, extra);
+}
 
+// Send a JSON GET, compressed if enabled, and check for a 200 response. Returns a decoder over the body,
+// or NULL on failure with cause set.
+static BodyDecoder *open_json_request(const char *url, int *statusCode, RetryCause *cause) {
     *statusCode = 0;
+    cause->reason = RETRY_CONNECT;
+    cause->retryAfterMs = 0;
 
     log_debug("GET %s", url);
 
-    ret = httpcOpenContext(&context, HTTPC_METHOD_GET, url, 1);
-    if (R_FAILED(ret)) {
-        log_error("httpcOpenContext failed: %08lX", ret);
+    const char *extra[] = {"Accept-Encoding", BODYDECODER_ACCEPT, NULL};
+    TransportRequest *req = send_get(url, "application/json", compressJson ? extra : extra + 2);
+    if (!req) return NULL;
+
+    int status = 0;
+    if (!transport_get_status(req, &status)) {
+        log_error("Failed to read response status");
+        transport_close(req);
         return NULL;
     }
+    *statusCode = status;
 
-    setup_http_headers(&context, "application/json");
+    log_debug("Status: %d", status);
 
-    ret = httpcBeginRequest(&context);
-    if (R_FAILED(ret)) {
-        log_error("httpcBeginRequest failed: %08lX", ret);
-        httpcCloseContext(&context);
+    if (status != 200) {
+        log_error("HTTP error: %d", status);
+        classify_status(req, status, cause);
+        transport_close(req);
         return NULL;
     }
+    BodyDecoder *body = bodydecoder_open(req);
+    if (!body) cause->reason = RETRY_FATAL;
+    return body;
+}
 
-    u32 status;
-    ret = httpcGetResponseStatusCode(&context, &status);
-    if (R_FAILED(ret)) {
-        log_error("httpcGetResponseStatusCode failed: %08lX", ret);
-        httpcCloseContext(&context);
-        return NULL;
-    }
-    *statusCode = (int)status;
+// Count a JSON body's size on the wire and decoded
+static void record_json_body(const BodyDecoder *body, size_t decodedSize) {
+    thread_mutex_lock(&statsLock);
+    stats.jsonWireBytes += bodydecoder_wire_bytes(body);
+    stats.jsonBodyBytes += decodedSize;
+    thread_mutex_unlock(&statsLock);
+}
 
-    log_debug("Status: %lu", status);
+// Stop watching a JSON body and close it. Returns true if the watchdog aborted it.
+static bool close_json_body(BodyDecoder *body, StallWatch *watch) {
+    bool stalled = watch_stop(watch);
+    bodydecoder_close(body);
+    return stalled;
+}
 
-    if (status != 200) {
-        log_error("HTTP error: %lu", status);
-        httpcCloseContext(&context);
+static char *read_json_body(const char *url, int *statusCode, RetryCause *cause) {
+    BodyDecoder *body = open_json_request(url, statusCode, cause);
+    if (!body) return NULL;
+    // From here only a dropped or stalled body is worth another try
+    cause->reason = RETRY_FATAL;
+    StallWatch watch;
+    watchdog_start(&watch, bodydecoder_request(body));
+
+    // Start with the advertised size when known, then grow geometrically up to the cap
+    size_t capacity = bodydecoder_content_length(body);
+    if (capacity > maxResponseSize) {
+        log_error("Response too large: %zu bytes (limit %zu)", capacity, maxResponseSize);
+        close_json_body(body, &watch);
         return NULL;
     }
+    if (capacity == 0) capacity = RESPONSE_INITIAL_SIZE;
 
-    // Get content length
-    u32 contentSize = 0;
-    ret = httpcGetDownloadSizeState(&context, NULL, &contentSize);
-    if (contentSize == 0 || contentSize > MAX_RESPONSE_SIZE) {
-        contentSize = MAX_RESPONSE_SIZE;
-    }
-
-    // Allocate buffer
-    char *buffer = malloc(contentSize + 1);
+    char *buffer = malloc(capacity + 1);
     if (!buffer) {
         log_error("Failed to allocate response buffer");
-        httpcCloseContext(&context);
+        close_json_body(body, &watch);
         return NULL;
     }
 
-    // Download data
-    u32 downloadedSize = 0;
-    ret = httpcDownloadData(&context, (u8 *)buffer, contentSize, &downloadedSize);
-    if (R_FAILED(ret) && ret != HTTPC_RESULTCODE_DOWNLOADPENDING) {
-        log_error("httpcDownloadData failed: %08lX", ret);
-        free(buffer);
-        httpcCloseContext(&context);
-        return NULL;
+    size_t downloadedSize = 0;
+    uint32_t reallocs = 0;
+    while (true) {
+        if (downloadedSize == capacity) {
+            if (capacity >= maxResponseSize) {
+                log_error("Response exceeds %zu byte limit", maxResponseSize);
+                free(buffer);
+                close_json_body(body, &watch);
+                return NULL;
+            }
+            size_t newCapacity = capacity * 2 < maxResponseSize ? capacity * 2 : maxResponseSize;
+            char *grown = realloc(buffer, newCapacity + 1);
+            if (!grown) {
+                log_error("Failed to grow response buffer to %zu bytes", newCapacity);
+                free(buffer);
+                close_json_body(body, &watch);
+                return NULL;
+            }
+            buffer = grown;
+            capacity = newCapacity;
+            reallocs++;
+        }
+
+        size_t bytesRead = 0;
+        TransportReadResult result =
+            bodydecoder_read(body, buffer + downloadedSize, capacity - downloadedSize, &bytesRead);
+        downloadedSize += bytesRead;
+        if (bytesRead > 0) watchdog_progress(&watch);
+        if (result == TRANSPORT_READ_DONE) break;
+        if (result == TRANSPORT_READ_ERROR) {
+            log_error("Failed to read response body");
+            free(buffer);
+            cause->reason = close_json_body(body, &watch) ? RETRY_TIMEOUT : RETRY_DROPPED;
+            return NULL;
+        }
     }
 
+    thread_mutex_lock(&statsLock);
+    stats.responseReallocs += reallocs;
+    if (downloadedSize > stats.largestResponse) stats.largestResponse = downloadedSize;
+    thread_mutex_unlock(&statsLock);
+
     buffer[downloadedSize] = '\0';
-    httpcCloseContext(&context);
+    record_json_body(body, downloadedSize);
+    close_json_body(body, &watch);
 
-    log_debug("Size: %lu bytes", downloadedSize);
+    log_debug("Size: %zu bytes (%lu reallocs)", downloadedSize, (unsigned long)reallocs);
     if (downloadedSize <= TRACE_BODY_PREVIEW_LEN) {
         log_trace("Body:\n%s", buffer);
     } else {
-        log_trace("Body (truncated):\n%.*s...\n[%lu more bytes]", TRACE_BODY_PREVIEW_LEN, buffer,
+        log_trace("Body (truncated):\n%.*s...\n[%zu more bytes]", TRACE_BODY_PREVIEW_LEN, buffer,
                   downloadedSize - TRACE_BODY_PREVIEW_LEN);
     }
 
     return buffer;
 }
 
+// The last good body of url, for when the server can't be reached. Caller frees.
+static char *lookup_cached(const char *url, size_t *len) {
+    char *body = respcache_lookup(url, len);
+    if (!body) {
+        log_info("Server offline and nothing cached for %s", url);
+        return NULL;
+    }
+    log_info("Server offline, using cached response for %s", url);
+    thread_mutex_lock(&statsLock);
+    stats.offlineHits++;
+    thread_mutex_unlock(&statsLock);
+    return body;
+}
+
+// GET a JSON document into a NUL-terminated buffer, retrying network and server failures. Downloads back off
+// while it runs. While the server is unreachable the cached response is returned instead, if there is one.
+static char *fetch_json(const char *url, int *statusCode) {
+    size_t len;
+    *statusCode = 0;
+    if (skip_offline(url)) {
+        char *cached = lookup_cached(url, &len);
+        if (cached) *statusCode = 200;
+        return cached;
+    }
+
+    ratelimit_foreground_begin(&downloadLimit);
+    Retry retry;
+    retry_init(&retry, &jsonRetry);
+    RetryCause cause;
+    uint32_t delayMs;
+    char *body;
+    while (!(body = read_json_body(url, statusCode, &cause)) && !reachability_offline() &&
+           retry_next(&retry, &cause, &delayMs)) {
+        wait_for_retry(delayMs, NULL, NULL);
+    }
+    ratelimit_foreground_end(&downloadLimit);
+
+    if (body) {
+        respcache_store(url, body, strlen(body));
+    } else if (reachability_offline() && (body = lookup_cached(url, &len))) {
+        *statusCode = 200;
+    }
+    return body;
+}
+
+// Stream one attempt at url into js. The decoded body is also collected in record, which is left empty if the
+// attempt fails.
+static bool stream_json_body(const char *url, JsonStream *js, RetryCause *cause, RespCacheRecord *record) {
+    int statusCode;
+    BodyDecoder *body = open_json_request(url, &statusCode, cause);
+    if (!body) return false;
+    cause->reason = RETRY_FATAL;
+
+    char *chunk = malloc(STREAM_CHUNK_SIZE);
+    if (!chunk) {
+        log_error("Failed to allocate stream buffer");
+        bodydecoder_close(body);
+        return false;
+    }
+    StallWatch watch;
+    watchdog_start(&watch, bodydecoder_request(body));
+
+    size_t totalSize = 0;
+    bool ok = true;
+    while (true) {
+        size_t bytesRead = 0;
+        TransportReadResult result = bodydecoder_read(body, chunk, STREAM_CHUNK_SIZE, &bytesRead);
+        totalSize += bytesRead;
+        if (bytesRead > 0) {
+            watchdog_progress(&watch);
+            respcache_record_append(record, chunk, bytesRead);
+        }
+        if (bytesRead > 0 && !jsonstream_feed(js, chunk, bytesRead)) {
+            log_error("JSON parse error at byte %zu", totalSize);
+            ok = false;
+            break;
+        }
+        if (result == TRANSPORT_READ_DONE) break;
+        if (result == TRANSPORT_READ_ERROR) {
+            log_error("Failed to read response body");
+            cause->reason = RETRY_DROPPED;
+            ok = false;
+            break;
+        }
+    }
+
+    free(chunk);
+    record_json_body(body, totalSize);
+    if (close_json_body(body, &watch) && cause->reason == RETRY_DROPPED) cause->reason = RETRY_TIMEOUT;
+
+    if (ok && !jsonstream_finish(js)) {
+        log_error("JSON parse error: truncated document");
+        ok = false;
+    }
+    if (!ok) respcache_record_discard(record);
+    log_debug("Streamed: %zu bytes", totalSize);
+    return ok;
+}
+
+// Feed a whole body to a stream parser and free it. Returns false if body is NULL or doesn't parse.
+static bool stream_buffer(JsonStream *js, char *body, size_t len) {
+    if (!body) return false;
+    bool ok = jsonstream_feed(js, body, len) && jsonstream_finish(js);
+    free(body);
+    return ok;
+}
+
+// Feed the cached body of url to a stream parser. Returns false if there is none or it doesn't parse.
+static bool stream_cached(const char *url, JsonStream *js) {
+    size_t len;
+    char *body = lookup_cached(url, &len);
+    return stream_buffer(js, body, len);
+}
+
+// GET a JSON document and feed it to a stream parser chunk by chunk as it arrives. Downloads back off while
+// it runs. Network and server failures are retried from the start of the document: the parser is reset and
+// restart is called with its context first, so the decoder can drop what it built from the failed attempt.
+// While the server is unreachable the cached body is parsed instead, if there is one. A body read from the server
+// is left in record. Returns true if the whole body was read and parsed.
+static bool fetch_json_stream(const char *url, JsonStream *js, void (*restart)(void *ctx), RespCacheRecord *record) {
+    if (skip_offline(url)) return stream_cached(url, js);
+
+    ratelimit_foreground_begin(&downloadLimit);
+    Retry retry;
+    retry_init(&retry, &jsonRetry);
+    RetryCause cause;
+    uint32_t delayMs;
+    bool ok;
+    while (!(ok = stream_json_body(url, js, &cause, record)) && !reachability_offline() &&
+           retry_next(&retry, &cause, &delayMs)) {
+        wait_for_retry(delayMs, NULL, NULL);
+        restart(js->ctx);
+        jsonstream_init(js, js->callback, js->ctx);
+    }
+    ratelimit_foreground_end(&downloadLimit);
+
+    if (!ok && reachability_offline()) {
+        restart(js->ctx);
+        jsonstream_init(js, js->callback, js->ctx);
+        ok = stream_cached(url, js);
+    }
+    return ok;
+}
+
+// GET a JSON document (see fetch_json()). A caller asking for a URL that is already being fetched waits for that
+// request and gets a copy of its body instead of sending another.
+static char *http_get(const char *url, int *statusCode) {
+    size_t len;
+    char *body;
+    CoalesceFlight *flight = coalesce_begin(url, &body, &len);
+    if (!flight) {
+        *statusCode = body ? 200 : 0;
+        return body;
+    }
+    body = fetch_json(url, statusCode);
+    coalesce_finish(flight, body != NULL, body, body ? strlen(body) : 0);
+    return body;
+}
+
+// Stream a JSON document into js (see fetch_json_stream()), sharing a request already in flight for the same URL
+// like http_get(). Bodies from the server are kept for use while offline.
+static bool http_get_stream(const char *url, JsonStream *js, void (*restart)(void *ctx)) {
+    size_t len;
+    char *shared;
+    CoalesceFlight *flight = coalesce_begin(url, &shared, &len);
+    if (!flight) return stream_buffer(js, shared, len);
+
+    RespCacheRecord record = {0};
+    bool ok = fetch_json_stream(url, js, restart, &record);
+    // A body too large to record can't be shared either; waiters then send their own request
+    bool recorded = ok && record.data;
+    coalesce_finish(flight, ok, recorded ? record.data : NULL, record.len);
+    if (recorded) {
+        respcache_record_commit(&record, url);
+    } else {
+        respcache_record_discard(&record);
+    }
+    return ok;
+}
+
+// JSON keys decoded into each struct
+static const JsonField platformFields[] = {
+    JSON_FIELD(Platform, "id", id, JSON_FIELD_INT, 0),
+    JSON_FIELD(Platform, "slug", slug, JSON_FIELD_STRING, 0),
+    JSON_FIELD(Platform, "name", name, JSON_FIELD_STRING, 0),
+    JSON_FIELD(Platform, "display_name", displayName, JSON_FIELD_STRING, 0),
+    JSON_FIELD(Platform, "rom_count", romCount, JSON_FIELD_INT, 0),
+};
+
+static const JsonField romFields[] = {
+    JSON_FIELD(Rom, "id", id, JSON_FIELD_INT, 0),
+    JSON_FIELD(Rom, "platform_id", platformId, JSON_FIELD_INT, 0),
+    JSON_FIELD(Rom, "name", name, JSON_FIELD_STRING, 0),
+    JSON_FIELD(Rom, "fs_name", fsName, JSON_FIELD_STRING, 0),
+    JSON_FIELD(Rom, "md5_hash", md5Hash, JSON_FIELD_STRING, 0),
+    JSON_FIELD(Rom, "fs_size_bytes", sizeBytes, JSON_FIELD_U64, 0),
+};
+
+static const JsonField romDetailFields[] = {
+    JSON_FIELD(RomDetail, "id", id, JSON_FIELD_INT, 0),
+    JSON_FIELD(RomDetail, "platform_id", platformId, JSON_FIELD_INT, 0),
+    JSON_FIELD(RomDetail, "name", name, JSON_FIELD_STRING, 0),
+    JSON_FIELD(RomDetail, "fs_name", fsName, JSON_FIELD_STRING, 0),
+    JSON_FIELD(RomDetail, "summary", summary, JSON_FIELD_STRING, 0),
+    JSON_FIELD(RomDetail, "md5_hash", md5Hash, JSON_FIELD_STRING, 0),
+    JSON_FIELD(RomDetail, "fs_size_bytes", sizeBytes, JSON_FIELD_U64, 0),
+    // Platform name is a flat field, not nested; the slug stands in when there is no display name
+    JSON_FIELD(RomDetail, "platform_display_name", platformName, JSON_FIELD_STRING, 0),
+    JSON_FIELD(RomDetail, "platform_slug", platformName, JSON_FIELD_STRING, JSON_FIELD_IF_EMPTY),
+};
+
+static JsonFieldTable platformTable = JSON_FIELD_TABLE(platformFields);
+static JsonFieldTable romTable = JSON_FIELD_TABLE(romFields);
+static JsonFieldTable romDetailTable = JSON_FIELD_TABLE(romDetailFields);
+
 Platform *api_get_platforms(int *count) {
     *count = 0;
 
@@ -200,7 +748,7 @@ Platform *api_get_platforms(int *count) {
     }
 
     // Parse JSON
-    cJSON *json = cJSON_Parse(response);
+    cJSON *json = json_parse(response);
     free(response);
 
     if (!json) {
@@ -210,37 +758,26 @@ Platform *api_get_platforms(int *count) {
 
     if (!cJSON_IsArray(json)) {
         log_error("Expected array response");
-        cJSON_Delete(json);
+        json_release();
         return NULL;
     }
 
     int arraySize = cJSON_GetArraySize(json);
     if (arraySize == 0) {
-        cJSON_Delete(json);
+        json_release();
         return NULL;
     }
 
     Platform *platforms = calloc(arraySize, sizeof(Platform));
     if (!platforms) {
-        cJSON_Delete(json);
+        json_release();
         return NULL;
     }
 
     int i = 0;
     cJSON *item;
     cJSON_ArrayForEach(item, json) {
-        cJSON *id = cJSON_GetObjectItem(item, "id");
-        cJSON *slug = cJSON_GetObjectItem(item, "slug");
-        cJSON *name = cJSON_GetObjectItem(item, "name");
-        cJSON *displayName = cJSON_GetObjectItem(item, "display_name");
-        cJSON *romCount = cJSON_GetObjectItem(item, "rom_count");
-
-        if (cJSON_IsNumber(id)) platforms[i].id = id->valueint;
-        if (cJSON_IsString(slug)) snprintf(platforms[i].slug, sizeof(platforms[i].slug), "%s", slug->valuestring);
-        if (cJSON_IsString(name)) snprintf(platforms[i].name, sizeof(platforms[i].name), "%s", name->valuestring);
-        if (cJSON_IsString(displayName))
-            snprintf(platforms[i].displayName, sizeof(platforms[i].displayName), "%s", displayName->valuestring);
-        if (cJSON_IsNumber(romCount)) platforms[i].romCount = romCount->valueint;
+        jsonfields_decode(&platformTable, item, &platforms[i]);
 
         // Fallback to name if displayName is empty
         if (platforms[i].displayName[0] == '\0' && platforms[i].name[0] != '\0') {
@@ -251,7 +788,7 @@ Platform *api_get_platforms(int *count) {
     }
 
     *count = i;
-    cJSON_Delete(json);
+    json_release();
     return platforms;
 }
 
@@ -260,59 +797,107 @@ void api_free_platforms(Platform *platforms, int count) {
     if (platforms) free(platforms);
 }
 
-static Rom *parse_paginated_roms(const char *response, int *count, int *total) {
+// Streaming decoder state for a paginated /api/roms response
+typedef struct {
+    Rom *roms;
+    int count;
+    int capacity;
+    int total;
+    bool totalNext; // Next root-level value is "total"
+    bool itemsNext; // Next root-level value is "items"
+    bool inItems;
+    bool sawItems;
+    const JsonField *field; // Field for the value that follows the current item key
+} RomPageDecoder;
+
+// Depths as reported by jsonstream: root keys at 1, item objects at 2, item keys/values at 3
+static bool rom_page_event(void *ctx, JsonEvent event, const char *text, size_t len, int depth) {
+    RomPageDecoder *dec = ctx;
+    (void)len;
+
+    if (depth == 1) {
+        if (event == JSON_EVENT_KEY) {
+            dec->totalNext = strcmp(text, "total") == 0;
+            dec->itemsNext = strcmp(text, "items") == 0;
+        } else if (event == JSON_EVENT_NUMBER && dec->totalNext) {
+            dec->total = atoi(text);
+        } else if (event == JSON_EVENT_ARRAY_START && dec->itemsNext) {
+            dec->inItems = true;
+            dec->sawItems = true;
+        } else if (event == JSON_EVENT_ARRAY_END) {
+            dec->inItems = false;
+        }
+        return true;
+    }
+    if (!dec->inItems) return true;
+
+    if (depth == 2 && event == JSON_EVENT_OBJECT_START) {
+        if (dec->count == dec->capacity) {
+            int newCapacity = dec->capacity > 0 ? dec->capacity * 2 : ROM_PAGE_INITIAL_CAPACITY;
+            Rom *grown = realloc(dec->roms, newCapacity * sizeof(Rom));
+            if (!grown) {
+                log_error("Failed to grow ROM array to %d entries", newCapacity);
+                return false;
+            }
+            dec->roms = grown;
+            dec->capacity = newCapacity;
+        }
+        memset(&dec->roms[dec->count++], 0, sizeof(Rom));
+        dec->field = NULL;
+        return true;
+    }
+    if (depth != 3) return true;
+
+    Rom *rom = &dec->roms[dec->count - 1];
+    if (event == JSON_EVENT_KEY) {
+        dec->field = jsonfields_lookup(&romTable, text);
+    } else if (dec->field && event == JSON_EVENT_NUMBER) {
+        jsonfields_store_number(dec->field, rom, strtod(text, NULL));
+    } else if (dec->field && event == JSON_EVENT_STRING) {
+        jsonfields_store_string(dec->field, rom, text);
+    }
+    return true;
+}
+
+// Drop a partly decoded page before its request is retried, keeping the array for reuse
+static void rom_page_restart(void *ctx) {
+    RomPageDecoder *dec = ctx;
+    Rom *roms = dec->roms;
+    int capacity = dec->capacity;
+    memset(dec, 0, sizeof(*dec));
+    dec->roms = roms;
+    dec->capacity = capacity;
+}
+
+// Fetch a paginated /api/roms URL, decoding items straight into a Rom array as bytes arrive
+static Rom *get_paginated_roms(const char *url, int limit, int *count, int *total) {
     *count = 0;
     *total = 0;
 
-    cJSON *json = cJSON_Parse(response);
-    if (!json) {
-        log_error("JSON parse error");
-        return NULL;
+    RomPageDecoder dec;
+    memset(&dec, 0, sizeof(dec));
+    if (limit > 0) {
+        dec.roms = malloc(limit * sizeof(Rom));
+        if (dec.roms) dec.capacity = limit;
     }
 
-    cJSON *totalJson = cJSON_GetObjectItem(json, "total");
-    if (cJSON_IsNumber(totalJson)) {
-        *total = totalJson->valueint;
-    }
+    JsonStream js;
+    jsonstream_init(&js, rom_page_event, &dec);
+    bool ok = http_get_stream(url, &js, rom_page_restart);
 
-    cJSON *items = cJSON_GetObjectItem(json, "items");
-    if (!items || !cJSON_IsArray(items)) {
+    if (ok && !dec.sawItems) {
         log_error("Expected items array");
-        cJSON_Delete(json);
-        return NULL;
-    }
-
-    int arraySize = cJSON_GetArraySize(items);
-    if (arraySize == 0) {
-        cJSON_Delete(json);
-        return NULL;
+        ok = false;
     }
-
-    Rom *roms = calloc(arraySize, sizeof(Rom));
-    if (!roms) {
-        cJSON_Delete(json);
+    if (!ok || dec.count == 0) {
+        free(dec.roms);
+        if (ok) *total = dec.total;
         return NULL;
     }
 
-    int i = 0;
-    cJSON *item;
-    cJSON_ArrayForEach(item, items) {
-        cJSON *id = cJSON_GetObjectItem(item, "id");
-        cJSON *platformIdJson = cJSON_GetObjectItem(item, "platform_id");
-        cJSON *name = cJSON_GetObjectItem(item, "name");
-        cJSON *fsName = cJSON_GetObjectItem(item, "fs_name");
-
-        if (cJSON_IsNumber(id)) roms[i].id = id->valueint;
-        if (cJSON_IsNumber(platformIdJson)) roms[i].platformId = platformIdJson->valueint;
-        if (cJSON_IsString(name)) snprintf(roms[i].name, sizeof(roms[i].name), "%s", name->valuestring);
-        if (cJSON_IsString(fsName)) snprintf(roms[i].fsName, sizeof(roms[i].fsName), "%s", fsName->valuestring);
-
-        i++;
-    }
-
-    *count = i;
-    cJSON_Delete(json);
-    return roms;
+    *count = dec.count;
+    *total = dec.total;
+    return dec.roms;
 }
 
 Rom *api_get_roms(int platformId, int offset, int limit, int *count, int *total) {
@@ -320,17 +905,7 @@ Rom *api_get_roms(int platformId, int offset, int limit, int *count, int *total)
     snprintf(url, sizeof(url), "%s/api/roms?platform_ids=%d&offset=%d&limit=%d&order_by=name", baseUrl, platformId,
              offset, limit);
 
-    int statusCode;
-    char *response = http_get(url, &statusCode);
-    if (!response) {
-        *count = 0;
-        *total = 0;
-        return NULL;
-    }
-
-    Rom *roms = parse_paginated_roms(response, count, total);
-    free(response);
-    return roms;
+    return get_paginated_roms(url, limit, count, total);
 }
 
 Rom *api_search_roms(const char *searchTerm, const int *platformIds, int platformIdCount, int offset, int limit,
@@ -346,17 +921,7 @@ Rom *api_search_roms(const char *searchTerm, const int *platformIds, int platfor
         pos += snprintf(url + pos, sizeof(url) - pos, "&platform_ids=%d", platformIds[i]);
     }
 
-    int statusCode;
-    char *response = http_get(url, &statusCode);
-    if (!response) {
-        *count = 0;
-        *total = 0;
-        return NULL;
-    }
-
-    Rom *roms = parse_paginated_roms(response, count, total);
-    free(response);
-    return roms;
+    return get_paginated_roms(url, limit, count, total);
 }
 
 void api_free_roms(Rom *roms, int count) {
@@ -374,7 +939,7 @@ RomDetail *api_get_rom_detail(int romId) {
         return NULL;
     }
 
-    cJSON *json = cJSON_Parse(response);
+    cJSON *json = json_parse(response);
     free(response);
 
     if (!json) {
@@ -384,198 +949,806 @@ RomDetail *api_get_rom_detail(int romId) {
 
     RomDetail *detail = calloc(1, sizeof(RomDetail));
     if (!detail) {
-        cJSON_Delete(json);
+        json_release();
         return NULL;
     }
 
-    // Basic fields
-    cJSON *id = cJSON_GetObjectItem(json, "id");
-    cJSON *platformId = cJSON_GetObjectItem(json, "platform_id");
-    cJSON *name = cJSON_GetObjectItem(json, "name");
-    cJSON *fsName = cJSON_GetObjectItem(json, "fs_name");
-    cJSON *summary = cJSON_GetObjectItem(json, "summary");
-    cJSON *md5Hash = cJSON_GetObjectItem(json, "md5_hash");
-
-    // Platform name is a flat field, not nested
-    cJSON *platformName = cJSON_GetObjectItem(json, "platform_display_name");
-    if (!platformName || !cJSON_IsString(platformName) || !platformName->valuestring[0]) {
-        platformName = cJSON_GetObjectItem(json, "platform_slug");
-    }
+    jsonfields_decode(&romDetailTable, json, detail);
 
     // Release date is inside the metadatum object (epoch seconds)
-    cJSON *metadatum = cJSON_GetObjectItem(json, "metadatum");
-    cJSON *firstReleaseDate = metadatum ? cJSON_GetObjectItem(metadatum, "first_release_date") : NULL;
-
-    if (cJSON_IsNumber(id)) detail->id = id->valueint;
-    if (cJSON_IsNumber(platformId)) detail->platformId = platformId->valueint;
-    if (cJSON_IsString(name)) snprintf(detail->name, sizeof(detail->name), "%s", name->valuestring);
-    if (cJSON_IsString(fsName)) snprintf(detail->fsName, sizeof(detail->fsName), "%s", fsName->valuestring);
-    if (cJSON_IsString(summary)) snprintf(detail->summary, sizeof(detail->summary), "%s", summary->valuestring);
-    if (cJSON_IsString(md5Hash)) snprintf(detail->md5Hash, sizeof(detail->md5Hash), "%s", md5Hash->valuestring);
-    if (cJSON_IsString(platformName))
-        snprintf(detail->platformName, sizeof(detail->platformName), "%s", platformName->valuestring);
+    cJSON *metadatum = cJSON_GetObjectItemCaseSensitive(json, "metadatum");
+    cJSON *firstReleaseDate = metadatum ? cJSON_GetObjectItemCaseSensitive(metadatum, "first_release_date") : NULL;
+
     if (cJSON_IsNumber(firstReleaseDate)) {
         time_t epoch = (time_t)(firstReleaseDate->valuedouble / 1000.0);
         struct tm *tm = gmtime(&epoch);
         if (tm) strftime(detail->firstReleaseDate, sizeof(detail->firstReleaseDate), "%B %d, %Y", tm);
     }
 
-    cJSON_Delete(json);
+    json_release();
     return detail;
 }
 
-void api_free_rom_detail(RomDetail *detail) {
-    if (detail) free(detail);
+// Streaming decoder state for the size in a /api/roms/{id} response
+typedef struct {
+    bool sizeNext; // Next root-level value is "fs_size_bytes"
+    uint64_t sizeBytes;
+} RomSizeDecoder;
+
+static bool rom_size_event(void *ctx, JsonEvent event, const char *text, size_t len, int depth) {
+    RomSizeDecoder *dec = ctx;
+    (void)len;
+    if (depth != 1) return true;
+    if (event == JSON_EVENT_KEY) {
+        dec->sizeNext = strcmp(text, "fs_size_bytes") == 0;
+    } else if (event == JSON_EVENT_NUMBER && dec->sizeNext) {
+        dec->sizeBytes = strtoull(text, NULL, 10);
+    }
+    return true;
 }
 
-bool api_download_rom(int romId, const char *fileName, const char *destPath, DownloadProgressCb progressCb) {
-    char encodedName[256];
-    url_encode(fileName, encodedName, sizeof(encodedName));
-    char url[MAX_URL_LEN];
-    snprintf(url, sizeof(url), "%s/api/roms/%d/content/%s", baseUrl, romId, encodedName);
-
-    httpcContext context;
-    Result ret;
-
-    log_debug("GET %s", url);
-    log_debug("Saving to: %s", destPath);
+static void rom_size_restart(void *ctx) {
+    memset(ctx, 0, sizeof(RomSizeDecoder));
+}
 
-    ret = httpcOpenContext(&context, HTTPC_METHOD_GET, url, 1);
-    if (R_FAILED(ret)) {
-        log_error("httpcOpenContext failed: %08lX", ret);
-        return false;
-    }
+bool api_get_rom_size(int romId, uint64_t *sizeBytes) {
+    char url[MAX_URL_LEN];
+    snprintf(url, sizeof(url), "%s/api/roms/%d", baseUrl, romId);
 
-    setup_http_headers(&context, "*/*");
+    RomSizeDecoder dec;
+    memset(&dec, 0, sizeof(dec));
+    JsonStream js;
+    jsonstream_init(&js, rom_size_event, &dec);
+    if (!http_get_stream(url, &js, rom_size_restart) || dec.sizeBytes == 0) return false;
+    *sizeBytes = dec.sizeBytes;
+    return true;
+}
 
-    ret = httpcBeginRequest(&context);
-    if (R_FAILED(ret)) {
-        log_error("httpcBeginRequest failed: %08lX", ret);
-        httpcCloseContext(&context);
-        return false;
-    }
+void api_free_rom_detail(RomDetail *detail) {
+    if (detail) free(detail);
+}
 
-    // Handle redirects
-    u32 status;
-    ret = httpcGetResponseStatusCode(&context, &status);
-    if (R_FAILED(ret)) {
-        log_error("httpcGetResponseStatusCode failed: %08lX", ret);
-        httpcCloseContext(&context);
-        return false;
+// Send a download GET for [start, end) (end 0 = to the end of the file), following redirects; the Range is
+// repeated on every hop. finalUrl receives the URL that produced the response. Returns the open request with
+// *status set.
+static TransportRequest *begin_download(const char *url, uint32_t start, uint32_t end, const char *validator,
+                                        char *finalUrl, size_t finalUrlSize, int *status) {
+    snprintf(finalUrl, finalUrlSize, "%s", url);
+    log_debug("GET %s (from byte %lu)", url, (unsigned long)start);
+
+    TransportRequest *req = begin_get_range(url, "*/*", start, end, validator);
+    if (!req) return NULL;
+
+    *status = 0;
+    if (!transport_get_status(req, status)) {
+        log_error("Failed to read response status");
+        transport_close(req);
+        return NULL;
     }
 
-    while (status >= 300 && status < 400) {
+    while (*status >= 300 && *status < 400) {
         char newUrl[MAX_URL_LEN];
-        ret = httpcGetResponseHeader(&context, "Location", newUrl, sizeof(newUrl));
-        if (R_FAILED(ret)) {
+        if (!transport_get_header(req, "Location", newUrl, sizeof(newUrl))) {
             log_error("Failed to get redirect location");
-            httpcCloseContext(&context);
-            return false;
+            transport_close(req);
+            return NULL;
         }
 
-        log_debug("Redirect %lu -> %s", status, newUrl);
+        log_debug("Redirect %d -> %s", *status, newUrl);
 
-        httpcCloseContext(&context);
+        transport_close(req);
+        snprintf(finalUrl, finalUrlSize, "%s", newUrl);
 
-        ret = httpcOpenContext(&context, HTTPC_METHOD_GET, newUrl, 1);
-        if (R_FAILED(ret)) {
-            log_error("httpcOpenContext failed on redirect: %08lX", ret);
-            return false;
-        }
-
-        setup_http_headers(&context, "*/*");
+        req = begin_get_range(newUrl, "*/*", start, end, validator);
+        if (!req) return NULL;
 
-        ret = httpcBeginRequest(&context);
-        if (R_FAILED(ret)) {
-            log_error("httpcBeginRequest failed on redirect: %08lX", ret);
-            httpcCloseContext(&context);
-            return false;
+        if (!transport_get_status(req, status)) {
+            log_error("Failed to read response status");
+            transport_close(req);
+            return NULL;
         }
+    }
 
-        ret = httpcGetResponseStatusCode(&context, &status);
-        if (R_FAILED(ret)) {
-            log_error("httpcGetResponseStatusCode failed: %08lX", ret);
-            httpcCloseContext(&context);
-            return false;
-        }
+    log_debug("Status: %d", *status);
+    return req;
+}
+
+// Request the body from offset, trying the previously resolved URL first when resuming
+static TransportRequest *request_download(const char *apiUrl, const PartInfo *part, uint32_t offset, char *finalUrl,
+                                          size_t finalUrlSize, int *status) {
+    if (offset > 0 && part->url[0] != '\0' && strcmp(part->url, apiUrl) != 0) {
+        TransportRequest *req = begin_download(part->url, offset, 0, part->validator, finalUrl, finalUrlSize, status);
+        if (req && (*status == 200 || *status == 206)) return req;
+        // Resolved URLs may be short-lived (signed redirects); go back through the API
+        transport_close(req);
+        log_debug("Resolved URL rejected, retrying via API");
     }
+    return begin_download(apiUrl, offset, 0, offset > 0 ? part->validator : NULL, finalUrl, finalUrlSize, status);
+}
 
-    log_debug("Status: %lu", status);
+// Check that a 206 response continues exactly where the part file stops
+static bool range_matches(TransportRequest *req, uint32_t offset, uint32_t expectedTotal) {
+    char value[128];
+    if (!transport_get_header(req, "Content-Range", value, sizeof(value))) return false;
+
+    unsigned long start = 0;
+    char total[32] = "";
+    if (sscanf(value, "bytes %lu-%*u/%31s", &start, total) != 2) return false;
+    if (start != offset) return false;
+    if (expectedTotal > 0 && strcmp(total, "*") != 0 && strtoul(total, NULL, 10) != expectedTotal) return false;
+    return true;
+}
 
-    if (status != 200) {
-        log_error("HTTP error: %lu", status);
-        httpcCloseContext(&context);
-        return false;
+// Pick the value to send as If-Range on a later resume: a strong ETag, else Last-Modified
+static void read_validator(TransportRequest *req, char *validator, size_t validatorSize) {
+    validator[0] = '\0';
+    char value[128];
+    if (transport_get_header(req, "ETag", value, sizeof(value)) && strncmp(value, "W/", 2) != 0) {
+        snprintf(validator, validatorSize, "%s", value);
+    } else if (transport_get_header(req, "Last-Modified", value, sizeof(value))) {
+        snprintf(validator, validatorSize, "%s", value);
     }
+}
 
-    // Get content length for progress reporting
-    u32 contentLength = 0;
-    httpcGetDownloadSizeState(&context, NULL, &contentLength);
+typedef enum {
+    DOWNLOAD_OK,
+    DOWNLOAD_INTERRUPTED, // Network failure; the part file is worth keeping
+    DOWNLOAD_STALLED,     // Aborted by the watchdog; kept like an interruption
+    DOWNLOAD_FAILED,      // Local failure; discard the part file
+    DOWNLOAD_CANCELLED,
+} DownloadOutcome;
+
+// How a download stopped by its progress callback ends: cancelled by the user, or interrupted by shutdown
+static DownloadOutcome stop_outcome(void) {
+    if (atomic_load(&interrupting)) {
+        log_info("Download interrupted, keeping it for resume");
+        return DOWNLOAD_INTERRUPTED;
+    }
+    log_info("Download cancelled by user");
+    return DOWNLOAD_CANCELLED;
+}
 
-    // Open destination file
-    FILE *file = fopen(destPath, "wb");
-    if (!file) {
-        log_error("Failed to open file: %s (errno: %d)", destPath, errno);
-        httpcCloseContext(&context);
-        return false;
+// Read the next chunk of a download body, no faster than the download rate limit allows
+static TransportReadResult read_limited(TransportRequest *req, void *buffer, size_t size, size_t *bytesRead) {
+    size_t granted;
+    while ((granted = ratelimit_acquire(&downloadLimit, size)) == 0) {
     }
+    TransportReadResult result = transport_read(req, buffer, granted, bytesRead);
+    ratelimit_refund(&downloadLimit, granted - *bytesRead);
+    return result;
+}
 
-// Download in chunks and write to file
-#define DOWNLOAD_CHUNK_SIZE (64 * 1024)
-    u8 *buffer = malloc(DOWNLOAD_CHUNK_SIZE);
+// Account MD5 work done inline with a download, so its CPU cost shows up in the stats and log
+static void record_hash_time(uint32_t bytes, uint64_t micros) {
+    thread_mutex_lock(&statsLock);
+    stats.hashedBytes += bytes;
+    stats.hashMicros += micros;
+    thread_mutex_unlock(&statsLock);
+    log_debug("MD5: %lu bytes in %llu us (%.1f MB/s)", (unsigned long)bytes, (unsigned long long)micros,
+              micros > 0 ? bytes / (double)micros : 0.0);
+}
+
+// Hash the first length bytes of a file, for part files whose running MD5 wasn't saved
+static bool hash_file(const char *path, uint32_t length, Md5Context *md5) {
+    md5_init(md5);
+    FILE *file = fopen(path, "rb");
+    if (!file) return false;
+    uint8_t *buffer = malloc(downloadChunkSize);
     if (!buffer) {
-        log_error("Failed to allocate download buffer");
         fclose(file);
-        httpcCloseContext(&context);
         return false;
     }
 
-    u32 totalDownloaded = 0;
-    bool success = true;
+    uint64_t start = transport_now_us();
+    uint32_t remaining = length;
+    while (remaining > 0) {
+        size_t want = remaining < downloadChunkSize ? remaining : downloadChunkSize;
+        size_t got = fread(buffer, 1, want, file);
+        if (got == 0) break;
+        md5_update(md5, buffer, got);
+        remaining -= got;
+    }
+    free(buffer);
+    fclose(file);
+    log_debug("Re-read %lu bytes to rebuild MD5 in %llu ms", (unsigned long)(length - remaining),
+              (unsigned long long)((transport_now_us() - start) / 1000));
+    return remaining == 0;
+}
+
+// Consumer side of a single-stream download: the part file or a caller's sink. With a ring deeper
+// than one buffer it runs on its own thread, so writing one chunk overlaps the network read of the next.
+typedef struct {
+    ChunkRing ring;
+    FileSink *file; // Part file, or NULL when streaming to sink
+    const char *destPath;
+    PartInfo *part;
+    DownloadSinkCb sink;
+    void *sinkCtx;
+    Md5Context *md5;  // Hashed as each buffer is consumed, or NULL
+    uint32_t written; // Total bytes consumed, including the resume offset
+    bool writeError;  // Read by the reader only after the writer stopped
+    uint64_t hashMicros;
+    ThreadHandle *thread;
+} DownloadWriter;
+
+// Consume the next buffer from the ring. Returns false once the ring is drained or a write failed.
+static bool writer_step(DownloadWriter *w) {
+    size_t len = 0;
+    const uint8_t *data = chunkring_peek(&w->ring, &len);
+    if (!data) return false;
+
+    if (w->md5) {
+        uint64_t start = transport_now_us();
+        md5_update(w->md5, data, len);
+        w->hashMicros += transport_now_us() - start;
+    }
+
+    bool ok;
+    if (w->sink) {
+        ok = w->sink(w->sinkCtx, data, len);
+    } else {
+        ok = filesink_write(w->file, data, len);
+    }
+    if (!ok) {
+        w->writeError = true;
+        chunkring_abort(&w->ring);
+        return false;
+    }
+    w->written += len;
+    chunkring_release(&w->ring);
+
+    if (w->file && w->written - w->part->bytesWritten >= PART_SYNC_INTERVAL && filesink_flush(w->file)) {
+        w->part->bytesWritten = w->written;
+        partfile_save(w->destPath, w->part);
+    }
+    return true;
+}
+
+static void writer_main(void *arg) {
+    DownloadWriter *w = arg;
+    while (writer_step(w)) {
+    }
+}
+
+// Read the response body through the writer's ring and close the request. offset is where the body
+// starts within the file, totalSize the full size (0 if unknown) for progress.
+static DownloadOutcome pump_body(TransportRequest *req, DownloadWriter *writer, uint32_t offset, uint32_t totalSize,
+                                 DownloadProgressCb progressCb) {
+    writer->written = offset;
+    if (!chunkring_init(&writer->ring, downloadRingDepth, downloadChunkSize)) {
+        log_error("Failed to allocate download buffers");
+        transport_close(req);
+        return DOWNLOAD_FAILED;
+    }
+    writer->thread = NULL;
+    if (downloadRingDepth > 1) {
+        writer->thread = thread_start(writer_main, writer, WRITER_STACK_SIZE);
+        if (!writer->thread) log_warn("Failed to start writer thread, writing inline");
+    }
+
+    uint32_t totalDownloaded = offset;
+    DownloadOutcome outcome = DOWNLOAD_OK;
+    StallWatch watch;
+    watchdog_start(&watch, req);
 
     while (true) {
-        u32 bytesRead = 0;
-        ret = httpcDownloadData(&context, buffer, DOWNLOAD_CHUNK_SIZE, &bytesRead);
+        uint8_t *buffer = chunkring_acquire(&writer->ring);
+        if (!buffer) {
+            // The writer hit an error and aborted the ring
+            outcome = DOWNLOAD_FAILED;
+            break;
+        }
+
+        size_t bytesRead = 0;
+        TransportReadResult result = read_limited(req, buffer, downloadChunkSize, &bytesRead);
 
         if (bytesRead > 0) {
-            size_t written = fwrite(buffer, 1, bytesRead, file);
-            if (written != bytesRead) {
-                log_error("Failed to write to file");
-                success = false;
+            watchdog_progress(&watch);
+            chunkring_publish(&writer->ring, bytesRead);
+            if (!writer->thread && !writer_step(writer)) {
+                outcome = DOWNLOAD_FAILED;
                 break;
             }
             totalDownloaded += bytesRead;
+
             if (progressCb) {
-                if (!progressCb(totalDownloaded, contentLength)) {
-                    log_info("Download cancelled by user");
-                    success = false;
+                if (!progressCb(totalDownloaded, totalSize)) {
+                    outcome = stop_outcome();
                     break;
                 }
             }
         }
 
-        if (ret == HTTPC_RESULTCODE_DOWNLOADPENDING) {
+        if (result == TRANSPORT_READ_MORE) {
             continue;
-        } else if (R_FAILED(ret)) {
-            log_error("httpcDownloadData failed: %08lX", ret);
-            success = false;
+        } else if (result == TRANSPORT_READ_ERROR) {
+            log_error("Failed to read download data");
+            outcome = DOWNLOAD_INTERRUPTED;
             break;
         } else {
             // Download complete
             break;
         }
     }
+    if (watch_stop(&watch) && outcome == DOWNLOAD_INTERRUPTED) outcome = DOWNLOAD_STALLED;
+    transport_close(req);
+
+    // Let the writer drain what was received (worth keeping even after a network error) unless cancelled
+    if (outcome == DOWNLOAD_CANCELLED) {
+        chunkring_abort(&writer->ring);
+    } else {
+        chunkring_close(&writer->ring);
+    }
+    if (writer->thread) thread_join(writer->thread);
+    chunkring_free(&writer->ring);
+    if (writer->writeError) outcome = DOWNLOAD_FAILED;
+
+    log_debug("Downloaded %lu bytes", (unsigned long)(writer->written - offset));
+    if (writer->md5) record_hash_time(writer->written - offset, writer->hashMicros);
+
+    if (outcome == DOWNLOAD_OK && totalSize > 0 && writer->written != totalSize) {
+        log_error("Download truncated: %lu of %lu bytes", (unsigned long)writer->written, (unsigned long)totalSize);
+        outcome = DOWNLOAD_INTERRUPTED;
+    }
+    return outcome;
+}
+
+// The part file has been preallocated and now holds the space the caller claimed for it; stop counting it twice
+static void release_claim(uint64_t *claim) {
+    if (!claim) return;
+    storage_release(*claim);
+    *claim = 0;
+}
+
+// Stream the whole response body into the part file over one connection
+static DownloadOutcome download_single(TransportRequest *req, const char *destPath, PartInfo *part, uint32_t offset,
+                                       uint64_t *claim, DownloadProgressCb progressCb) {
+    char partPath[MAX_URL_LEN];
+    partfile_path(destPath, partPath, sizeof(partPath));
+    FileSink *file = filesink_open(partPath, offset > 0, offset);
+    if (!file) {
+        transport_close(req);
+        return DOWNLOAD_FAILED;
+    }
+    // Filled in place; the sidecar, not the file length, records how much of it is valid
+    if (part->totalSize > 0 && storage_preallocate(file, part->totalSize)) release_claim(claim);
+    partfile_save(destPath, part);
+
+    DownloadWriter writer = {.file = file, .destPath = destPath, .part = part, .md5 = part->hasMd5 ? &part->md5 : NULL};
+    DownloadOutcome outcome = pump_body(req, &writer, offset, part->totalSize, progressCb);
+
+    if (!filesink_close(file) && outcome != DOWNLOAD_CANCELLED) outcome = DOWNLOAD_FAILED;
+    // Everything written so far is on disk now that the file is closed
+    part->bytesWritten = writer.written;
+    return outcome;
+}
+
+// One byte range of a segmented download, fetched on its own connection and thread
+typedef struct SegmentedDownload SegmentedDownload;
+
+typedef struct {
+    SegmentedDownload *dl;
+    ThreadHandle *thread;
+    TransportRequest *req; // Already open for the first segment; opened by the worker otherwise
+    uint32_t start;
+    uint32_t end;     // Exclusive
+    uint32_t done;    // Bytes written, guarded by dl->lock
+    uint32_t flushed; // Bytes written and flushed, guarded by dl->lock
+    bool finished;
+    bool writeError;
+    bool stalled; // The last attempt was aborted by the watchdog
+} DownloadSegment;
+
+struct SegmentedDownload {
+    char partPath[MAX_URL_LEN];
+    const PartInfo *part;
+    ThreadMutex lock;
+    volatile bool cancel;
+    DownloadSegment segments[MAX_DOWNLOAD_SEGMENTS];
+    int count;
+};
+
+// Fetch the rest of a segment's range, from where an earlier attempt stopped. cause says why it didn't finish.
+static void segment_transfer(DownloadSegment *seg, RetryCause *cause) {
+    SegmentedDownload *dl = seg->dl;
+    uint32_t length = seg->end - seg->start;
+    uint32_t done = seg->done;
+    cause->reason = RETRY_FATAL;
+    cause->retryAfterMs = 0;
+
+    if (!seg->req) {
+        char finalUrl[MAX_URL_LEN];
+        int status = 0;
+        seg->req = begin_download(dl->part->url, seg->start + done, seg->end, dl->part->validator, finalUrl,
+                                  sizeof(finalUrl), &status);
+        if (!seg->req) {
+            cause->reason = RETRY_CONNECT;
+            return;
+        }
+        if (status != 206 || !range_matches(seg->req, seg->start + done, dl->part->totalSize)) {
+            log_error("Segment at %lu: unexpected response (status %d)", (unsigned long)(seg->start + done), status);
+            classify_status(seg->req, status, cause);
+            return;
+        }
+    }
+
+    FileSink *file = filesink_open(dl->partPath, true, seg->start + done);
+    uint8_t *buffer = malloc(downloadChunkSize);
+    if (!file || !buffer) {
+        filesink_close(file);
+        free(buffer);
+        seg->writeError = true;
+        return;
+    }
+
+    StallWatch watch;
+    watchdog_start(&watch, seg->req);
+    uint32_t lastFlush = done;
+    while (done < length && !dl->cancel) {
+        size_t want = length - done < downloadChunkSize ? length - done : downloadChunkSize;
+        size_t bytesRead = 0;
+        TransportReadResult result = read_limited(seg->req, buffer, want, &bytesRead);
+
+        if (bytesRead > 0) {
+            watchdog_progress(&watch);
+            if (!filesink_write(file, buffer, bytesRead)) {
+                seg->writeError = true;
+                break;
+            }
+            done += bytesRead;
+            bool flushed = done - lastFlush >= PART_SYNC_INTERVAL && filesink_flush(file);
+            if (flushed) lastFlush = done;
+
+            thread_mutex_lock(&dl->lock);
+            seg->done = done;
+            if (flushed) seg->flushed = done;
+            thread_mutex_unlock(&dl->lock);
+        }
+
+        if (result == TRANSPORT_READ_ERROR) {
+            log_error("Segment at %lu: read failed", (unsigned long)seg->start);
+            cause->reason = RETRY_DROPPED;
+            break;
+        }
+        if (result == TRANSPORT_READ_DONE) break;
+    }
+    seg->stalled = watch_stop(&watch);
+    if (seg->stalled) cause->reason = RETRY_TIMEOUT;
 
     free(buffer);
-    fclose(file);
-    httpcCloseContext(&context);
+    bool closed = filesink_close(file);
+    thread_mutex_lock(&dl->lock);
+    if (closed) seg->flushed = done;
+    thread_mutex_unlock(&dl->lock);
+}
 
-    log_debug("Downloaded %lu bytes", totalDownloaded);
+// Fetch a segment, retrying from where each attempt stopped so one bad connection doesn't cost the others'
+// progress
+static void segment_worker(void *arg) {
+    DownloadSegment *seg = arg;
+    SegmentedDownload *dl = seg->dl;
+    Retry retry;
+    retry_init(&retry, &downloadRetry);
+
+    while (true) {
+        uint32_t before = seg->done;
+        RetryCause cause;
+        segment_transfer(seg, &cause);
+        transport_close(seg->req);
+        seg->req = NULL;
+
+        // Unflushed bytes of a failed close can't be trusted; the next attempt starts at what reached the card
+        thread_mutex_lock(&dl->lock);
+        seg->done = seg->flushed;
+        thread_mutex_unlock(&dl->lock);
+
+        uint32_t delayMs;
+        if (seg->done == seg->end - seg->start || seg->writeError || dl->cancel) break;
+        if (seg->done > before) retry_progress(&retry);
+        if (!retry_next(&retry, &cause, &delayMs) || !wait_for_retry(delayMs, NULL, &dl->cancel)) break;
+    }
+
+    thread_mutex_lock(&dl->lock);
+    seg->finished = true;
+    thread_mutex_unlock(&dl->lock);
+}
+
+// End of the flushed data that runs unbroken from the first segment; the part file is valid up to here
+static uint32_t segments_contiguous(const SegmentedDownload *dl) {
+    uint32_t end = dl->segments[0].start;
+    for (int i = 0; i < dl->count; i++) {
+        const DownloadSegment *seg = &dl->segments[i];
+        end = seg->start + seg->flushed;
+        if (seg->flushed < seg->end - seg->start) break;
+    }
+    return end;
+}
 
-    // If download failed, remove partial file
-    if (!success) {
-        remove(destPath);
+// Fetch the rest of the file as parallel byte ranges into a preallocated part file. The already open request
+// becomes the first segment; the others open their own connections. Progress is merged here on the calling
+// thread, so progressCb never runs on a worker.
+static DownloadOutcome download_segmented(TransportRequest *req, const char *destPath, PartInfo *part,
+                                          uint32_t offset, int count, uint64_t *claim, DownloadProgressCb progressCb) {
+    SegmentedDownload *dl = calloc(1, sizeof(SegmentedDownload));
+    if (!dl) {
+        transport_close(req);
+        return DOWNLOAD_FAILED;
     }
+    partfile_path(destPath, dl->partPath, sizeof(dl->partPath));
+    dl->part = part;
+    dl->count = count;
+    thread_mutex_init(&dl->lock);
+
+    // Size the file up front so every segment can write at its own offset
+    FileSink *file = filesink_open(dl->partPath, offset > 0, 0);
+    if (!file || !storage_preallocate(file, part->totalSize)) {
+        log_error("Failed to preallocate %s", dl->partPath);
+        filesink_close(file);
+        transport_close(req);
+        free(dl);
+        return DOWNLOAD_FAILED;
+    }
+    filesink_close(file);
+    release_claim(claim);
+    partfile_save(destPath, part);
+
+    uint32_t segmentSize = (part->totalSize - offset) / count;
+    for (int i = 0; i < count; i++) {
+        DownloadSegment *seg = &dl->segments[i];
+        seg->dl = dl;
+        seg->start = offset + i * segmentSize;
+        seg->end = i == count - 1 ? part->totalSize : seg->start + segmentSize;
+    }
+    dl->segments[0].req = req;
+
+    log_info("Downloading %lu bytes in %d segments", (unsigned long)(part->totalSize - offset), count);
+
+    for (int i = 0; i < count; i++) {
+        DownloadSegment *seg = &dl->segments[i];
+        seg->thread = thread_start(segment_worker, seg, THREAD_DEFAULT_STACK_SIZE);
+        if (!seg->thread) {
+            // Leave the range undone; a later resume picks it up
+            transport_close(seg->req);
+            seg->req = NULL;
+            seg->finished = true;
+        }
+    }
+
+    while (true) {
+        thread_mutex_lock(&dl->lock);
+        bool allFinished = true;
+        uint32_t downloaded = offset;
+        for (int i = 0; i < count; i++) {
+            allFinished = allFinished && dl->segments[i].finished;
+            downloaded += dl->segments[i].done;
+        }
+        uint32_t contiguous = segments_contiguous(dl);
+        thread_mutex_unlock(&dl->lock);
+
+        if (allFinished) break;
+
+        if (contiguous - part->bytesWritten >= PART_SYNC_INTERVAL) {
+            part->bytesWritten = contiguous;
+            partfile_save(destPath, part);
+        }
+        if (progressCb && !dl->cancel && !progressCb(downloaded, part->totalSize)) dl->cancel = true;
+        thread_sleep_ms(SEGMENT_POLL_MS);
+    }
+
+    for (int i = 0; i < count; i++) thread_join(dl->segments[i].thread);
+
+    DownloadOutcome outcome = DOWNLOAD_OK;
+    for (int i = 0; i < count; i++) {
+        const DownloadSegment *seg = &dl->segments[i];
+        if (seg->writeError) outcome = DOWNLOAD_FAILED;
+        if (outcome == DOWNLOAD_OK && seg->flushed != seg->end - seg->start) {
+            outcome = seg->stalled ? DOWNLOAD_STALLED : DOWNLOAD_INTERRUPTED;
+        }
+    }
+    if (dl->cancel) outcome = stop_outcome();
+    part->bytesWritten = segments_contiguous(dl);
+
+    log_debug("Downloaded %lu bytes in %d segments", (unsigned long)(part->bytesWritten - offset), count);
+    free(dl);
+    return outcome;
+}
+
+static void build_content_url(int romId, const char *fileName, char *url, size_t urlSize) {
+    char encodedName[256];
+    url_encode(fileName, encodedName, sizeof(encodedName));
+    snprintf(url, urlSize, "%s/api/roms/%d/content/%s", baseUrl, romId, encodedName);
+}
+
+// One attempt at api_download_rom() once it holds a connection. On failure cause says whether another attempt
+// could succeed; progress made before it failed is reported to retry.
+static bool download_rom(int romId, const char *fileName, const char *destPath, DownloadProgressCb progressCb,
+                         char *md5Out, uint64_t *claim, Retry *retry, RetryCause *cause) {
+    cause->reason = RETRY_CONNECT;
+    cause->retryAfterMs = 0;
+    char url[MAX_URL_LEN];
+    build_content_url(romId, fileName, url, sizeof(url));
+
+    log_debug("Saving to: %s", destPath);
+
+    // Continue an earlier attempt if its part file survived
+    PartInfo part;
+    uint32_t offset = 0;
+    if (partfile_load(destPath, &part)) {
+        offset = part.bytesWritten;
+        log_info("Resuming download at %lu bytes", (unsigned long)offset);
+    }
+
+    char finalUrl[MAX_URL_LEN];
+    int status = 0;
+    TransportRequest *req = request_download(url, &part, offset, finalUrl, sizeof(finalUrl), &status);
+    if (!req) return false;
+
+    if (offset > 0 && (status == 416 || (status == 206 && !range_matches(req, offset, part.totalSize)))) {
+        // The server can't continue this part file; start over
+        log_info("Cannot resume (status %d), restarting download", status);
+        transport_close(req);
+        partfile_discard(destPath);
+        offset = 0;
+        memset(&part, 0, sizeof(part));
+        req = request_download(url, &part, 0, finalUrl, sizeof(finalUrl), &status);
+        if (!req) return false;
+    }
+
+    if (status == 200 && offset > 0) {
+        // Resource changed (If-Range failed) or ranges unsupported: the full body follows
+        log_info("Server sent the full file, restarting download");
+        offset = 0;
+    }
+
+    if (status != 200 && !(status == 206 && offset > 0)) {
+        log_error("HTTP error: %d", status);
+        classify_status(req, status, cause);
+        transport_close(req);
+        return false;
+    }
+    // Local failures from here on are final; network ones are set below
+    cause->reason = RETRY_FATAL;
+
+    // Get content length for progress reporting
+    uint32_t contentLength = transport_get_content_length(req);
+    uint32_t totalSize = contentLength > 0 ? offset + contentLength : 0;
+
+    // Callers claim space from the size they expect; refuse a body that can't fit in any case. Only growth
+    // counts: a part file already takes its length, the whole file once preallocated, and is reused or replaced.
+    // An earlier part file is kept so the download can continue once there is room.
+    uint64_t allocated = partfile_allocated(destPath);
+    uint64_t needed = totalSize > allocated ? totalSize - allocated : 0;
+    uint64_t freeBytes;
+    if (needed > 0 && storage_free_bytes(destPath, &freeBytes) && freeBytes < needed + STORAGE_HEADROOM) {
+        log_error("Not enough free space: %llu more bytes needed, %llu free", (unsigned long long)needed,
+                  (unsigned long long)freeBytes);
+        transport_close(req);
+        return false;
+    }
+
+    part.bytesWritten = offset;
+    part.totalSize = totalSize;
+    read_validator(req, part.validator, sizeof(part.validator));
+    snprintf(part.url, sizeof(part.url), "%s", finalUrl);
+
+    // Split into ranges only when the server supports them and the rest of the file is big enough
+    int segments = 1;
+    char acceptRanges[32];
+    bool rangesOk = status == 206 || (transport_get_header(req, "Accept-Ranges", acceptRanges, sizeof(acceptRanges)) &&
+                                      strstr(acceptRanges, "bytes"));
+    if (downloadSegments > 1 && totalSize > 0 && rangesOk) {
+        uint32_t maxSegments = contentLength / SEGMENT_MIN_SIZE;
+        segments = maxSegments < (uint32_t)downloadSegments ? (int)maxSegments : downloadSegments;
+        if (segments < 1) segments = 1;
+    }
+    // Each extra segment is another connection; use only those other downloads aren't holding
+    int extraConnections = segments > 1 ? connection_try_acquire(segments - 1) : 0;
+    if (segments > 1 && extraConnections < segments - 1) {
+        log_debug("Connection limit allows %d of %d segments", extraConnections + 1, segments);
+    }
+    segments = extraConnections + 1;
+
+    // Single streams hash each chunk as it is written, continuing the MD5 saved with the part file.
+    // Segments arrive out of order, so a segmented download is hashed from the card once complete.
+    char partPath[MAX_URL_LEN];
+    partfile_path(destPath, partPath, sizeof(partPath));
+    bool hashInline = md5Out && segments == 1;
+    if (offset == 0 || !hashInline) {
+        part.hasMd5 = hashInline;
+        md5_init(&part.md5);
+    } else if (!part.hasMd5) {
+        part.hasMd5 = hash_file(partPath, offset, &part.md5);
+    }
+
+    DownloadOutcome outcome;
+    if (segments > 1) {
+        outcome = download_segmented(req, destPath, &part, offset, segments, claim, progressCb);
+        connection_release(extraConnections);
+    } else {
+        outcome = download_single(req, destPath, &part, offset, claim, progressCb);
+    }
+
+    if (outcome == DOWNLOAD_OK) {
+        if (md5Out) {
+            if (!part.hasMd5) {
+                uint64_t start = transport_now_us();
+                if (!hash_file(partPath, part.bytesWritten, &part.md5)) {
+                    log_error("Failed to hash %s", partPath);
+                    partfile_discard(destPath);
+                    return false;
+                }
+                record_hash_time(part.bytesWritten, transport_now_us() - start);
+            }
+            md5_final_hex(&part.md5, md5Out);
+        }
+        return partfile_commit(destPath);
+    }
+
+    if (outcome == DOWNLOAD_INTERRUPTED || outcome == DOWNLOAD_STALLED) {
+        cause->reason = outcome == DOWNLOAD_STALLED ? RETRY_TIMEOUT : RETRY_DROPPED;
+        if (part.bytesWritten > offset) retry_progress(retry);
+        if (part.bytesWritten > 0 && partfile_save(destPath, &part)) {
+            log_info("Kept %lu bytes for resume", (unsigned long)part.bytesWritten);
+            return false;
+        }
+    }
+    partfile_discard(destPath);
+    return false;
+}
+
+bool api_download_rom(int romId, const char *fileName, const char *destPath, DownloadProgressCb progressCb,
+                      char *md5Out, uint64_t *claim) {
+    if (!connection_acquire(progressCb)) return false;
+    Retry retry;
+    retry_init(&retry, &downloadRetry);
+    RetryCause cause;
+    uint32_t delayMs;
+    bool ok;
+    while (!(ok = download_rom(romId, fileName, destPath, progressCb, md5Out, claim, &retry, &cause)) &&
+           !atomic_load(&interrupting) && retry_next(&retry, &cause, &delayMs) &&
+           wait_for_retry(delayMs, progressCb, NULL)) {
+    }
+    connection_release(1);
+    return ok;
+}
+
+// api_stream_rom() once it holds a connection. The sink can't take a body twice, so only failures before it
+// starts are retried.
+static bool stream_rom(int romId, const char *fileName, DownloadSinkCb sink, void *ctx, DownloadProgressCb progressCb,
+                       char *md5Out) {
+    char url[MAX_URL_LEN];
+    build_content_url(romId, fileName, url, sizeof(url));
+
+    Retry retry;
+    retry_init(&retry, &downloadRetry);
+    TransportRequest *req;
+    while (true) {
+        char finalUrl[MAX_URL_LEN];
+        int status = 0;
+        RetryCause cause = {RETRY_CONNECT, 0};
+        req = begin_download(url, 0, 0, NULL, finalUrl, sizeof(finalUrl), &status);
+        if (req && status == 200) break;
+        if (req) {
+            log_error("HTTP error: %d", status);
+            classify_status(req, status, &cause);
+            transport_close(req);
+        }
+        uint32_t delayMs;
+        if (!retry_next(&retry, &cause, &delayMs) || !wait_for_retry(delayMs, progressCb, NULL)) return false;
+    }
+
+    Md5Context md5;
+    md5_init(&md5);
+    DownloadWriter writer = {.sink = sink, .sinkCtx = ctx, .md5 = md5Out ? &md5 : NULL};
+    if (pump_body(req, &writer, 0, transport_get_content_length(req), progressCb) != DOWNLOAD_OK) return false;
+    if (md5Out) md5_final_hex(&md5, md5Out);
+    return true;
+}
 
-    return success;
+bool api_stream_rom(int romId, const char *fileName, DownloadSinkCb sink, void *ctx, DownloadProgressCb progressCb,
+                    char *md5Out) {
+    if (!connection_acquire(progressCb)) return false;
+    bool ok = stream_rom(romId, fileName, sink, ctx, progressCb, md5Out);
+    connection_release(1);
+    return ok;
 }
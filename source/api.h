@@ -6,6 +6,7 @@
 #define API_H
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 // Platform data from /api/platforms
@@ -23,6 +24,8 @@ typedef struct {
     int platformId;
     char name[256];
     char fsName[256];
+    char md5Hash[64];
+    uint64_t sizeBytes; // 0 if the server didn't report it
 } Rom;
 
 // Detailed ROM data from /api/roms/{id}
@@ -35,20 +38,83 @@ typedef struct {
     char platformName[128];
     char firstReleaseDate[32];
     char md5Hash[64];
+    uint64_t sizeBytes;
 } RomDetail;
 
+// Counters for diagnostics and tuning, accumulated since startup
+typedef struct {
+    uint32_t responseReallocs; // Times a JSON response buffer had to grow
+    size_t largestResponse;    // Largest JSON response body seen, in bytes
+    uint32_t jsonAllocs;       // cJSON node/string allocations served by the arena
+    size_t jsonArenaHighWater; // Peak bytes a single cJSON tree needed from the arena
+    uint64_t hashedBytes;      // Download bytes run through MD5
+    uint64_t hashMicros;       // Time spent hashing them
+    uint64_t throttledMs;      // Time download reads waited on the rate limit
+    uint64_t jsonWireBytes;    // JSON response bytes received, compressed or not
+    uint64_t jsonBodyBytes;    // The same responses after decoding
+    uint32_t retries;          // Failed requests and transfers tried again
+    uint32_t stalls;           // Transfers aborted for receiving nothing within the stall timeout
+    uint32_t offlineSkips;     // Requests not sent because the server was known to be unreachable
+    uint32_t offlineHits;      // JSON requests answered from the response cache while offline
+    uint32_t coalesceHits;     // JSON requests that got the body of an identical one already in flight
+    uint32_t coalesceMisses;   // JSON requests that had to be made themselves
+} ApiStats;
+
 // Initialize API module
 void api_init(void);
 
 // Cleanup API module
 void api_exit(void);
 
+// Copy the current API counters into out
+void api_get_stats(ApiStats *out);
+
+// Set the hard cap for a single JSON response body (0 restores the default)
+void api_set_max_response_size(size_t maxBytes);
+
+// Split large downloads into this many parallel byte ranges when the server supports ranges (1 = off, max 8)
+void api_set_download_segments(int segments);
+
+// Buffers passed from the network reader to the file writer thread, and their size. depth 1 writes
+// inline after each read (max 16); chunkSize 0 keeps the 64KB default.
+void api_set_download_buffers(int depth, size_t chunkSize);
+
+// Cap the download connections open to the server at once, across concurrent downloads and their
+// segments (default 4, max 16). Downloads wait for a free connection; extra segments are skipped.
+void api_set_max_connections(int connections);
+
+// Ask for gzip/deflate JSON responses and inflate them as they stream in (default on)
+void api_set_json_compression(bool enabled);
+
+// Cap the combined read rate of all downloads and their segments (0 = unlimited, the default)
+void api_set_download_rate(uint32_t bytesPerSecond);
+
+// Rate downloads drop to while a JSON request is in flight, so browsing isn't starved (0 = don't back off)
+void api_set_download_backoff(uint32_t bytesPerSecond);
+
+// Retry a failed download, or a failed segment of one, this many times in a row before giving up (default 6).
+// Any progress starts the count over. Browsing requests have their own short fixed policy.
+void api_set_download_retries(int retries);
+
+// Abort a transfer that receives nothing for this long and retry it from where it stopped (0 = never,
+// default 20s)
+void api_set_stall_timeout(uint32_t ms);
+
+// Give up on a request that can't connect within connectMs, or gets no response headers within responseMs after
+// that (0 = wait as long as the backend does; defaults 5s and 15s). Body reads are covered by the stall timeout.
+// The first request to fail this way marks the server offline until a background probe gets an answer.
+void api_set_timeouts(uint32_t connectMs, uint32_t responseMs);
+
 // Set base URL for API requests
 void api_set_base_url(const char *url);
 
-// Set authentication credentials (HTTP Basic Auth)
+// Set authentication credentials. They are exchanged for an access token on the next request, or sent
+// as HTTP Basic Auth if token auth is off or the server doesn't support it.
 void api_set_auth(const char *username, const char *password);
 
+// Exchange credentials for an access token instead of sending them with every request (default on)
+void api_set_token_auth(bool enabled);
+
 // Fetch platforms from server
 // Returns array of platforms, sets count. Caller must free with api_free_platforms
 Platform *api_get_platforms(int *count);
@@ -76,6 +142,10 @@ RomDetail *api_get_rom_detail(int romId);
 // Free ROM detail
 void api_free_rom_detail(RomDetail *detail);
 
+// Fetch just the file size of a ROM. Unlike the other lookups this may run off the main thread (the response is
+// stream-parsed, without cJSON). Returns false if it failed or the server doesn't know the size.
+bool api_get_rom_size(int romId, uint64_t *sizeBytes);
+
 // Progress callback for downloads (bytesDownloaded, totalBytes; total may be 0 if unknown)
 // Return true to continue, false to cancel
 typedef bool (*DownloadProgressCb)(uint32_t bytesDownloaded, uint32_t totalBytes);
@@ -83,7 +153,24 @@ typedef bool (*DownloadProgressCb)(uint32_t bytesDownloaded, uint32_t totalBytes
 // Download a ROM file to the specified path
 // fileName is the fs_name from the ROM detail (used in URL path)
 // progressCb is called periodically with download progress (may be NULL)
+// md5Out (MD5_HEX_LEN bytes, may be NULL) receives the file's MD5, hashed as it is written
+// claim (may be NULL) is free space the caller reserved for the file: it is released, and set to 0, once the
+// part file is preallocated and holds that space itself
 // Returns true on success, false on failure
-bool api_download_rom(int romId, const char *fileName, const char *destPath, DownloadProgressCb progressCb);
+bool api_download_rom(int romId, const char *fileName, const char *destPath, DownloadProgressCb progressCb,
+                      char *md5Out, uint64_t *claim);
+
+// Treat every later cancel from a download's progress callback as an interruption: the part file is kept for
+// resume instead of deleted. Call before stopping downloads at exit.
+void api_interrupt_downloads(void);
+
+// Receives a streamed download in order. Return false to abort the transfer.
+typedef bool (*DownloadSinkCb)(void *ctx, const uint8_t *data, size_t len);
+
+// Stream a ROM file into sink instead of a file. Nothing is kept for resume.
+// md5Out (may be NULL) receives the MD5 of the whole body.
+// Returns true if the whole body was delivered; false on network error, sink abort or cancel.
+bool api_stream_rom(int romId, const char *fileName, DownloadSinkCb sink, void *ctx, DownloadProgressCb progressCb,
+                    char *md5Out);
 
 #endif // API_H
@@ -0,0 +1,86 @@
+/*
+ * Arena module - Bump allocator for short-lived, same-lifetime allocations
+ */
+
+#include "arena.h"
+#include <stdlib.h>
+
+#define ARENA_ALIGN 8
+
+struct ArenaChunk {
+    ArenaChunk *next;
+    size_t size;
+    size_t offset;
+    // Allocations follow the header
+};
+
+#define CHUNK_HEADER_SIZE ((sizeof(ArenaChunk) + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1))
+
+static ArenaChunk *chunk_new(size_t size) {
+    ArenaChunk *chunk = malloc(CHUNK_HEADER_SIZE + size);
+    if (!chunk) return NULL;
+    chunk->next = NULL;
+    chunk->size = size;
+    chunk->offset = 0;
+    return chunk;
+}
+
+void arena_init(Arena *arena, size_t chunkSize) {
+    arena->first = NULL;
+    arena->current = NULL;
+    arena->chunkSize = chunkSize;
+    arena->used = 0;
+    arena->highWater = 0;
+    arena->allocs = 0;
+    arena->overflow = 0;
+}
+
+void *arena_alloc(Arena *arena, size_t size) {
+    size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+
+    ArenaChunk *chunk = arena->current;
+    if (!chunk || chunk->offset + size > chunk->size) {
+        ArenaChunk *next = chunk_new(size > arena->chunkSize ? size : arena->chunkSize);
+        if (!next) return NULL;
+        if (!arena->first) {
+            arena->first = next;
+        } else {
+            chunk->next = next;
+            arena->overflow++;
+        }
+        arena->current = next;
+        chunk = next;
+    }
+
+    void *ptr = (char *)chunk + CHUNK_HEADER_SIZE + chunk->offset;
+    chunk->offset += size;
+    arena->used += size;
+    arena->allocs++;
+    if (arena->used > arena->highWater) arena->highWater = arena->used;
+    return ptr;
+}
+
+void arena_reset(Arena *arena) {
+    if (!arena->first) return;
+
+    // Overflow chunks only exist after an unusually large response; drop them
+    ArenaChunk *chunk = arena->first->next;
+    while (chunk) {
+        ArenaChunk *next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    arena->first->next = NULL;
+    arena->first->offset = 0;
+    arena->current = arena->first;
+    arena->used = 0;
+    arena->allocs = 0;
+    arena->overflow = 0;
+}
+
+void arena_free(Arena *arena) {
+    arena_reset(arena);
+    free(arena->first);
+    arena->first = NULL;
+    arena->current = NULL;
+}
@@ -0,0 +1,35 @@
+/*
+ * Arena module - Bump allocator for short-lived, same-lifetime allocations
+ */
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct ArenaChunk ArenaChunk;
+
+typedef struct {
+    ArenaChunk *first;   // Kept across resets so steady-state use never touches the heap
+    ArenaChunk *current; // Chunk currently being bumped
+    size_t chunkSize;
+    size_t used;       // Bytes handed out since the last reset
+    size_t highWater;  // Largest value of used ever reached
+    uint32_t allocs;   // Allocations since the last reset
+    uint32_t overflow; // Extra chunks allocated since the last reset
+} Arena;
+
+// Prepare an arena that grows in chunks of chunkSize bytes (nothing is allocated yet)
+void arena_init(Arena *arena, size_t chunkSize);
+
+// Allocate size bytes (8-byte aligned). Returns NULL if out of memory.
+void *arena_alloc(Arena *arena, size_t size);
+
+// Release every allocation at once. The first chunk is kept for reuse.
+void arena_reset(Arena *arena);
+
+// Free all memory owned by the arena
+void arena_free(Arena *arena);
+
+#endif // ARENA_H
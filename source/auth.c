@@ -0,0 +1,320 @@
+/*
+ * Auth module - Authorization header for RomM requests
+ */
+
+#include "auth.h"
+#include "log.h"
+#include "thread.h"
+#include "transport.h"
+#include "jsonstream.h"
+#include "jsonfields.h"
+#include "reachability.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define AUTH_FORM_LEN (AUTH_TOKEN_LEN + 512)
+#define AUTH_URL_LEN 512
+#define AUTH_CREDENTIAL_LEN 128
+#define TOKEN_READ_SIZE 2048
+
+// Fields of a /api/token response
+typedef struct {
+    char accessToken[AUTH_TOKEN_LEN];
+    char refreshToken[AUTH_TOKEN_LEN]; // Only issued by the password grant
+    int expires;                       // Seconds the access token is valid for
+} TokenResponse;
+
+static const JsonField tokenFields[] = {
+    JSON_FIELD(TokenResponse, "access_token", accessToken, JSON_FIELD_STRING, 0),
+    JSON_FIELD(TokenResponse, "refresh_token", refreshToken, JSON_FIELD_STRING, 0),
+    JSON_FIELD(TokenResponse, "expires", expires, JSON_FIELD_INT, 0),
+};
+static JsonFieldTable tokenTable = JSON_FIELD_TABLE(tokenFields);
+
+// Everything below is guarded by lock, which is also held across token requests so concurrent
+// requests wait for one exchange instead of each starting their own
+static ThreadMutex lock;
+static char tokenUrl[AUTH_URL_LEN];
+static char username[AUTH_CREDENTIAL_LEN];
+static char password[AUTH_CREDENTIAL_LEN];
+static char basicHeader[AUTH_CREDENTIAL_LEN * 3];
+static bool tokensEnabled = true;
+static bool unsupported;   // Server has no token endpoint
+static uint64_t retryAtMs; // Don't try another exchange before this after one failed
+static char accessToken[AUTH_TOKEN_LEN];
+static char refreshToken[AUTH_TOKEN_LEN];
+static uint64_t expiresMs;
+static uint32_t generation; // Bumped for every new access token
+
+// Base64 encoding table
+static const char base64_table[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+static void base64_encode(const char *input, char *output, size_t outlen) {
+    size_t i, j;
+    size_t len = strlen(input);
+
+    for (i = 0, j = 0; i < len && j < outlen - 4;) {
+        uint32_t octet_a = i < len ? (unsigned char)input[i++] : 0;
+        uint32_t octet_b = i < len ? (unsigned char)input[i++] : 0;
+        uint32_t octet_c = i < len ? (unsigned char)input[i++] : 0;
+        uint32_t triple = (octet_a << 16) + (octet_b << 8) + octet_c;
+
+        output[j++] = base64_table[(triple >> 18) & 0x3F];
+        output[j++] = base64_table[(triple >> 12) & 0x3F];
+        output[j++] = base64_table[(triple >> 6) & 0x3F];
+        output[j++] = base64_table[triple & 0x3F];
+    }
+    output[j] = '\0';
+
+    // Add padding based on input length
+    size_t remainder = len % 3;
+    if (remainder == 1 && j >= 2) {
+        output[j - 1] = '=';
+        output[j - 2] = '=';
+    } else if (remainder == 2 && j >= 1) {
+        output[j - 1] = '=';
+    }
+}
+
+// Append key=value to an application/x-www-form-urlencoded body. Returns false if it doesn't fit.
+static bool form_add(char *form, size_t formSize, const char *key, const char *value) {
+    static const char *unreserved = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_.~";
+    size_t j = strlen(form);
+    int n = snprintf(form + j, formSize - j, "%s%s=", j > 0 ? "&" : "", key);
+    if (n < 0 || (size_t)n >= formSize - j) return false;
+    j += n;
+    for (const char *p = value; *p; p++) {
+        if (j + 4 > formSize) return false;
+        if (strchr(unreserved, *p)) {
+            form[j++] = *p;
+        } else {
+            snprintf(&form[j], 4, "%%%02X", (unsigned char)*p);
+            j += 3;
+        }
+    }
+    form[j] = '\0';
+    return true;
+}
+
+// Drop the token and any failure state. Caller holds lock.
+static void reset_tokens(void) {
+    accessToken[0] = '\0';
+    refreshToken[0] = '\0';
+    expiresMs = 0;
+    unsupported = false;
+    retryAtMs = 0;
+}
+
+void auth_init(void) {
+    thread_mutex_init(&lock);
+}
+
+void auth_set_token_url(const char *url) {
+    thread_mutex_lock(&lock);
+    snprintf(tokenUrl, sizeof(tokenUrl), "%s", url);
+    reset_tokens();
+    thread_mutex_unlock(&lock);
+}
+
+void auth_set_credentials(const char *user, const char *pass) {
+    thread_mutex_lock(&lock);
+    reset_tokens();
+    if (!user || !pass || user[0] == '\0') {
+        username[0] = '\0';
+        password[0] = '\0';
+        basicHeader[0] = '\0';
+    } else {
+        snprintf(username, sizeof(username), "%s", user);
+        snprintf(password, sizeof(password), "%s", pass);
+
+        char credentials[AUTH_CREDENTIAL_LEN * 2];
+        snprintf(credentials, sizeof(credentials), "%s:%s", username, password);
+        char encoded[AUTH_CREDENTIAL_LEN * 3 - 8];
+        base64_encode(credentials, encoded, sizeof(encoded));
+        snprintf(basicHeader, sizeof(basicHeader), "Basic %s", encoded);
+    }
+    thread_mutex_unlock(&lock);
+}
+
+void auth_set_tokens(bool enabled) {
+    thread_mutex_lock(&lock);
+    tokensEnabled = enabled;
+    thread_mutex_unlock(&lock);
+}
+
+// Depths as reported by jsonstream: the response's keys and values are at 1
+typedef struct {
+    TokenResponse *out;
+    const JsonField *field; // Field for the value that follows the current key
+} TokenDecoder;
+
+static bool token_event(void *ctx, JsonEvent event, const char *text, size_t len, int depth) {
+    TokenDecoder *dec = ctx;
+    (void)len;
+
+    if (depth != 1) return true;
+    if (event == JSON_EVENT_KEY) {
+        dec->field = jsonfields_lookup(&tokenTable, text);
+    } else if (dec->field && event == JSON_EVENT_NUMBER) {
+        jsonfields_store_number(dec->field, dec->out, strtod(text, NULL));
+    } else if (dec->field && event == JSON_EVENT_STRING) {
+        jsonfields_store_string(dec->field, dec->out, text);
+    }
+    return true;
+}
+
+// POST a grant to the token endpoint. Returns true if it issued an access token; *status gets the HTTP
+// status (0 if the request failed).
+static bool request_token(const char *form, TokenResponse *out, int *status) {
+    *status = 0;
+    memset(out, 0, sizeof(TokenResponse));
+
+    TransportRequest *req = transport_open(TRANSPORT_METHOD_POST, tokenUrl);
+    if (!req) {
+        log_error("Failed to open request: %s", tokenUrl);
+        return false;
+    }
+    transport_add_header(req, "User-Agent", "Rommlet/1.0");
+    transport_add_header(req, "Accept", "application/json");
+    transport_add_header(req, "Content-Type", "application/x-www-form-urlencoded");
+    if (!transport_set_body(req, form, strlen(form))) {
+        log_error("Failed to attach token request body");
+        transport_close(req);
+        return false;
+    }
+    if (!transport_begin(req)) {
+        log_error("Request failed: %s", tokenUrl);
+        reachability_report(!transport_unreachable(req));
+        transport_close(req);
+        return false;
+    }
+    reachability_report(true);
+    if (!transport_get_status(req, status)) {
+        log_error("Request failed: %s", tokenUrl);
+        transport_close(req);
+        return false;
+    }
+    if (*status != 200) {
+        transport_close(req);
+        return false;
+    }
+
+    TokenDecoder dec = {out, NULL};
+    JsonStream js;
+    jsonstream_init(&js, token_event, &dec);
+    char chunk[TOKEN_READ_SIZE];
+    bool ok = true;
+    while (ok) {
+        size_t bytesRead = 0;
+        TransportReadResult result = transport_read(req, chunk, sizeof(chunk), &bytesRead);
+        if (bytesRead > 0 && !jsonstream_feed(&js, chunk, bytesRead)) ok = false;
+        if (result == TRANSPORT_READ_DONE) break;
+        if (result == TRANSPORT_READ_ERROR) ok = false;
+    }
+    transport_close(req);
+
+    if (!ok || !jsonstream_finish(&js)) {
+        log_error("Failed to parse token response");
+        return false;
+    }
+    size_t tokenLen = strlen(out->accessToken);
+    return tokenLen > 0 && tokenLen < AUTH_TOKEN_LEN - 1 && strlen(out->refreshToken) < AUTH_TOKEN_LEN - 1;
+}
+
+// Make an issued token current. Caller holds lock.
+static void store_token(const TokenResponse *token) {
+    snprintf(accessToken, sizeof(accessToken), "%s", token->accessToken);
+    if (token->refreshToken[0] != '\0') snprintf(refreshToken, sizeof(refreshToken), "%s", token->refreshToken);
+    uint64_t lifetimeMs = token->expires > 0 ? (uint64_t)token->expires * 1000 : 0;
+    if (lifetimeMs == 0) {
+        expiresMs = UINT64_MAX; // Used until the server rejects it
+    } else if (lifetimeMs > 2 * AUTH_EXPIRY_MARGIN_MS) {
+        expiresMs = transport_now_ms() + lifetimeMs - AUTH_EXPIRY_MARGIN_MS;
+    } else {
+        expiresMs = transport_now_ms() + lifetimeMs / 2;
+    }
+    generation++;
+}
+
+// Renew the access token with the refresh token, or sign in with the password when there is none or it
+// no longer works. Caller holds lock.
+static bool fetch_token(void) {
+    TokenResponse *token = malloc(sizeof(TokenResponse));
+    char *form = malloc(AUTH_FORM_LEN);
+    if (!token || !form) {
+        free(token);
+        free(form);
+        return false;
+    }
+
+    uint64_t startMs = transport_now_ms();
+    int status = 0;
+    bool ok = false;
+    if (refreshToken[0] != '\0') {
+        form[0] = '\0';
+        ok = form_add(form, AUTH_FORM_LEN, "grant_type", "refresh_token") &&
+             form_add(form, AUTH_FORM_LEN, "refresh_token", refreshToken) && request_token(form, token, &status);
+        if (!ok) {
+            log_info("Token refresh failed (%d), signing in again", status);
+            refreshToken[0] = '\0';
+        }
+    }
+    if (!ok) {
+        form[0] = '\0';
+        ok = form_add(form, AUTH_FORM_LEN, "grant_type", "password") &&
+             form_add(form, AUTH_FORM_LEN, "username", username) &&
+             form_add(form, AUTH_FORM_LEN, "password", password) &&
+             form_add(form, AUTH_FORM_LEN, "scope", AUTH_SCOPES) && request_token(form, token, &status);
+    }
+
+    if (ok) {
+        store_token(token);
+        log_debug("Got access token in %llu ms, valid for %d s", (unsigned long long)(transport_now_ms() - startMs),
+                  token->expires);
+    } else if (status == 404 || status == 405) {
+        log_info("Server has no token endpoint, using Basic auth");
+        unsupported = true;
+    } else {
+        log_warn("Token request failed (%d), using Basic auth", status);
+        retryAtMs = transport_now_ms() + AUTH_RETRY_MS;
+    }
+    free(token);
+    free(form);
+    return ok;
+}
+
+// Caller holds lock
+static bool token_usable(void) {
+    return tokensEnabled && !unsupported && accessToken[0] != '\0' && transport_now_ms() < expiresMs;
+}
+
+uint32_t auth_header(char *header, size_t headerSize) {
+    uint32_t current = 0;
+    thread_mutex_lock(&lock);
+    if (username[0] == '\0') {
+        header[0] = '\0';
+    } else {
+        if (tokensEnabled && !unsupported && !token_usable() && transport_now_ms() >= retryAtMs) fetch_token();
+        if (token_usable()) {
+            snprintf(header, headerSize, "Bearer %s", accessToken);
+            current = generation;
+        } else {
+            snprintf(header, headerSize, "%s", basicHeader);
+        }
+    }
+    thread_mutex_unlock(&lock);
+    return current;
+}
+
+bool auth_rejected(uint32_t tokenGeneration) {
+    if (tokenGeneration == 0) return false;
+    thread_mutex_lock(&lock);
+    if (tokenGeneration == generation) {
+        log_info("Access token rejected, renewing");
+        accessToken[0] = '\0';
+    }
+    thread_mutex_unlock(&lock);
+    // A newer token may already have replaced it; either way the next header differs
+    return true;
+}
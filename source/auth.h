@@ -0,0 +1,44 @@
+/*
+ * Auth module - Authorization header for RomM requests
+ *
+ * RomM checks HTTP Basic credentials against a bcrypt hash on every request,
+ * which costs the server tens to hundreds of milliseconds each time. Instead
+ * the credentials are exchanged once at /api/token for a short-lived access
+ * token, sent as a Bearer header until it expires and then renewed with the
+ * refresh token that came with it. Servers without a token endpoint, or
+ * exchanges that fail, fall back to Basic.
+ */
+
+#ifndef AUTH_H
+#define AUTH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define AUTH_TOKEN_LEN 1024                    // Matches JSONSTREAM_TOKEN_SIZE, which would cut longer tokens off
+#define AUTH_HEADER_LEN (AUTH_TOKEN_LEN + 16)  // "Bearer " and the token
+#define AUTH_SCOPES "platforms.read roms.read" // Everything the app reads
+#define AUTH_EXPIRY_MARGIN_MS 30000            // Renew this long before the server says the token expires
+#define AUTH_RETRY_MS 60000                    // After a failed exchange, use Basic this long before trying again
+
+void auth_init(void);
+
+// Set the server's token endpoint. Drops any token issued by the previous server.
+void auth_set_token_url(const char *url);
+
+// Set the credentials (empty username = none). Drops any token issued for the previous ones.
+void auth_set_credentials(const char *user, const char *pass);
+
+// Exchange credentials for tokens (default on). Off sends Basic on every request.
+void auth_set_tokens(bool enabled);
+
+// Fill header with the Authorization value for the next request, fetching or renewing a token first if needed.
+// header is empty when there are no credentials. Returns the token's generation, 0 for Basic or none.
+uint32_t auth_header(char *header, size_t headerSize);
+
+// A request sent with the token from tokenGeneration got 401. Drops that token if it is still current and
+// returns true if the request is worth sending again with a fresh header.
+bool auth_rejected(uint32_t tokenGeneration);
+
+#endif // AUTH_H
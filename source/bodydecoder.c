@@ -0,0 +1,135 @@
+/*
+ * Body decoder module - Undo gzip/deflate Content-Encoding as a response streams in
+ */
+
+#include "bodydecoder.h"
+#include "log.h"
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <zlib.h>
+
+typedef enum { ENCODING_IDENTITY, ENCODING_GZIP, ENCODING_DEFLATE } Encoding;
+
+struct BodyDecoder {
+    TransportRequest *req;
+    Encoding encoding;
+    z_stream inflater;
+    uint8_t *input;
+    size_t firstInputLen; // Kept to retry a "deflate" body as raw deflate, see inflate_some()
+    bool retriedRaw;
+    bool wireDone;  // Transport reported the end of the body
+    bool streamEnd; // Inflater reached the end of the compressed stream
+    uint64_t wireBytes;
+    uint64_t decodedBytes;
+};
+
+BodyDecoder *bodydecoder_open(TransportRequest *req) {
+    BodyDecoder *d = calloc(1, sizeof(BodyDecoder));
+    if (!d) {
+        transport_close(req);
+        return NULL;
+    }
+    d->req = req;
+
+    char value[64];
+    if (transport_get_header(req, "Content-Encoding", value, sizeof(value)) && strcasecmp(value, "identity") != 0) {
+        if (strcasecmp(value, "gzip") == 0 || strcasecmp(value, "x-gzip") == 0) {
+            d->encoding = ENCODING_GZIP;
+        } else if (strcasecmp(value, "deflate") == 0) {
+            d->encoding = ENCODING_DEFLATE;
+        } else {
+            log_error("Unsupported Content-Encoding: %s", value);
+            bodydecoder_close(d);
+            return NULL;
+        }
+        d->input = malloc(BODYDECODER_INPUT_SIZE);
+        // 32 added to the window bits detects a zlib or gzip header by itself
+        if (!d->input || inflateInit2(&d->inflater, MAX_WBITS + 32) != Z_OK) {
+            log_error("Failed to set up %s decoding", value);
+            free(d->input);
+            d->input = NULL;
+            d->encoding = ENCODING_IDENTITY;
+            bodydecoder_close(d);
+            return NULL;
+        }
+    }
+    return d;
+}
+
+// Inflate into the caller's buffer until some output is produced or the body ends
+static TransportReadResult inflate_some(BodyDecoder *d, uint8_t *buffer, size_t size, size_t *bytesRead) {
+    z_stream *zs = &d->inflater;
+    zs->next_out = buffer;
+    zs->avail_out = size;
+    while (zs->avail_out == size && !d->streamEnd) {
+        if (zs->avail_in == 0) {
+            if (d->wireDone) {
+                log_error("Compressed response ended early");
+                return TRANSPORT_READ_ERROR;
+            }
+            size_t got = 0;
+            TransportReadResult result = transport_read(d->req, d->input, BODYDECODER_INPUT_SIZE, &got);
+            if (result == TRANSPORT_READ_ERROR) return TRANSPORT_READ_ERROR;
+            if (result == TRANSPORT_READ_DONE) d->wireDone = true;
+            if (d->wireBytes == 0) d->firstInputLen = got;
+            d->wireBytes += got;
+            zs->next_in = d->input;
+            zs->avail_in = got;
+            continue;
+        }
+
+        int ret = inflate(zs, Z_NO_FLUSH);
+        if (ret == Z_STREAM_END) {
+            d->streamEnd = true;
+        } else if (ret == Z_DATA_ERROR && d->encoding == ENCODING_DEFLATE && !d->retriedRaw &&
+                   zs->total_in < d->firstInputLen) {
+            // "deflate" is meant to be zlib-wrapped, but some servers send a raw stream; the header check
+            // fails on the first two bytes, so the first read is still in the buffer to start over from
+            d->retriedRaw = true;
+            if (inflateReset2(zs, -MAX_WBITS) != Z_OK) return TRANSPORT_READ_ERROR;
+            zs->next_in = d->input;
+            zs->avail_in = d->firstInputLen;
+        } else if (ret != Z_OK && ret != Z_BUF_ERROR) {
+            log_error("Failed to inflate response (zlib %d)", ret);
+            return TRANSPORT_READ_ERROR;
+        }
+    }
+    *bytesRead = size - zs->avail_out;
+    d->decodedBytes += *bytesRead;
+    return d->streamEnd ? TRANSPORT_READ_DONE : TRANSPORT_READ_MORE;
+}
+
+TransportReadResult bodydecoder_read(BodyDecoder *d, void *buffer, size_t size, size_t *bytesRead) {
+    *bytesRead = 0;
+    if (d->encoding != ENCODING_IDENTITY) return inflate_some(d, buffer, size, bytesRead);
+
+    TransportReadResult result = transport_read(d->req, buffer, size, bytesRead);
+    d->wireBytes += *bytesRead;
+    d->decodedBytes += *bytesRead;
+    return result;
+}
+
+uint32_t bodydecoder_content_length(BodyDecoder *d) {
+    return d->encoding == ENCODING_IDENTITY ? transport_get_content_length(d->req) : 0;
+}
+
+uint64_t bodydecoder_wire_bytes(const BodyDecoder *d) {
+    return d->wireBytes;
+}
+
+TransportRequest *bodydecoder_request(BodyDecoder *d) {
+    return d->req;
+}
+
+void bodydecoder_close(BodyDecoder *d) {
+    if (!d) return;
+    if (d->input) {
+        inflateEnd(&d->inflater);
+        free(d->input);
+        log_debug("Inflated %llu bytes from %llu (%.1fx)", (unsigned long long)d->decodedBytes,
+                  (unsigned long long)d->wireBytes, d->wireBytes > 0 ? d->decodedBytes / (double)d->wireBytes : 0.0);
+    }
+    transport_close(d->req);
+    free(d);
+}
@@ -0,0 +1,42 @@
+/*
+ * Body decoder module - Undo gzip/deflate Content-Encoding as a response streams in
+ *
+ * Wraps an open request and hands out decoded bytes through the same read
+ * interface as the transport, so callers can fill a buffer or feed a stream
+ * parser without holding the compressed body. Responses without an encoding
+ * pass straight through.
+ */
+
+#ifndef BODYDECODER_H
+#define BODYDECODER_H
+
+#include "transport.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define BODYDECODER_ACCEPT "gzip, deflate" // Accept-Encoding value for requests read through a decoder
+#define BODYDECODER_INPUT_SIZE (16 * 1024) // Compressed bytes read from the transport at a time
+
+typedef struct BodyDecoder BodyDecoder;
+
+// Take over an open request whose status has been checked. Returns NULL (and closes req) if the
+// response uses an unsupported encoding or memory runs out.
+BodyDecoder *bodydecoder_open(TransportRequest *req);
+
+// Read the next decoded bytes. Compressed bodies that end early or fail to inflate are read errors.
+TransportReadResult bodydecoder_read(BodyDecoder *d, void *buffer, size_t size, size_t *bytesRead);
+
+// Decoded length announced by the response, 0 if unknown (always unknown for compressed bodies)
+uint32_t bodydecoder_content_length(BodyDecoder *d);
+
+// Bytes received from the network so far, compressed
+uint64_t bodydecoder_wire_bytes(const BodyDecoder *d);
+
+// The underlying request, for transport_abort()
+TransportRequest *bodydecoder_request(BodyDecoder *d);
+
+// Close the request and free the decoder. Logs the compression ratio at debug level.
+void bodydecoder_close(BodyDecoder *d);
+
+#endif // BODYDECODER_H
@@ -295,5 +295,5 @@ void browser_draw(void) {
     }
 
     // Help text
-    ui_draw_text(UI_PADDING, SCREEN_TOP_HEIGHT - UI_LINE_HEIGHT - UI_PADDING, "A: Open | B: Cancel", UI_COLOR_TEXT_DIM);
+    ui_draw_text(UI_PADDING, ui_hint_y(), "A: Open | B: Cancel", UI_COLOR_TEXT_DIM);
 }
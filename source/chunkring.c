@@ -0,0 +1,105 @@
+/*
+ * Chunk ring module - Fixed ring of byte buffers passed between two threads
+ */
+
+#include "chunkring.h"
+#include <stdlib.h>
+#include <string.h>
+
+bool chunkring_init(ChunkRing *ring, int depth, size_t chunkSize) {
+    memset(ring, 0, sizeof(ChunkRing));
+    if (depth < 1) depth = 1;
+    ring->memory = malloc((size_t)depth * chunkSize);
+    ring->lengths = calloc(depth, sizeof(size_t));
+    if (!ring->memory || !ring->lengths) {
+        chunkring_free(ring);
+        return false;
+    }
+    ring->depth = depth;
+    ring->chunkSize = chunkSize;
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    atomic_init(&ring->closed, false);
+    atomic_init(&ring->aborted, false);
+    thread_mutex_init(&ring->lock);
+    thread_cond_init(&ring->changed);
+    return true;
+}
+
+void chunkring_free(ChunkRing *ring) {
+    free(ring->memory);
+    free(ring->lengths);
+    ring->memory = NULL;
+    ring->lengths = NULL;
+}
+
+// Wake the other side after a counter or flag changed. Taking the lock orders the
+// change against a waiter that checked its condition just before sleeping.
+static void notify(ChunkRing *ring) {
+    thread_mutex_lock(&ring->lock);
+    thread_cond_broadcast(&ring->changed);
+    thread_mutex_unlock(&ring->lock);
+}
+
+static bool ring_full(ChunkRing *ring) {
+    unsigned int head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    unsigned int tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    return tail - head >= (unsigned int)ring->depth;
+}
+
+static bool ring_empty(ChunkRing *ring) {
+    unsigned int tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    unsigned int head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    return tail == head;
+}
+
+uint8_t *chunkring_acquire(ChunkRing *ring) {
+    if (ring_full(ring) && !atomic_load(&ring->aborted)) {
+        thread_mutex_lock(&ring->lock);
+        while (ring_full(ring) && !atomic_load(&ring->aborted)) thread_cond_wait(&ring->changed, &ring->lock);
+        thread_mutex_unlock(&ring->lock);
+    }
+    if (atomic_load(&ring->aborted)) return NULL;
+
+    unsigned int tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    return ring->memory + (size_t)(tail % ring->depth) * ring->chunkSize;
+}
+
+void chunkring_publish(ChunkRing *ring, size_t len) {
+    unsigned int tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    ring->lengths[tail % ring->depth] = len;
+    atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+    notify(ring);
+}
+
+void chunkring_close(ChunkRing *ring) {
+    atomic_store(&ring->closed, true);
+    notify(ring);
+}
+
+const uint8_t *chunkring_peek(ChunkRing *ring, size_t *len) {
+    if (ring_empty(ring)) {
+        thread_mutex_lock(&ring->lock);
+        while (ring_empty(ring) && !atomic_load(&ring->closed) && !atomic_load(&ring->aborted)) {
+            thread_cond_wait(&ring->changed, &ring->lock);
+        }
+        thread_mutex_unlock(&ring->lock);
+    }
+    // Closed only ends the stream once everything published before it is drained
+    if (atomic_load(&ring->aborted) || ring_empty(ring)) return NULL;
+
+    unsigned int head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    *len = ring->lengths[head % ring->depth];
+    return ring->memory + (size_t)(head % ring->depth) * ring->chunkSize;
+}
+
+void chunkring_release(ChunkRing *ring) {
+    unsigned int head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+    notify(ring);
+}
+
+void chunkring_abort(ChunkRing *ring) {
+    atomic_store(&ring->aborted, true);
+    notify(ring);
+}
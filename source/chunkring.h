@@ -0,0 +1,60 @@
+/*
+ * Chunk ring module - Fixed ring of byte buffers passed between two threads
+ *
+ * A single producer fills buffers and a single consumer drains them in order,
+ * so a network reader and a file writer can run at the same time. Slots are
+ * claimed with atomic counters; the mutex and condition variable are only
+ * touched to sleep when the ring is full or empty.
+ */
+
+#ifndef CHUNKRING_H
+#define CHUNKRING_H
+
+#include "thread.h"
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct {
+    uint8_t *memory; // depth * chunkSize bytes, one allocation
+    size_t *lengths; // Filled length of each slot
+    int depth;
+    size_t chunkSize;
+
+    atomic_uint head; // Next slot the consumer reads (counts up forever)
+    atomic_uint tail; // Next slot the producer fills
+    atomic_bool closed;
+    atomic_bool aborted;
+
+    ThreadMutex lock;
+    ThreadCond changed;
+} ChunkRing;
+
+// Allocate depth buffers of chunkSize bytes. Returns false if out of memory.
+bool chunkring_init(ChunkRing *ring, int depth, size_t chunkSize);
+
+// Free the buffers (both sides must be done with the ring)
+void chunkring_free(ChunkRing *ring);
+
+// Producer: get the next empty buffer (chunkSize bytes), waiting while the ring is full.
+// Returns NULL once the ring is aborted. Calling again before publishing returns the same buffer.
+uint8_t *chunkring_acquire(ChunkRing *ring);
+
+// Producer: hand the acquired buffer, filled with len bytes, to the consumer
+void chunkring_publish(ChunkRing *ring, size_t len);
+
+// Producer: no more buffers will be published; the consumer drains what is left
+void chunkring_close(ChunkRing *ring);
+
+// Consumer: get the oldest filled buffer, waiting while the ring is empty.
+// Returns NULL once the ring is closed and drained, or aborted.
+const uint8_t *chunkring_peek(ChunkRing *ring, size_t *len);
+
+// Consumer: return the peeked buffer to the producer
+void chunkring_release(ChunkRing *ring);
+
+// Either side: stop both sides; pending buffers are dropped
+void chunkring_abort(ChunkRing *ring);
+
+#endif // CHUNKRING_H
@@ -0,0 +1,221 @@
+/*
+ * Coalesce module - Shares one in-flight request between callers asking for the same URL
+ */
+
+#include "coalesce.h"
+#include "log.h"
+#include "thread.h"
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#define COALESCE_MAX_PARAMS 32
+
+struct CoalesceFlight {
+    char key[COALESCE_MAX_URL_LEN]; // Normalized URL
+    bool finished;
+    bool ok;
+    char *body; // Copy for the waiters; NULL if there are none or it couldn't be shared
+    size_t len;
+    int refs; // Sender plus waiters; the last one out frees the flight
+    struct CoalesceFlight *next;
+};
+
+// Everything below is guarded by lock
+static ThreadMutex lock;
+static ThreadCond flightFinished; // Broadcast when any flight finishes
+static CoalesceFlight *flights = NULL;
+static CoalesceStats stats;
+
+// Handed out when a request can't be shared (URL too long, out of memory); coalesce_finish() ignores it
+static CoalesceFlight solo;
+
+// A query parameter, as a slice of the source URL
+typedef struct {
+    const char *text;
+    size_t len;
+} QueryParam;
+
+static int compare_params(const void *a, const void *b) {
+    const QueryParam *pa = a;
+    const QueryParam *pb = b;
+    size_t n = pa->len < pb->len ? pa->len : pb->len;
+    int cmp = memcmp(pa->text, pb->text, n);
+    if (cmp != 0) return cmp;
+    return pa->len < pb->len ? -1 : pa->len > pb->len;
+}
+
+// Append n bytes of src to out, lowercasing if asked and uppercasing the hex digits of percent escapes.
+// Returns false if it doesn't fit.
+static bool append(char *out, size_t outSize, size_t *j, const char *src, size_t n, bool lower) {
+    if (*j + n >= outSize) return false;
+    int escapeDigits = 0;
+    for (size_t i = 0; i < n; i++) {
+        char c = src[i];
+        if (lower) {
+            c = (char)tolower((unsigned char)c);
+        } else if (escapeDigits > 0) {
+            c = (char)toupper((unsigned char)c);
+            escapeDigits--;
+        } else if (c == '%') {
+            escapeDigits = 2;
+        }
+        out[(*j)++] = c;
+    }
+    out[*j] = '\0';
+    return true;
+}
+
+bool coalesce_normalize_url(const char *url, char *out, size_t outSize) {
+    size_t j = 0;
+    if (outSize == 0) return false;
+    out[0] = '\0';
+
+    // Scheme and authority, lowercased, without the scheme's default port
+    const char *sep = strstr(url, "://");
+    const char *authority = sep ? sep + 3 : url;
+    const char *path = authority + strcspn(authority, "/?#");
+    size_t authorityLen = path - authority;
+    const char *port = memchr(authority, ':', authorityLen);
+    if (port && sep) {
+        size_t schemeLen = sep - url;
+        size_t portLen = path - port;
+        if ((schemeLen == 4 && strncasecmp(url, "http", 4) == 0 && portLen == 3 && memcmp(port, ":80", 3) == 0) ||
+            (schemeLen == 5 && strncasecmp(url, "https", 5) == 0 && portLen == 4 && memcmp(port, ":443", 4) == 0)) {
+            authorityLen -= portLen;
+        }
+    }
+    if (!append(out, outSize, &j, url, authority - url, true) ||
+        !append(out, outSize, &j, authority, authorityLen, true)) {
+        return false;
+    }
+
+    // Path as given, "/" if empty
+    size_t pathLen = strcspn(path, "?#");
+    bool fits = pathLen > 0 ? append(out, outSize, &j, path, pathLen, false) : append(out, outSize, &j, "/", 1, false);
+    if (!fits) return false;
+    if (path[pathLen] != '?') return true;
+
+    // Query parameters, sorted, fragment dropped
+    QueryParam params[COALESCE_MAX_PARAMS];
+    int count = 0;
+    const char *query = path + pathLen + 1;
+    size_t queryLen = strcspn(query, "#");
+    for (const char *p = query; p < query + queryLen;) {
+        size_t len = strcspn(p, "&#");
+        if (len > 0) {
+            if (count == COALESCE_MAX_PARAMS) return false;
+            params[count].text = p;
+            params[count].len = len;
+            count++;
+        }
+        p += len;
+        if (*p == '&') p++;
+    }
+    qsort(params, count, sizeof(QueryParam), compare_params);
+    for (int i = 0; i < count; i++) {
+        if (!append(out, outSize, &j, i == 0 ? "?" : "&", 1, false) ||
+            !append(out, outSize, &j, params[i].text, params[i].len, false)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void coalesce_init(void) {
+    thread_mutex_init(&lock);
+    thread_cond_init(&flightFinished);
+}
+
+// Caller holds lock
+static CoalesceFlight *find_flight(const char *key) {
+    for (CoalesceFlight *f = flights; f; f = f->next) {
+        if (strcmp(f->key, key) == 0) return f;
+    }
+    return NULL;
+}
+
+// Drop a reference to a finished flight. Caller holds lock.
+static void release_flight(CoalesceFlight *flight) {
+    if (--flight->refs > 0) return;
+    free(flight->body);
+    free(flight);
+}
+
+CoalesceFlight *coalesce_begin(const char *url, char **body, size_t *len) {
+    *body = NULL;
+    *len = 0;
+    char key[COALESCE_MAX_URL_LEN];
+    if (!coalesce_normalize_url(url, key, sizeof(key))) {
+        thread_mutex_lock(&lock);
+        stats.misses++;
+        thread_mutex_unlock(&lock);
+        return &solo;
+    }
+
+    thread_mutex_lock(&lock);
+    CoalesceFlight *running = find_flight(key);
+    if (running) {
+        running->refs++;
+        while (!running->finished) thread_cond_wait(&flightFinished, &lock);
+        bool served = !running->ok;
+        if (running->ok && running->body && (*body = malloc(running->len + 1))) {
+            memcpy(*body, running->body, running->len + 1);
+            *len = running->len;
+            served = true;
+        }
+        release_flight(running);
+        if (served) {
+            stats.hits++;
+            thread_mutex_unlock(&lock);
+            log_debug("Joined request in flight: %s", url);
+            return NULL;
+        }
+        // It succeeded but its body couldn't be shared: every waiter sends its own, side by side
+        stats.misses++;
+        thread_mutex_unlock(&lock);
+        return &solo;
+    }
+
+    stats.misses++;
+    CoalesceFlight *flight = calloc(1, sizeof(CoalesceFlight));
+    if (!flight) {
+        thread_mutex_unlock(&lock);
+        return &solo;
+    }
+    memcpy(flight->key, key, sizeof(key));
+    flight->refs = 1;
+    flight->next = flights;
+    flights = flight;
+    thread_mutex_unlock(&lock);
+    return flight;
+}
+
+void coalesce_finish(CoalesceFlight *flight, bool ok, const char *body, size_t len) {
+    if (flight == &solo) return;
+    thread_mutex_lock(&lock);
+    for (CoalesceFlight **p = &flights; *p; p = &(*p)->next) {
+        if (*p == flight) {
+            *p = flight->next;
+            break;
+        }
+    }
+    flight->finished = true;
+    flight->ok = ok;
+    // Only copied when someone is waiting for it
+    if (ok && body && flight->refs > 1 && (flight->body = malloc(len + 1))) {
+        memcpy(flight->body, body, len);
+        flight->body[len] = '\0';
+        flight->len = len;
+    }
+    thread_cond_broadcast(&flightFinished);
+    release_flight(flight);
+    thread_mutex_unlock(&lock);
+}
+
+void coalesce_get_stats(CoalesceStats *out) {
+    thread_mutex_lock(&lock);
+    *out = stats;
+    thread_mutex_unlock(&lock);
+}
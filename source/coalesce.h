@@ -0,0 +1,45 @@
+/*
+ * Coalesce module - Shares one in-flight request between callers asking for the same URL
+ *
+ * A caller that asks for a URL already being fetched waits for that request
+ * and gets a copy of its body instead of sending a second one. URLs are
+ * matched after normalizing them, so the same query built in a different
+ * parameter order still matches. Only requests in flight are shared: a
+ * finished one is forgotten at once, so nothing handed out is older than the
+ * request it joined.
+ */
+
+#ifndef COALESCE_H
+#define COALESCE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define COALESCE_MAX_URL_LEN 1024
+
+typedef struct CoalesceFlight CoalesceFlight;
+
+typedef struct {
+    uint32_t hits;   // Callers served by a request that was already in flight
+    uint32_t misses; // Callers that sent the request themselves
+} CoalesceStats;
+
+void coalesce_init(void);
+
+// Normalize url for matching: scheme and host lowercased, default port, fragment and empty query parameters
+// dropped, percent escapes uppercased, query parameters sorted. Returns false if out is too small.
+bool coalesce_normalize_url(const char *url, char *out, size_t outSize);
+
+// Join the request for url. Returns a flight if the caller should send it, and must then pass its outcome to
+// coalesce_finish(). Otherwise it waited for the request already in flight and returns NULL with *body set to a
+// NUL-terminated copy of its body (caller frees), or NULL if that request failed.
+CoalesceFlight *coalesce_begin(const char *url, char **body, size_t *len);
+
+// Hand the outcome to every caller waiting on flight and forget it. A successful request whose body can't be
+// shared (body NULL) sends the waiters off to make their own, unshared.
+void coalesce_finish(CoalesceFlight *flight, bool ok, const char *body, size_t len);
+
+void coalesce_get_stats(CoalesceStats *out);
+
+#endif // COALESCE_H
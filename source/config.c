@@ -25,6 +25,22 @@ void config_init(Config *config) {
     memset(config, 0, sizeof(Config));
     config->serverUrl[0] = '\0';
     snprintf(config->romFolder, CONFIG_MAX_PATH_LEN, "sdmc:/roms");
+    config->downloadSegments = 1;
+    config->downloadBuffers = 4;
+    config->downloadChunkKB = 64;
+    config->downloadSlots = 2;
+    config->maxConnections = 4;
+    config->downloadRateKB = 0;
+    config->downloadBackoffKB = 32;
+    config->compressJson = 1;
+    config->tokenAuth = 1;
+    config->downloadRetries = 6;
+    config->stallTimeoutSec = 20;
+    config->connectTimeoutSec = 5;
+    config->responseTimeoutSec = 15;
+    snprintf(config->queueOrder, CONFIG_MAX_ORDER_LEN, "fifo");
+    snprintf(config->fileSink, CONFIG_MAX_SINK_LEN, "auto");
+    config->writeBufferKB = 256;
 }
 
 bool config_load(Config *config) {
@@ -81,6 +97,38 @@ bool config_load(Config *config) {
                 snprintf(config->password, CONFIG_MAX_PASS_LEN, "%s", value);
             } else if (strcmp(key, "romFolder") == 0) {
                 snprintf(config->romFolder, CONFIG_MAX_PATH_LEN, "%s", value);
+            } else if (strcmp(key, "downloadSegments") == 0) {
+                config->downloadSegments = atoi(value);
+            } else if (strcmp(key, "downloadBuffers") == 0) {
+                config->downloadBuffers = atoi(value);
+            } else if (strcmp(key, "downloadChunkKB") == 0) {
+                config->downloadChunkKB = atoi(value);
+            } else if (strcmp(key, "downloadSlots") == 0) {
+                config->downloadSlots = atoi(value);
+            } else if (strcmp(key, "maxConnections") == 0) {
+                config->maxConnections = atoi(value);
+            } else if (strcmp(key, "downloadRateKB") == 0) {
+                config->downloadRateKB = atoi(value);
+            } else if (strcmp(key, "downloadBackoffKB") == 0) {
+                config->downloadBackoffKB = atoi(value);
+            } else if (strcmp(key, "compressJson") == 0) {
+                config->compressJson = atoi(value);
+            } else if (strcmp(key, "tokenAuth") == 0) {
+                config->tokenAuth = atoi(value);
+            } else if (strcmp(key, "downloadRetries") == 0) {
+                config->downloadRetries = atoi(value);
+            } else if (strcmp(key, "stallTimeoutSec") == 0) {
+                config->stallTimeoutSec = atoi(value);
+            } else if (strcmp(key, "connectTimeoutSec") == 0) {
+                config->connectTimeoutSec = atoi(value);
+            } else if (strcmp(key, "responseTimeoutSec") == 0) {
+                config->responseTimeoutSec = atoi(value);
+            } else if (strcmp(key, "queueOrder") == 0) {
+                snprintf(config->queueOrder, CONFIG_MAX_ORDER_LEN, "%s", value);
+            } else if (strcmp(key, "fileSink") == 0) {
+                snprintf(config->fileSink, CONFIG_MAX_SINK_LEN, "%s", value);
+            } else if (strcmp(key, "writeBufferKB") == 0) {
+                config->writeBufferKB = atoi(value);
             }
         }
     }
@@ -104,6 +152,22 @@ static bool save_config_file(const Config *config) {
     fprintf(f, "username=%s\n", config->username);
     fprintf(f, "password=%s\n", config->password);
     fprintf(f, "romFolder=%s\n", config->romFolder);
+    fprintf(f, "downloadSegments=%d\n", config->downloadSegments);
+    fprintf(f, "downloadBuffers=%d\n", config->downloadBuffers);
+    fprintf(f, "downloadChunkKB=%d\n", config->downloadChunkKB);
+    fprintf(f, "downloadSlots=%d\n", config->downloadSlots);
+    fprintf(f, "maxConnections=%d\n", config->maxConnections);
+    fprintf(f, "downloadRateKB=%d\n", config->downloadRateKB);
+    fprintf(f, "downloadBackoffKB=%d\n", config->downloadBackoffKB);
+    fprintf(f, "compressJson=%d\n", config->compressJson);
+    fprintf(f, "tokenAuth=%d\n", config->tokenAuth);
+    fprintf(f, "downloadRetries=%d\n", config->downloadRetries);
+    fprintf(f, "stallTimeoutSec=%d\n", config->stallTimeoutSec);
+    fprintf(f, "connectTimeoutSec=%d\n", config->connectTimeoutSec);
+    fprintf(f, "responseTimeoutSec=%d\n", config->responseTimeoutSec);
+    fprintf(f, "queueOrder=%s\n", config->queueOrder);
+    fprintf(f, "fileSink=%s\n", config->fileSink);
+    fprintf(f, "writeBufferKB=%d\n", config->writeBufferKB);
 
     // Write platform mappings section
     if (mappingCount > 0) {
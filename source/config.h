@@ -12,6 +12,8 @@
 #define CONFIG_MAX_PASS_LEN 64
 #define CONFIG_MAX_PATH_LEN 256
 #define CONFIG_MAX_SLUG_LEN 64
+#define CONFIG_MAX_ORDER_LEN 16
+#define CONFIG_MAX_SINK_LEN 16
 #define CONFIG_PATH "sdmc:/3ds/rommlet/config.ini"
 #define CONFIG_DIR "sdmc:/3ds/rommlet"
 
@@ -20,6 +22,22 @@ typedef struct {
     char username[CONFIG_MAX_USER_LEN];
     char password[CONFIG_MAX_PASS_LEN];
     char romFolder[CONFIG_MAX_PATH_LEN];
+    int downloadSegments;                  // Parallel ranges per download (1 = single stream)
+    int downloadBuffers;                   // Buffers between network reader and SD writer (1 = write inline)
+    int downloadChunkKB;                   // Size of each download buffer
+    int downloadSlots;                     // Queue entries downloaded at once
+    int maxConnections;                    // Download connections open to the server at once, segments included
+    int downloadRateKB;                    // Combined download rate cap in KB/s (0 = unlimited)
+    int downloadBackoffKB;                 // Download rate in KB/s while browsing requests run (0 = no back off)
+    int compressJson;                      // Ask for gzip/deflate API responses (0 = off)
+    int tokenAuth;                         // Sign in once for an access token instead of Basic auth per request
+    int downloadRetries;                   // Failed downloads retried this many times in a row (0 = never)
+    int stallTimeoutSec;                   // Abort and retry transfers idle this long (0 = wait forever)
+    int connectTimeoutSec;                 // Give up connecting to the server after this long (0 = backend default)
+    int responseTimeoutSec;                // Give up waiting for response headers after this long (0 = no limit)
+    char queueOrder[CONFIG_MAX_ORDER_LEN]; // Queue download order: "fifo", "shortest" or "largest"
+    char fileSink[CONFIG_MAX_SINK_LEN];    // SD writer: "stdio", "fsdirect", or "auto" to benchmark on next start
+    int writeBufferKB;                     // Write-combining buffer per open file (0 = write each chunk as it comes)
 } Config;
 
 // Initialize config with defaults
@@ -3,6 +3,7 @@
  */
 
 #include "debuglog.h"
+#include "thread.h"
 #include "ui.h"
 #include <stdio.h>
 #include <string.h>
@@ -17,7 +18,8 @@
 
 static bool visible = false;
 
-// Circular log buffer
+// Circular log buffer, appended to from whichever thread logs
+static ThreadMutex bufferLock;
 static char logBuffer[LOG_MAX_LINES][LOG_LINE_LENGTH];
 static int logHead = 0;
 static int logCount = 0;
@@ -33,6 +35,7 @@ static float logAreaHeight = 0;
 static int visibleLines = 0;
 
 void debuglog_init(void) {
+    thread_mutex_init(&bufferLock);
     visible = false;
     scrollY = 0;
     scrollX = 0;
@@ -42,6 +45,13 @@ void debuglog_init(void) {
     memset(logBuffer, 0, sizeof(logBuffer));
 }
 
+static int line_count(void) {
+    thread_mutex_lock(&bufferLock);
+    int count = logCount;
+    thread_mutex_unlock(&bufferLock);
+    return count;
+}
+
 bool debuglog_is_visible(void) {
     return visible;
 }
@@ -56,6 +66,7 @@ void debuglog_show(void) {
 void debuglog_update(void) {
     u32 kDown = hidKeysDown();
     u32 kHeld = hidKeysHeld();
+    int lineCount = line_count();
 
     // Close on X button tap
     if (kDown & KEY_TOUCH) {
@@ -76,8 +87,8 @@ void debuglog_update(void) {
         if (touch.py >= logAreaTop && touch.py < logAreaTop + logAreaHeight) {
             if (lastTouchY >= 0) {
                 int deltaY = lastTouchY - touch.py;
-                if (deltaY != 0 && logCount > visibleLines) {
-                    int maxScroll = logCount - visibleLines;
+                if (deltaY != 0 && lineCount > visibleLines) {
+                    int maxScroll = lineCount - visibleLines;
                     int scrollAmount = deltaY / 10;
                     if (scrollAmount != 0) {
                         scrollY += scrollAmount;
@@ -117,7 +128,7 @@ void debuglog_update(void) {
     hidCstickRead(&cstick);
     if (cstick.dy > 40 && scrollY > 0) scrollY--;
     if (cstick.dy < -40) {
-        int maxScroll = logCount > visibleLines ? logCount - visibleLines : 0;
+        int maxScroll = lineCount > visibleLines ? lineCount - visibleLines : 0;
         if (scrollY < maxScroll) scrollY++;
     }
     if (cstick.dx > 40) {
@@ -148,10 +159,19 @@ void debuglog_draw(void) {
     logAreaHeight = SCREEN_BOTTOM_HEIGHT - logAreaTop - UI_PADDING;
     visibleLines = (int)(logAreaHeight / UI_LINE_HEIGHT);
 
+    // Copy the visible lines out first; other threads may be logging
+    static char lines[LOG_MAX_LINES][LOG_LINE_LENGTH];
+    int count = 0;
+    thread_mutex_lock(&bufferLock);
+    for (; count < visibleLines && count < LOG_MAX_LINES && count + scrollY < logCount; count++) {
+        int lineIndex = (logHead - logCount + count + scrollY + LOG_MAX_LINES) % LOG_MAX_LINES;
+        memcpy(lines[count], logBuffer[lineIndex], LOG_LINE_LENGTH);
+    }
+    thread_mutex_unlock(&bufferLock);
+
     float y = logAreaTop;
-    for (int i = 0; i < visibleLines && i + scrollY < logCount; i++) {
-        int lineIndex = (logHead - logCount + i + scrollY + LOG_MAX_LINES) % LOG_MAX_LINES;
-        ui_draw_text(UI_PADDING - scrollX, y, logBuffer[lineIndex], UI_COLOR_TEXT);
+    for (int i = 0; i < count; i++) {
+        ui_draw_text(UI_PADDING - scrollX, y, lines[i], UI_COLOR_TEXT);
         y += UI_LINE_HEIGHT;
     }
 }
@@ -160,7 +180,9 @@ void debuglog_subscriber(LogLevel level, const char *message) {
     const char *levelName = log_level_name(level);
     char formatted[LOG_LINE_LENGTH];
     snprintf(formatted, sizeof(formatted), "[%s] %s", levelName, message);
+    thread_mutex_lock(&bufferLock);
     snprintf(logBuffer[logHead], LOG_LINE_LENGTH, "%s", formatted);
     logHead = (logHead + 1) % LOG_MAX_LINES;
     if (logCount < LOG_MAX_LINES) logCount++;
+    thread_mutex_unlock(&bufferLock);
 }
@@ -0,0 +1,696 @@
+/*
+ * Downloader module - Background download engine
+ */
+
+#include "downloader.h"
+#include "api.h"
+#include "log.h"
+#include "md5.h"
+#include "partfile.h"
+#include "storage.h"
+#include "thread.h"
+#include "transport.h"
+#include "zip.h"
+#include "zipstream.h"
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/stat.h>
+
+#define DOWNLOADER_STACK_SIZE (64 * 1024)
+#define EXTRACT_BACKLOG 2 // Downloaded zips that may wait for the extractor
+#define HASH_CHUNK_SIZE (64 * 1024)
+
+typedef struct {
+    ThreadHandle *thread;
+    int romId;                   // Running job, -1 when idle; guarded by lock
+    atomic_bool cancelRequested; // Set by the main thread, polled by the job's progress callbacks
+
+    // Seqlock-published status: the worker is the only writer, so the main loop
+    // copies it without ever waiting on a transfer
+    atomic_uint statusSeq;
+    DownloadJobStatus shared;
+    DownloadJobStatus draft; // Worker-private
+
+    // Worker-private timing for the current phase (download or extraction)
+    uint64_t phaseStartMs;
+    uint32_t phaseStartBytes;
+    uint64_t lastPublishMs;
+    uint64_t rateStartMs;
+    uint32_t rateStartBytes;
+    uint32_t lastCurrent;
+} Worker;
+
+static Worker workers[DOWNLOADER_MAX_SLOTS];
+static int workerCount = 0;
+static bool started = false;
+
+// The worker running on this thread. Progress callbacks carry no context, and each job's
+// callbacks run on its own worker's thread.
+static _Thread_local Worker *self = NULL;
+
+// Pending jobs and finished results, guarded by lock
+static ThreadMutex lock;
+static ThreadCond jobReady;
+static DownloadJob jobs[DOWNLOADER_MAX_JOBS];
+static int jobHead = 0;
+static int jobCount = 0;
+static DownloadResult results[DOWNLOADER_MAX_JOBS];
+static int resultHead = 0;
+static int resultCount = 0;
+static int runningJobs = 0;
+static int slots = DOWNLOADER_DEFAULT_SLOTS;
+static bool stopping = false;
+
+// Batch counters for the status line, readable without the lock
+static atomic_int pendingJobs;
+static atomic_int doneJobs;
+static atomic_int batchJobs;
+
+// Bytes downloaded by all workers, for a batch rate that small files (each done within one
+// rate window) still register in. Wraps; only differences are used.
+static atomic_uint transferredBytes;
+static uint64_t batchRateStartMs; // Main-thread state for downloader_get_status()
+static unsigned int batchRateStartBytes;
+static uint64_t measuredBytes; // Rate windows summed since startup, for downloader_get_status()
+static uint64_t measuredMs;
+static uint32_t batchBytesPerSecond;
+
+// Zips that need the central directory are downloaded whole and then inflated by a separate
+// extractor thread, so the download worker moves on to the next job meanwhile. The backlog is
+// bounded: once it is full a worker extracts its own zip, which holds back its next download and
+// caps the archives parked on the SD card.
+typedef struct {
+    DownloadJob job;
+    bool verified; // The archive's MD5 already matched; skip the contents check
+} ExtractTask;
+
+static Worker extractor;
+static ThreadCond extractReady; // A task was queued, or stopping
+static ExtractTask extractQueue[EXTRACT_BACKLOG];
+static int extractHead = 0;
+static int extractCount = 0;
+
+// Caller holds lock
+static void update_pending_locked(void) {
+    atomic_store(&pendingJobs, jobCount + extractCount);
+}
+
+static void publish_status(Worker *w) {
+    atomic_fetch_add_explicit(&w->statusSeq, 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    w->shared = w->draft;
+    atomic_fetch_add_explicit(&w->statusSeq, 1, memory_order_release);
+}
+
+static void read_status(Worker *w, DownloadJobStatus *out) {
+    unsigned int before, after;
+    do {
+        before = atomic_load_explicit(&w->statusSeq, memory_order_acquire);
+        *out = w->shared;
+        atomic_thread_fence(memory_order_acquire);
+        after = atomic_load_explicit(&w->statusSeq, memory_order_relaxed);
+    } while (before != after || (before & 1));
+}
+
+void downloader_get_status(DownloadStatus *out) {
+    memset(out, 0, sizeof(DownloadStatus));
+    for (int i = 0; i <= DOWNLOADER_MAX_SLOTS; i++) {
+        DownloadJobStatus *job = &out->jobs[out->active];
+        read_status(i < DOWNLOADER_MAX_SLOTS ? &workers[i] : &extractor, job);
+        if (job->state == DOWNLOAD_STATE_IDLE) continue;
+        if (job->state == DOWNLOAD_STATE_EXTRACTING) out->extracting++;
+        out->active++;
+    }
+
+    uint64_t now = transport_now_ms();
+    unsigned int bytes = atomic_load(&transferredBytes);
+    if (out->active == 0) {
+        batchRateStartMs = 0;
+        batchBytesPerSecond = 0;
+    } else if (batchRateStartMs == 0) {
+        batchRateStartMs = now;
+        batchRateStartBytes = bytes;
+    } else if (now - batchRateStartMs >= DOWNLOADER_RATE_WINDOW_MS) {
+        batchBytesPerSecond = (uint32_t)((uint64_t)(bytes - batchRateStartBytes) * 1000 / (now - batchRateStartMs));
+        // Windows spent only extracting say nothing about the link
+        if (bytes != batchRateStartBytes) {
+            measuredBytes += bytes - batchRateStartBytes;
+            measuredMs += now - batchRateStartMs;
+        }
+        batchRateStartMs = now;
+        batchRateStartBytes = bytes;
+    }
+    out->bytesPerSecond = batchBytesPerSecond;
+    out->averageBytesPerSecond = measuredMs > 0 ? (uint32_t)(measuredBytes * 1000 / measuredMs) : 0;
+
+    out->pending = atomic_load(&pendingJobs);
+    out->done = atomic_load(&doneJobs);
+    out->batchSize = atomic_load(&batchJobs);
+    // The counters and snapshots are read separately; keep the totals self-consistent
+    int seen = out->done + out->active + out->pending;
+    if (out->batchSize < seen) out->batchSize = seen;
+}
+
+// Progress callback for both download and extraction, called on the worker after every chunk.
+// Only the cancel check runs per chunk; the snapshot is republished at most every
+// DOWNLOADER_STATUS_INTERVAL_MS (and on the final chunk) so the copy stays off the data path.
+static bool job_progress(uint32_t current, uint32_t total) {
+    Worker *w = self;
+    // (0, 0) only polls for cancel while waiting for a free connection
+    if (current == 0 && total == 0) return !atomic_load(&w->cancelRequested);
+
+    uint64_t now = transport_now_ms();
+    w->draft.current = current;
+    w->draft.total = total;
+
+    if (w->phaseStartMs == 0) {
+        // Resumed downloads start part-way through; measure only what this run transfers
+        w->phaseStartMs = w->rateStartMs = now;
+        w->phaseStartBytes = w->rateStartBytes = current;
+        w->lastCurrent = current;
+    } else if (now - w->rateStartMs >= DOWNLOADER_RATE_WINDOW_MS) {
+        uint32_t bytes = current >= w->rateStartBytes ? current - w->rateStartBytes : 0;
+        w->draft.bytesPerSecond = (uint32_t)((uint64_t)bytes * 1000 / (now - w->rateStartMs));
+        w->rateStartMs = now;
+        w->rateStartBytes = current;
+    }
+    if (w->draft.state == DOWNLOAD_STATE_DOWNLOADING && current > w->lastCurrent) {
+        atomic_fetch_add(&transferredBytes, current - w->lastCurrent);
+    }
+    w->lastCurrent = current;
+
+    if (now - w->lastPublishMs >= DOWNLOADER_STATUS_INTERVAL_MS || (total > 0 && current >= total)) {
+        w->lastPublishMs = now;
+        publish_status(w);
+    }
+    return !atomic_load(&w->cancelRequested);
+}
+
+static void set_state(DownloadState state) {
+    self->draft.state = state;
+    self->draft.current = 0;
+    self->draft.total = 0;
+    self->draft.bytesPerSecond = 0;
+    self->phaseStartMs = 0;
+    self->lastPublishMs = 0;
+    publish_status(self);
+}
+
+// Average rate of the phase that just finished, in KB/s
+static double phase_kbps(void) {
+    uint64_t elapsed = self->phaseStartMs ? transport_now_ms() - self->phaseStartMs : 0;
+    uint32_t bytes = self->draft.current >= self->phaseStartBytes ? self->draft.current - self->phaseStartBytes : 0;
+    return elapsed > 0 ? bytes / 1024.0 * 1000.0 / elapsed : 0;
+}
+
+// Keep receiving after the central directory is reached, so the whole archive is hashed
+static bool zip_stream_sink(void *ctx, const uint8_t *data, size_t len) {
+    ZipStreamResult result = zipstream_feed(ctx, data, len);
+    return result == ZIPSTREAM_OK || result == ZIPSTREAM_DONE;
+}
+
+typedef enum { JOB_OK, JOB_FAILED, JOB_CORRUPT, JOB_NO_SPACE, JOB_HANDED_OFF } JobOutcome;
+
+typedef enum { STREAM_EXTRACTED, STREAM_CANCELLED, STREAM_CORRUPT, STREAM_NO_SPACE, STREAM_FALLBACK } StreamOutcome;
+
+// RomM hashes an archive's contents rather than the archive, so a zip passes if either matches
+static bool zip_md5_matches(const DownloadJob *job, const char *archiveMd5, const char *contentMd5) {
+    if (!job->md5[0]) return true;
+    if (strcasecmp(archiveMd5, job->md5) == 0 || strcasecmp(contentMd5, job->md5) == 0) return true;
+    log_error("MD5 mismatch for %s: archive %s, contents %s, expected %s", job->label, archiveMd5, contentMd5,
+              job->md5);
+    return false;
+}
+
+// Directory a job's zip is extracted into: the one it was downloaded to
+static void job_dest_dir(const DownloadJob *job, char *out, size_t outSize) {
+    snprintf(out, outSize, "%s", job->destPath);
+    char *lastSlash = strrchr(out, '/');
+    if (lastSlash) *lastSlash = '\0';
+}
+
+// Queue a downloaded zip for the extractor. Returns false if the backlog is full.
+static bool hand_off_extraction(const DownloadJob *job, bool verified) {
+    thread_mutex_lock(&lock);
+    bool queued = extractCount < EXTRACT_BACKLOG && !stopping;
+    if (queued) {
+        ExtractTask *task = &extractQueue[(extractHead + extractCount) % EXTRACT_BACKLOG];
+        task->job = *job;
+        task->verified = verified;
+        extractCount++;
+        update_pending_locked();
+        thread_cond_signal(&extractReady);
+    }
+    thread_mutex_unlock(&lock);
+    return queued;
+}
+
+// Inflate a zip straight from the network into destDir, so the archive never touches the SD card.
+// Anything short of a verified archive removes what was extracted and asks for the file-based path.
+static StreamOutcome stream_extract(const DownloadJob *job, const char *destDir) {
+    ZipStream *zs = zipstream_open(destDir);
+    if (!zs) return STREAM_FALLBACK;
+
+    log_info("Streaming zip into: %s", destDir);
+    char archiveMd5[MD5_HEX_LEN];
+    bool delivered = api_stream_rom(job->romId, job->fsName, zip_stream_sink, zs, job_progress, archiveMd5);
+    // The sink stops the transfer as soon as the stream fails; an empty feed reports where it stopped
+    ZipStreamResult result = delivered ? zipstream_finish(zs) : zipstream_feed(zs, NULL, 0);
+    bool ok = result == ZIPSTREAM_DONE;
+    bool corrupt = false;
+    if (ok) {
+        char contentMd5[MD5_HEX_LEN];
+        zipstream_content_md5(zs, contentMd5);
+        corrupt = !zip_md5_matches(job, archiveMd5, contentMd5);
+    }
+    uint32_t extracted = zipstream_bytes_written(zs);
+    zipstream_close(zs, ok && !corrupt);
+
+    if (corrupt) return STREAM_CORRUPT;
+    if (result == ZIPSTREAM_NO_SPACE) return STREAM_NO_SPACE;
+    if (ok) {
+        log_info("Download and extraction complete: %s (%.0f KB/s, %lu bytes extracted)", job->label, phase_kbps(),
+                 (unsigned long)extracted);
+        return STREAM_EXTRACTED;
+    }
+    if (atomic_load(&self->cancelRequested)) return STREAM_CANCELLED;
+    if (result == ZIPSTREAM_UNSUPPORTED) {
+        log_info("Zip needs its central directory, downloading it first");
+    } else {
+        log_warn("Streamed extraction failed, downloading the zip instead");
+    }
+    return STREAM_FALLBACK;
+}
+
+// Extract a downloaded zip, on the extractor thread or on a worker when the backlog is full
+static JobOutcome extract_job(const ExtractTask *task) {
+    const DownloadJob *job = &task->job;
+    self->draft.romId = job->romId;
+    snprintf(self->draft.label, sizeof(self->draft.label), "%s", job->label);
+    set_state(DOWNLOAD_STATE_EXTRACTING);
+
+    char destDir[DOWNLOADER_MAX_PATH_LEN];
+    job_dest_dir(job, destDir, sizeof(destDir));
+    log_info("Extracting zip: %s", job->destPath);
+    ZipExtractResult extracted = zip_extract(job->destPath, destDir, job_progress, task->verified ? NULL : job->md5);
+    // Only a bad archive is deleted. Otherwise it stays, complete, and the next attempt extracts it without
+    // downloading it again (see has_kept_archive()).
+    if (extracted == ZIP_EXTRACT_CORRUPT) {
+        log_error("Archive is corrupt, deleting it: %s", job->destPath);
+        remove(job->destPath);
+        return JOB_CORRUPT;
+    }
+    if (extracted == ZIP_EXTRACT_NO_SPACE) {
+        log_warn("Not enough space to extract %s, keeping the archive for later", job->destPath);
+        return JOB_NO_SPACE;
+    }
+    if (extracted != ZIP_EXTRACT_OK) {
+        log_error("Extraction failed, keeping the archive: %s", job->destPath);
+        return JOB_FAILED;
+    }
+    log_info("Extraction complete: %s (%.0f KB/s)", job->label, phase_kbps());
+    return JOB_OK;
+}
+
+// Fetch a job's file and verify it. A zip is extracted on the way in when it can be streamed (*extracted is
+// set); otherwise the archive is left on the card for extraction and *verified says whether its MD5 matched.
+static JobOutcome transfer_job(const DownloadJob *job, bool resumable, bool *extracted, bool *verified) {
+    // Zips are extracted as they arrive, unless an interrupted download of the archive can be resumed
+    bool isZip = zip_is_zip_file(job->destPath);
+    if (isZip && !resumable) {
+        char destDir[DOWNLOADER_MAX_PATH_LEN];
+        job_dest_dir(job, destDir, sizeof(destDir));
+        StreamOutcome streamed = stream_extract(job, destDir);
+        *extracted = streamed == STREAM_EXTRACTED;
+        if (streamed == STREAM_EXTRACTED) return JOB_OK;
+        if (streamed == STREAM_CORRUPT) return JOB_CORRUPT;
+        if (streamed == STREAM_NO_SPACE) return JOB_NO_SPACE;
+        if (streamed == STREAM_CANCELLED) return JOB_FAILED;
+        set_state(DOWNLOAD_STATE_DOWNLOADING);
+    }
+
+    // Claim room for the file only once it is really downloaded (a streamed zip never writes its archive, and its
+    // entries claim their own), less what a resumable part file already takes: all of it once preallocated.
+    // api_download_rom() ends the claim when it preallocates the part file; from then on the file holds the space.
+    uint64_t allocated = resumable ? partfile_allocated(job->destPath) : 0;
+    uint64_t claim = job->sizeBytes > allocated ? job->sizeBytes - allocated : 0;
+    if (!storage_reserve(job->destPath, claim)) return JOB_NO_SPACE;
+
+    log_info("Downloading to: %s", job->destPath);
+    char md5[MD5_HEX_LEN];
+    bool downloaded =
+        api_download_rom(job->romId, job->fsName, job->destPath, job_progress, job->md5[0] ? md5 : NULL, &claim);
+    storage_release(claim);
+    if (!downloaded) {
+        log_error("Download failed: %s", job->label);
+        return JOB_FAILED;
+    }
+    log_info("Download complete: %s (%.0f KB/s)", job->label, phase_kbps());
+
+    // A zip whose archive hash matches needs no second check; otherwise its contents must
+    *verified = !job->md5[0] || strcasecmp(md5, job->md5) == 0;
+    if (*verified || isZip) return JOB_OK;
+    log_error("MD5 mismatch for %s: got %s, expected %s", job->label, md5, job->md5);
+    remove(job->destPath);
+    return JOB_CORRUPT;
+}
+
+// A whole zip left at destPath by an earlier run that stopped before extracting it (quit, or short of space
+// for the contents). The download completed, so there is no part file.
+static bool has_kept_archive(const DownloadJob *job) {
+    struct stat st;
+    if (!zip_is_zip_file(job->destPath) || stat(job->destPath, &st) != 0 || !S_ISREG(st.st_mode)) return false;
+    return job->sizeBytes == 0 || (uint64_t)st.st_size == job->sizeBytes;
+}
+
+// Check a kept archive against the job's MD5, reporting progress like a download. Returns false if cancelled
+// or unreadable; *verified says whether the archive itself matched (otherwise extraction checks the contents).
+static bool check_kept_archive(const DownloadJob *job, bool *verified) {
+    *verified = !job->md5[0];
+    if (*verified) return true;
+    FILE *file = fopen(job->destPath, "rb");
+    uint8_t *buffer = malloc(HASH_CHUNK_SIZE);
+    bool ok = file && buffer;
+    Md5Context md5;
+    md5_init(&md5);
+    uint32_t hashed = 0;
+    size_t got;
+    while (ok && (got = fread(buffer, 1, HASH_CHUNK_SIZE, file)) > 0) {
+        md5_update(&md5, buffer, got);
+        hashed += got;
+        ok = job_progress(hashed, (uint32_t)job->sizeBytes);
+    }
+    if (ok && file && ferror(file)) ok = false;
+    free(buffer);
+    if (file) fclose(file);
+    if (!ok) return false;
+    char actual[MD5_HEX_LEN];
+    md5_final_hex(&md5, actual);
+    *verified = strcasecmp(actual, job->md5) == 0;
+    return true;
+}
+
+// Download one job and verify it. Zips are extracted as they stream in, or handed to the extractor.
+static JobOutcome run_job(const DownloadJob *job) {
+    self->draft.romId = job->romId;
+    snprintf(self->draft.label, sizeof(self->draft.label), "%s", job->label);
+    set_state(DOWNLOAD_STATE_DOWNLOADING);
+
+    PartInfo part;
+    bool resumable = partfile_load(job->destPath, &part);
+    bool extracted = false;
+    bool verified = false;
+    JobOutcome outcome;
+    if (!resumable && has_kept_archive(job)) {
+        log_info("Found %s from an earlier run, extracting it instead of downloading again", job->destPath);
+        set_state(DOWNLOAD_STATE_EXTRACTING); // Reading the card, not the network
+        outcome = check_kept_archive(job, &verified) ? JOB_OK : JOB_FAILED;
+    } else {
+        outcome = transfer_job(job, resumable, &extracted, &verified);
+    }
+    if (outcome != JOB_OK || extracted || !zip_is_zip_file(job->destPath)) return outcome;
+
+    ExtractTask task = {*job, verified};
+    if (hand_off_extraction(job, verified)) return JOB_HANDED_OFF;
+    log_debug("Extraction backlog full, extracting %s here", job->label);
+    return extract_job(&task);
+}
+
+// Record a finished job for downloader_poll_result(). Caller holds lock.
+static void post_result_locked(int romId, JobOutcome outcome, bool cancelled) {
+    DownloadResult result = {romId, outcome == JOB_OK, cancelled, outcome == JOB_CORRUPT, outcome == JOB_NO_SPACE};
+    if (resultCount == DOWNLOADER_MAX_JOBS) {
+        // Main loop stopped polling; drop the oldest
+        resultHead = (resultHead + 1) % DOWNLOADER_MAX_JOBS;
+        resultCount--;
+    }
+    results[(resultHead + resultCount) % DOWNLOADER_MAX_JOBS] = result;
+    resultCount++;
+    if (cancelled) {
+        atomic_fetch_sub(&batchJobs, 1);
+    } else {
+        atomic_fetch_add(&doneJobs, 1);
+    }
+}
+
+// Publish this thread's slot as idle
+static void clear_slot(void) {
+    self->draft.romId = -1;
+    self->draft.label[0] = '\0';
+    set_state(DOWNLOAD_STATE_IDLE);
+}
+
+static void worker_main(void *arg) {
+    self = arg;
+    while (true) {
+        thread_mutex_lock(&lock);
+        while ((jobCount == 0 || runningJobs >= slots) && !stopping) thread_cond_wait(&jobReady, &lock);
+        if (stopping) {
+            thread_mutex_unlock(&lock);
+            break;
+        }
+        DownloadJob job = jobs[jobHead];
+        jobHead = (jobHead + 1) % DOWNLOADER_MAX_JOBS;
+        jobCount--;
+        update_pending_locked();
+        runningJobs++;
+        self->romId = job.romId;
+        atomic_store(&self->cancelRequested, false);
+        thread_mutex_unlock(&lock);
+
+        JobOutcome outcome = run_job(&job);
+        bool cancelled = outcome == JOB_FAILED && atomic_load(&self->cancelRequested);
+
+        thread_mutex_lock(&lock);
+        // A handed-off job reports its result once the extractor is done with it
+        if (outcome != JOB_HANDED_OFF) post_result_locked(job.romId, outcome, cancelled);
+        self->romId = -1;
+        runningJobs--;
+        // A worker held back by the slot limit can take the next job
+        if (jobCount > 0) thread_cond_signal(&jobReady);
+        thread_mutex_unlock(&lock);
+
+        clear_slot();
+    }
+}
+
+static void extractor_main(void *arg) {
+    self = arg;
+    while (true) {
+        thread_mutex_lock(&lock);
+        while (extractCount == 0 && !stopping) thread_cond_wait(&extractReady, &lock);
+        if (stopping) {
+            thread_mutex_unlock(&lock);
+            break;
+        }
+        ExtractTask task = extractQueue[extractHead];
+        extractHead = (extractHead + 1) % EXTRACT_BACKLOG;
+        extractCount--;
+        update_pending_locked();
+        self->romId = task.job.romId;
+        atomic_store(&self->cancelRequested, false);
+        thread_mutex_unlock(&lock);
+
+        JobOutcome outcome = extract_job(&task);
+        bool cancelled = outcome == JOB_FAILED && atomic_load(&self->cancelRequested);
+
+        thread_mutex_lock(&lock);
+        post_result_locked(task.job.romId, outcome, cancelled);
+        self->romId = -1;
+        thread_mutex_unlock(&lock);
+
+        clear_slot();
+    }
+}
+
+// Forget zips still waiting for the extractor, deleting them if cancelled. Caller holds lock.
+static void drop_extract_backlog_locked(bool deleteArchives) {
+    for (int i = 0; i < extractCount; i++) {
+        const char *path = extractQueue[(extractHead + i) % EXTRACT_BACKLOG].job.destPath;
+        if (deleteArchives) {
+            remove(path);
+        } else {
+            log_info("Left %s for extraction next run", path);
+        }
+    }
+    atomic_fetch_sub(&batchJobs, extractCount);
+    extractCount = 0;
+}
+
+// Start workers until there is one per slot. Caller holds lock (or is the only thread).
+static void start_workers_locked(void) {
+    while (workerCount < slots) {
+        Worker *w = &workers[workerCount];
+        w->thread = thread_start(worker_main, w, DOWNLOADER_STACK_SIZE);
+        if (!w->thread) {
+            log_error("Failed to start download worker %d", workerCount + 1);
+            break;
+        }
+        workerCount++;
+    }
+}
+
+bool downloader_init(void) {
+    if (started) return true;
+    thread_mutex_init(&lock);
+    thread_cond_init(&jobReady);
+    thread_cond_init(&extractReady);
+    jobHead = jobCount = 0;
+    extractHead = extractCount = 0;
+    resultHead = resultCount = 0;
+    runningJobs = 0;
+    stopping = false;
+    atomic_store(&pendingJobs, 0);
+    atomic_store(&doneJobs, 0);
+    atomic_store(&batchJobs, 0);
+    atomic_store(&transferredBytes, 0);
+
+    memset(workers, 0, sizeof(workers));
+    memset(&extractor, 0, sizeof(extractor));
+    for (int i = 0; i <= DOWNLOADER_MAX_SLOTS; i++) {
+        Worker *w = i < DOWNLOADER_MAX_SLOTS ? &workers[i] : &extractor;
+        atomic_init(&w->cancelRequested, false);
+        atomic_init(&w->statusSeq, 0);
+        w->romId = -1;
+        w->draft.romId = -1;
+        publish_status(w);
+    }
+
+    extractor.thread = thread_start(extractor_main, &extractor, DOWNLOADER_STACK_SIZE);
+    if (!extractor.thread) {
+        log_error("Failed to start extraction worker");
+        return false;
+    }
+    workerCount = 0;
+    start_workers_locked();
+    started = true;
+    if (workerCount == 0) {
+        downloader_exit();
+        return false;
+    }
+    return true;
+}
+
+void downloader_exit(void) {
+    if (!started) return;
+    // Quitting isn't a cancel: interrupted downloads keep their part files and resume next run
+    api_interrupt_downloads();
+    thread_mutex_lock(&lock);
+    stopping = true;
+    jobCount = 0;
+    for (int i = 0; i < workerCount; i++) atomic_store(&workers[i].cancelRequested, true);
+    atomic_store(&extractor.cancelRequested, true);
+    thread_cond_broadcast(&jobReady);
+    thread_cond_broadcast(&extractReady);
+    thread_mutex_unlock(&lock);
+
+    for (int i = 0; i < workerCount; i++) thread_join(workers[i].thread);
+    thread_join(extractor.thread);
+    // Those archives are downloaded and checked; the next run extracts them instead of downloading again
+    thread_mutex_lock(&lock);
+    drop_extract_backlog_locked(false);
+    thread_mutex_unlock(&lock);
+    workerCount = 0;
+    started = false;
+}
+
+void downloader_set_slots(int count) {
+    if (count < 1) count = 1;
+    if (count > DOWNLOADER_MAX_SLOTS) count = DOWNLOADER_MAX_SLOTS;
+    if (!started) {
+        slots = count;
+        return;
+    }
+    thread_mutex_lock(&lock);
+    slots = count;
+    start_workers_locked();
+    thread_cond_broadcast(&jobReady);
+    thread_mutex_unlock(&lock);
+}
+
+// Caller holds lock
+static bool has_job_locked(int romId) {
+    for (int i = 0; i < workerCount; i++) {
+        if (workers[i].romId == romId) return true;
+    }
+    if (extractor.romId == romId) return true;
+    for (int i = 0; i < extractCount; i++) {
+        if (extractQueue[(extractHead + i) % EXTRACT_BACKLOG].job.romId == romId) return true;
+    }
+    for (int i = 0; i < jobCount; i++) {
+        if (jobs[(jobHead + i) % DOWNLOADER_MAX_JOBS].romId == romId) return true;
+    }
+    return false;
+}
+
+bool downloader_submit(const DownloadJob *job) {
+    if (!started) return false;
+    thread_mutex_lock(&lock);
+    bool added = jobCount < DOWNLOADER_MAX_JOBS && !has_job_locked(job->romId);
+    if (added) {
+        if (jobCount == 0 && runningJobs == 0 && extractCount == 0 && extractor.romId < 0) {
+            // Nothing in flight: a new batch starts
+            atomic_store(&doneJobs, 0);
+            atomic_store(&batchJobs, 0);
+        }
+        jobs[(jobHead + jobCount) % DOWNLOADER_MAX_JOBS] = *job;
+        jobCount++;
+        update_pending_locked();
+        atomic_fetch_add(&batchJobs, 1);
+        thread_cond_signal(&jobReady);
+    }
+    thread_mutex_unlock(&lock);
+    return added;
+}
+
+bool downloader_has_job(int romId) {
+    if (!started) return false;
+    thread_mutex_lock(&lock);
+    bool found = has_job_locked(romId);
+    thread_mutex_unlock(&lock);
+    return found;
+}
+
+uint64_t downloader_pending_bytes(void) {
+    if (!started) return 0;
+    uint64_t total = 0;
+    thread_mutex_lock(&lock);
+    for (int i = 0; i < jobCount; i++) {
+        total += jobs[(jobHead + i) % DOWNLOADER_MAX_JOBS].sizeBytes;
+    }
+    for (int i = 0; i < extractCount; i++) {
+        total += extractQueue[(extractHead + i) % EXTRACT_BACKLOG].job.sizeBytes;
+    }
+    thread_mutex_unlock(&lock);
+    return total;
+}
+
+void downloader_cancel_all(void) {
+    if (!started) return;
+    thread_mutex_lock(&lock);
+    atomic_fetch_sub(&batchJobs, jobCount);
+    jobCount = 0;
+    for (int i = 0; i < workerCount; i++) {
+        if (workers[i].romId >= 0) atomic_store(&workers[i].cancelRequested, true);
+    }
+    drop_extract_backlog_locked(true);
+    update_pending_locked();
+    if (extractor.romId >= 0) atomic_store(&extractor.cancelRequested, true);
+    thread_mutex_unlock(&lock);
+}
+
+bool downloader_poll_result(DownloadResult *out) {
+    if (!started) return false;
+    thread_mutex_lock(&lock);
+    bool found = resultCount > 0;
+    if (found) {
+        *out = results[resultHead];
+        resultHead = (resultHead + 1) % DOWNLOADER_MAX_JOBS;
+        resultCount--;
+    }
+    thread_mutex_unlock(&lock);
+    return found;
+}
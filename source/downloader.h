@@ -0,0 +1,98 @@
+/*
+ * Downloader module - Background download engine
+ *
+ * A small pool of worker threads runs jobs concurrently, verifying the MD5
+ * hashed along the way. Zips are inflated as they stream in; those that need
+ * their central directory are downloaded whole and passed to an extractor
+ * thread, so the next download starts while the last one is extracted.
+ * The main loop reads lock-free progress snapshots each frame and collects
+ * finished jobs, so queue bookkeeping and rendering stay on the main thread
+ * while the user keeps browsing. Workers publish progress on a timer rather
+ * than per chunk, so the data path never waits on the UI.
+ */
+
+#ifndef DOWNLOADER_H
+#define DOWNLOADER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define DOWNLOADER_MAX_JOBS 64
+#define DOWNLOADER_MAX_SLOTS 4 // Most jobs that can run at once
+#define DOWNLOADER_DEFAULT_SLOTS 2
+#define DOWNLOADER_MAX_PATH_LEN 640
+#define DOWNLOADER_LABEL_LEN 384
+#define DOWNLOADER_STATUS_INTERVAL_MS 33 // Progress is published at most ~30 times per second
+#define DOWNLOADER_RATE_WINDOW_MS 1000
+
+typedef struct {
+    int romId;
+    char fsName[256];                 // Used in the download URL
+    char label[DOWNLOADER_LABEL_LEN]; // Shown while the job runs, e.g. "[gba] Name"
+    char destPath[DOWNLOADER_MAX_PATH_LEN];
+    char md5[33];       // Expected MD5 of the file as the server stores it, empty to skip verification
+    uint64_t sizeBytes; // Expected file size, claimed from free space before starting; 0 if unknown
+} DownloadJob;
+
+typedef enum { DOWNLOAD_STATE_IDLE, DOWNLOAD_STATE_DOWNLOADING, DOWNLOAD_STATE_EXTRACTING } DownloadState;
+
+// Snapshot of one running job
+typedef struct {
+    DownloadState state;
+    int romId;
+    uint32_t current;
+    uint32_t total;          // 0 if unknown
+    uint32_t bytesPerSecond; // Over the last rate window, 0 until the first window closes
+    char label[DOWNLOADER_LABEL_LEN];
+} DownloadJobStatus;
+
+// Snapshot of the whole downloader
+typedef struct {
+    DownloadJobStatus jobs[DOWNLOADER_MAX_SLOTS + 1]; // Workers and extractor; the first `active` are running
+    int active;
+    int extracting;                 // How many of the active jobs are being extracted
+    int pending;                    // Jobs waiting for a free slot or for the extractor
+    int done;                       // Jobs finished since the downloader was last idle
+    int batchSize;                  // done + active + pending
+    uint32_t bytesPerSecond;        // Downloaded by all jobs over the last rate window
+    uint32_t averageBytesPerSecond; // Over every rate window since startup, 0 until one closes (for ETAs)
+} DownloadStatus;
+
+// Outcome of a finished job
+typedef struct {
+    int romId;
+    bool success;
+    bool cancelled;
+    bool corrupt; // Transfer completed but failed its MD5 or CRC32 check
+    bool noSpace; // Refused or stopped because the card is too full; only a downloaded archive is kept
+} DownloadResult;
+
+// Start the worker pool
+bool downloader_init(void);
+
+// Stop the workers, interrupting running downloads so they resume next run (call before api_exit)
+void downloader_exit(void);
+
+// Run up to slots jobs at once (1..DOWNLOADER_MAX_SLOTS). Running jobs are not interrupted.
+void downloader_set_slots(int slots);
+
+// Add a job to the end of the line. Returns false if full or the ROM is already pending or running.
+bool downloader_submit(const DownloadJob *job);
+
+// Check if a ROM is pending or running
+bool downloader_has_job(int romId);
+
+// Expected size of the jobs that have not claimed free space yet: those waiting for a slot, and zips waiting for
+// the extractor (whose contents are counted at the archive size). Running jobs hold claims of their own.
+uint64_t downloader_pending_bytes(void);
+
+// Drop pending jobs and cancel the running ones
+void downloader_cancel_all(void);
+
+// Read the current progress without blocking the workers (main thread only: it also advances the batch rate)
+void downloader_get_status(DownloadStatus *out);
+
+// Pop the next finished job. Returns false if there is none.
+bool downloader_poll_result(DownloadResult *out);
+
+#endif // DOWNLOADER_H
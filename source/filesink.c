@@ -0,0 +1,244 @@
+/*
+ * File sink module - Pluggable SD card writer used by downloads and extraction
+ */
+
+#include "filesink.h"
+#include "log.h"
+#include "transport.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BENCHMARK_FILE "sinkbench.tmp"
+
+struct FileSink {
+    const FileSinkBackend *backend;
+    void *handle;
+    uint8_t *buffer;   // Allocated on the first write
+    size_t capacity;   // 0 writes straight through
+    size_t used;       // Bytes waiting in buffer
+    uint64_t position; // File offset of buffer[0], where the next backend write lands
+    bool failed;
+    uint64_t bytes; // Handed to the backend
+    uint32_t calls; // Backend writes
+    uint64_t micros;
+    char path[];
+};
+
+static const FileSinkBackend *const builtinBackends[] = {
+    &filesink_stdio_backend,
+#ifdef __3DS__
+    &filesink_fsdirect_backend,
+#endif
+};
+#define BUILTIN_COUNT (int)(sizeof(builtinBackends) / sizeof(builtinBackends[0]))
+
+static const size_t benchmarkBuffers[] = {0, FILESINK_DEFAULT_BUFFER, FILESINK_MAX_BUFFER};
+#define BENCHMARK_BUFFER_COUNT (int)(sizeof(benchmarkBuffers) / sizeof(benchmarkBuffers[0]))
+
+static const FileSinkBackend *activeBackend = &filesink_stdio_backend;
+static size_t bufferSize = FILESINK_DEFAULT_BUFFER;
+static bool initialized[BUILTIN_COUNT];
+
+static int builtin_index(const FileSinkBackend *backend) {
+    for (int i = 0; i < BUILTIN_COUNT; i++) {
+        if (builtinBackends[i] == backend) return i;
+    }
+    return -1;
+}
+
+void filesink_exit(void) {
+    for (int i = 0; i < BUILTIN_COUNT; i++) {
+        if (initialized[i] && builtinBackends[i]->exit) builtinBackends[i]->exit();
+        initialized[i] = false;
+    }
+}
+
+bool filesink_set_backend(const FileSinkBackend *backend) {
+    if (!backend) return false;
+    int index = builtin_index(backend);
+    if (index < 0 || !initialized[index]) {
+        if (backend->init && !backend->init()) {
+            log_error("Failed to initialize %s file sink", backend->name);
+            return false;
+        }
+        if (index >= 0) initialized[index] = true;
+    }
+    activeBackend = backend;
+    return true;
+}
+
+bool filesink_select(const char *name) {
+    for (int i = 0; i < BUILTIN_COUNT; i++) {
+        if (strcmp(builtinBackends[i]->name, name) == 0) return filesink_set_backend(builtinBackends[i]);
+    }
+    return false;
+}
+
+const FileSinkBackend *filesink_get_backend(void) {
+    return activeBackend;
+}
+
+void filesink_set_buffer_size(size_t bytes) {
+    if (bytes > FILESINK_MAX_BUFFER) bytes = FILESINK_MAX_BUFFER;
+    bufferSize = bytes / FILESINK_ALIGN * FILESINK_ALIGN;
+}
+
+size_t filesink_get_buffer_size(void) {
+    return bufferSize;
+}
+
+FileSink *filesink_open(const char *path, bool existing, uint64_t offset) {
+    size_t pathLen = strlen(path) + 1;
+    FileSink *sink = calloc(1, sizeof(FileSink) + pathLen);
+    if (!sink) return NULL;
+    memcpy(sink->path, path, pathLen);
+    sink->backend = activeBackend;
+    sink->capacity = bufferSize;
+    sink->position = offset;
+    sink->handle = sink->backend->open(path, existing, offset);
+    if (!sink->handle) {
+        log_error("Failed to open file: %s (errno: %d)", path, errno);
+        free(sink);
+        return NULL;
+    }
+    return sink;
+}
+
+// Hand bytes to the backend, counting the call and its time
+static bool backend_write(FileSink *sink, const void *data, size_t len) {
+    uint64_t start = transport_now_us();
+    bool ok = sink->backend->write(sink->handle, data, len);
+    sink->micros += transport_now_us() - start;
+    sink->calls++;
+    if (!ok) {
+        log_error("Failed to write to file: %s", sink->path);
+        sink->failed = true;
+        return false;
+    }
+    sink->bytes += len;
+    sink->position += len;
+    return true;
+}
+
+static bool drain(FileSink *sink) {
+    if (sink->used == 0) return true;
+    size_t len = sink->used;
+    sink->used = 0;
+    return backend_write(sink, sink->buffer, len);
+}
+
+bool filesink_write(FileSink *sink, const void *data, size_t len) {
+    if (sink->failed) return false;
+    if (sink->capacity > 0 && !sink->buffer) {
+        sink->buffer = aligned_alloc(FILESINK_ALIGN, sink->capacity);
+        if (!sink->buffer) {
+            log_warn("Failed to allocate %lu byte write buffer, writing through", (unsigned long)sink->capacity);
+            sink->capacity = 0;
+        }
+    }
+    if (sink->capacity == 0) return backend_write(sink, data, len);
+
+    const uint8_t *p = data;
+    while (len > 0) {
+        // Fill only up to the next multiple of the buffer size, so every write after the first starts aligned
+        size_t limit = sink->capacity - (size_t)(sink->position % sink->capacity);
+        if (sink->used == 0 && len >= limit) {
+            // Whole aligned blocks skip the copy
+            size_t direct = limit + (len - limit) / sink->capacity * sink->capacity;
+            if (!backend_write(sink, p, direct)) return false;
+            p += direct;
+            len -= direct;
+            continue;
+        }
+        size_t n = limit - sink->used < len ? limit - sink->used : len;
+        memcpy(sink->buffer + sink->used, p, n);
+        sink->used += n;
+        p += n;
+        len -= n;
+        if (sink->used == limit && !drain(sink)) return false;
+    }
+    return true;
+}
+
+bool filesink_set_size(FileSink *sink, uint64_t size) {
+    return sink->backend->set_size(sink->handle, size);
+}
+
+bool filesink_flush(FileSink *sink) {
+    if (sink->failed || !drain(sink)) return false;
+    uint64_t start = transport_now_us();
+    bool ok = sink->backend->flush(sink->handle);
+    sink->micros += transport_now_us() - start;
+    return ok;
+}
+
+bool filesink_close(FileSink *sink) {
+    if (!sink) return true;
+    bool ok = !sink->failed && drain(sink);
+    uint64_t start = transport_now_us();
+    if (!sink->backend->close(sink->handle)) ok = false;
+    sink->micros += transport_now_us() - start;
+
+    if (sink->bytes > 0) {
+        double mb = sink->bytes / (1024.0 * 1024.0);
+        log_debug("%s/%luK: %.1f MB in %lu writes (%.1f per MB), %.1f MB/s", sink->backend->name,
+                  (unsigned long)(sink->capacity / 1024), mb, (unsigned long)sink->calls, sink->calls / mb,
+                  sink->micros > 0 ? mb * 1000000.0 / sink->micros : 0.0);
+    }
+    free(sink->buffer);
+    free(sink);
+    return ok;
+}
+
+// Time one pass of the benchmark with the active backend and buffer size. Returns bytes per second, 0 on failure.
+static double benchmark_pass(const char *path, const uint8_t *data, uint32_t size, size_t chunk, uint32_t *calls) {
+    uint64_t start = transport_now_us();
+    FileSink *sink = filesink_open(path, false, 0);
+    if (!sink) return 0;
+    bool ok = filesink_set_size(sink, size);
+    for (uint32_t done = 0; ok && done < size; done += chunk) {
+        ok = filesink_write(sink, data, size - done < chunk ? size - done : chunk);
+    }
+    if (ok) ok = drain(sink);
+    *calls = sink->calls;
+    if (!filesink_close(sink)) ok = false;
+    uint64_t micros = transport_now_us() - start;
+    remove(path);
+    return ok && micros > 0 ? size * 1000000.0 / micros : 0;
+}
+
+bool filesink_benchmark(const char *dir, uint32_t size, size_t chunk) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", dir, BENCHMARK_FILE);
+    uint8_t *data = malloc(chunk);
+    if (!data) return false;
+    for (size_t i = 0; i < chunk; i++) data[i] = (uint8_t)(i * 31 + 7);
+
+    const FileSinkBackend *bestBackend = activeBackend;
+    size_t bestBuffer = bufferSize;
+    double bestRate = 0;
+    for (int b = 0; b < BUILTIN_COUNT; b++) {
+        if (!filesink_set_backend(builtinBackends[b])) continue;
+        for (int s = 0; s < BENCHMARK_BUFFER_COUNT; s++) {
+            filesink_set_buffer_size(benchmarkBuffers[s]);
+            uint32_t calls = 0;
+            double rate = benchmark_pass(path, data, size, chunk, &calls);
+            log_info("Sink %s/%luK: %.1f MB/s, %lu writes", builtinBackends[b]->name,
+                     (unsigned long)(benchmarkBuffers[s] / 1024), rate / (1024 * 1024), (unsigned long)calls);
+            if (rate > bestRate) {
+                bestRate = rate;
+                bestBackend = builtinBackends[b];
+                bestBuffer = benchmarkBuffers[s];
+            }
+        }
+    }
+    free(data);
+    // Left as they were if nothing could write
+    filesink_set_backend(bestBackend);
+    filesink_set_buffer_size(bestBuffer);
+    if (bestRate == 0) return false;
+    log_info("Using %s file sink with %luK buffer", bestBackend->name, (unsigned long)(bestBuffer / 1024));
+    return true;
+}
@@ -0,0 +1,79 @@
+/*
+ * File sink module - Pluggable SD card writer used by downloads and extraction
+ *
+ * Every file the app streams to the card goes through a sink: a backend that
+ * does the actual writes, optionally fronted by a write-combining buffer that
+ * turns many chunk-sized writes into a few large ones at aligned offsets.
+ * Each sink counts its write calls and time and logs them when closed, so
+ * backends and buffer sizes can be compared on real transfers.
+ */
+
+#ifndef FILESINK_H
+#define FILESINK_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define FILESINK_DEFAULT_BUFFER (256 * 1024)
+#define FILESINK_MAX_BUFFER (1024 * 1024)
+#define FILESINK_ALIGN 4096 // Buffers are allocated at this alignment; flushes land on buffer-size offsets
+
+// Backend implementation. Each backend hands out its own opaque handle per file and writes sequentially
+// from the offset it was opened at.
+typedef struct {
+    const char *name;
+    bool (*init)(void);
+    void (*exit)(void);
+    void *(*open)(const char *path, bool existing, uint64_t offset); // existing: keep contents instead of truncating
+    bool (*write)(void *handle, const void *data, size_t len);
+    bool (*set_size)(void *handle, uint64_t size); // Must leave the write position unchanged
+    bool (*flush)(void *handle);
+    bool (*close)(void *handle);
+} FileSinkBackend;
+
+// Built-in backends
+extern const FileSinkBackend filesink_stdio_backend;    // Unbuffered stdio, always available
+extern const FileSinkBackend filesink_fsdirect_backend; // FSFILE calls on the SD archive, 3DS only
+
+// A file open for writing
+typedef struct FileSink FileSink;
+
+// Shut down every backend that was initialized
+void filesink_exit(void);
+
+// Replace the active backend. Returns false if it fails to initialize. Files already open keep their backend.
+bool filesink_set_backend(const FileSinkBackend *backend);
+
+// Select a built-in backend by name. Returns false if the name is unknown or unavailable in this build.
+bool filesink_select(const char *name);
+
+// Get the active backend
+const FileSinkBackend *filesink_get_backend(void);
+
+// Size of the write-combining buffer for files opened from now on, 0 to write straight through.
+// Clamped to FILESINK_MAX_BUFFER and rounded down to FILESINK_ALIGN.
+void filesink_set_buffer_size(size_t bytes);
+
+size_t filesink_get_buffer_size(void);
+
+// Open path for writing at offset, truncating it unless existing is set. Returns NULL (and logs) on failure.
+FileSink *filesink_open(const char *path, bool existing, uint64_t offset);
+
+// Write len bytes at the current position
+bool filesink_write(FileSink *sink, const void *data, size_t len);
+
+// Grow or shrink the file without moving the write position
+bool filesink_set_size(FileSink *sink, uint64_t size);
+
+// Push buffered data to the card. Everything written before a successful flush survives a crash.
+bool filesink_flush(FileSink *sink);
+
+// Flush, close and free the sink. Returns false if any buffered data failed to reach the card.
+bool filesink_close(FileSink *sink);
+
+// Write a test file of size bytes in chunk-sized pieces into dir with every available backend and buffer size,
+// log each one's throughput and select the fastest. Returns false if none of them could write.
+bool filesink_benchmark(const char *dir, uint32_t size, size_t chunk);
+
+#endif // FILESINK_H
@@ -0,0 +1,104 @@
+/*
+ * File sink backend - Direct FSFILE calls on the SD card archive (3DS only)
+ *
+ * Skips newlib and the sdmc devoptab, which split every write through a
+ * small bounce buffer, so a combined write reaches the FS service as one
+ * request at an explicit offset.
+ */
+
+#ifdef __3DS__
+
+#include "filesink.h"
+#include "log.h"
+#include <stdlib.h>
+#include <string.h>
+#include <3ds.h>
+
+#define FSDIRECT_PATH_LEN 512 // UTF-16 units
+
+typedef struct {
+    Handle file;
+    u64 offset;
+} FsDirectFile;
+
+static FS_Archive sdmcArchive;
+static bool archiveOpen = false;
+
+static bool fsdirect_init(void) {
+    if (archiveOpen) return true;
+    Result ret = FSUSER_OpenArchive(&sdmcArchive, ARCHIVE_SDMC, fsMakePath(PATH_EMPTY, ""));
+    if (R_FAILED(ret)) {
+        log_error("FSUSER_OpenArchive failed: %08lX", ret);
+        return false;
+    }
+    archiveOpen = true;
+    return true;
+}
+
+static void fsdirect_exit(void) {
+    if (archiveOpen) FSUSER_CloseArchive(sdmcArchive);
+    archiveOpen = false;
+}
+
+static void *fsdirect_open(const char *path, bool existing, uint64_t offset) {
+    // Paths are written as "sdmc:/..."; the archive is rooted at the card
+    if (strncmp(path, "sdmc:", 5) == 0) path += 5;
+    uint16_t utf16[FSDIRECT_PATH_LEN];
+    ssize_t units = utf8_to_utf16(utf16, (const uint8_t *)path, FSDIRECT_PATH_LEN - 1);
+    if (units < 0 || units >= FSDIRECT_PATH_LEN - 1) return NULL;
+    utf16[units] = 0;
+
+    FsDirectFile *f = calloc(1, sizeof(FsDirectFile));
+    if (!f) return NULL;
+    u32 flags = FS_OPEN_WRITE | (existing ? 0 : FS_OPEN_CREATE);
+    Result ret = FSUSER_OpenFile(&f->file, sdmcArchive, fsMakePath(PATH_UTF16, utf16), flags, 0);
+    if (R_FAILED(ret)) {
+        free(f);
+        return NULL;
+    }
+    if (!existing && R_FAILED(FSFILE_SetSize(f->file, 0))) {
+        FSFILE_Close(f->file);
+        free(f);
+        return NULL;
+    }
+    f->offset = offset;
+    return f;
+}
+
+static bool fsdirect_write(void *handle, const void *data, size_t len) {
+    FsDirectFile *f = handle;
+    u32 written = 0;
+    Result ret = FSFILE_Write(f->file, &written, f->offset, data, len, 0);
+    f->offset += written;
+    return R_SUCCEEDED(ret) && written == len;
+}
+
+static bool fsdirect_set_size(void *handle, uint64_t size) {
+    FsDirectFile *f = handle;
+    return R_SUCCEEDED(FSFILE_SetSize(f->file, size));
+}
+
+static bool fsdirect_flush(void *handle) {
+    FsDirectFile *f = handle;
+    return R_SUCCEEDED(FSFILE_Flush(f->file));
+}
+
+static bool fsdirect_close(void *handle) {
+    FsDirectFile *f = handle;
+    bool ok = R_SUCCEEDED(FSFILE_Close(f->file));
+    free(f);
+    return ok;
+}
+
+const FileSinkBackend filesink_fsdirect_backend = {
+    .name = "fsdirect",
+    .init = fsdirect_init,
+    .exit = fsdirect_exit,
+    .open = fsdirect_open,
+    .write = fsdirect_write,
+    .set_size = fsdirect_set_size,
+    .flush = fsdirect_flush,
+    .close = fsdirect_close,
+};
+
+#endif // __3DS__
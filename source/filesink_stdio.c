@@ -0,0 +1,55 @@
+/*
+ * File sink backend - Unbuffered stdio
+ *
+ * Works wherever there is a C library, so it is the default. Buffering is
+ * left to the sink's own write-combining layer: a second buffer inside stdio
+ * would only copy every chunk once more.
+ */
+
+#include "filesink.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+static void *stdio_open(const char *path, bool existing, uint64_t offset) {
+    FILE *file = fopen(path, existing ? "r+b" : "wb");
+    if (!file) return NULL;
+    setvbuf(file, NULL, _IONBF, 0);
+    if (offset > 0 && fseeko(file, (off_t)offset, SEEK_SET) != 0) {
+        fclose(file);
+        return NULL;
+    }
+    return file;
+}
+
+static bool stdio_write(void *handle, const void *data, size_t len) {
+    return fwrite(data, 1, len, handle) == len;
+}
+
+static bool stdio_set_size(void *handle, uint64_t size) {
+    int fd = fileno(handle);
+#ifdef __3DS__
+    // sdmc maps this to FSFILE_SetSize, which allocates the whole cluster chain at once
+    return ftruncate(fd, (off_t)size) == 0;
+#else
+    return posix_fallocate(fd, 0, (off_t)size) == 0 || ftruncate(fd, (off_t)size) == 0;
+#endif
+}
+
+static bool stdio_flush(void *handle) {
+    return fflush(handle) == 0;
+}
+
+static bool stdio_close(void *handle) {
+    return fclose(handle) == 0;
+}
+
+const FileSinkBackend filesink_stdio_backend = {
+    .name = "stdio",
+    .open = stdio_open,
+    .write = stdio_write,
+    .set_size = stdio_set_size,
+    .flush = stdio_flush,
+    .close = stdio_close,
+};
@@ -0,0 +1,95 @@
+/*
+ * JSON fields module - Declarative JSON key to struct member mapping
+ */
+
+#include "jsonfields.h"
+#include "log.h"
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+
+#define MAX_SEED_ATTEMPTS 4096
+
+// FNV-1a, seeded so a collision-free seed can be searched for
+static uint32_t hash_key(const char *key, uint32_t seed) {
+    uint32_t h = 2166136261u ^ seed;
+    for (const unsigned char *p = (const unsigned char *)key; *p; p++) {
+        h ^= *p;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+// Search for a seed that puts every key of the table in its own slot
+static void build_table(JsonFieldTable *table) {
+    table->built = true;
+    if (table->count >= JSONFIELDS_SLOTS) {
+        log_error("JSON field table too large (%d fields)", table->count);
+        return;
+    }
+
+    for (uint32_t seed = 0; seed < MAX_SEED_ATTEMPTS; seed++) {
+        memset(table->slots, 0, sizeof(table->slots));
+        bool collision = false;
+        for (int i = 0; i < table->count && !collision; i++) {
+            uint32_t slot = hash_key(table->fields[i].key, seed) % JSONFIELDS_SLOTS;
+            if (table->slots[slot]) collision = true;
+            table->slots[slot] = (uint8_t)(i + 1);
+        }
+        if (!collision) {
+            table->seed = seed;
+            return;
+        }
+    }
+
+    log_error("No perfect hash found for JSON field table");
+    memset(table->slots, 0, sizeof(table->slots));
+}
+
+const JsonField *jsonfields_lookup(JsonFieldTable *table, const char *key) {
+    if (!table->built) build_table(table);
+    if (!key) return NULL;
+
+    uint8_t index = table->slots[hash_key(key, table->seed) % JSONFIELDS_SLOTS];
+    if (index == 0) return NULL;
+    const JsonField *field = &table->fields[index - 1];
+    return strcmp(field->key, key) == 0 ? field : NULL;
+}
+
+void jsonfields_store_number(const JsonField *field, void *out, double value) {
+    if (field->type == JSON_FIELD_U64) {
+        *(uint64_t *)((char *)out + field->offset) = value > 0 ? (uint64_t)value : 0;
+        return;
+    }
+    if (field->type != JSON_FIELD_INT) return;
+    int *dst = (int *)((char *)out + field->offset);
+    if (value >= INT_MAX) {
+        *dst = INT_MAX;
+    } else if (value <= INT_MIN) {
+        *dst = INT_MIN;
+    } else {
+        *dst = (int)value;
+    }
+}
+
+void jsonfields_store_string(const JsonField *field, void *out, const char *value) {
+    if (field->type != JSON_FIELD_STRING || !value || !value[0]) return;
+    char *dst = (char *)out + field->offset;
+    if ((field->flags & JSON_FIELD_IF_EMPTY) && dst[0] != '\0') return;
+    snprintf(dst, field->size, "%s", value);
+}
+
+void jsonfields_decode(JsonFieldTable *table, const cJSON *object, void *out) {
+    if (!cJSON_IsObject(object)) return;
+
+    const cJSON *member;
+    cJSON_ArrayForEach(member, object) {
+        const JsonField *field = jsonfields_lookup(table, member->string);
+        if (!field) continue;
+        if (cJSON_IsNumber(member)) {
+            jsonfields_store_number(field, out, member->valuedouble);
+        } else if (cJSON_IsString(member)) {
+            jsonfields_store_string(field, out, member->valuestring);
+        }
+    }
+}
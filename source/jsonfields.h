@@ -0,0 +1,58 @@
+/*
+ * JSON fields module - Declarative JSON key to struct member mapping
+ *
+ * A table lists the keys a struct cares about with their member offsets and
+ * types. Decoding makes one pass over an object's members and dispatches each
+ * key through a perfect hash built for the table on first use, instead of
+ * scanning the object once per wanted field.
+ */
+
+#ifndef JSONFIELDS_H
+#define JSONFIELDS_H
+
+#include "cJSON/cJSON.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define JSONFIELDS_SLOTS 64 // Hash slots per table; tables may hold fewer fields than this
+
+typedef enum { JSON_FIELD_INT, JSON_FIELD_U64, JSON_FIELD_STRING } JsonFieldType; // U64: byte counts past 2 GB
+
+// Field flags
+#define JSON_FIELD_IF_EMPTY 0x1 // Only store if the member is still empty (fallback for another key)
+
+typedef struct {
+    const char *key;
+    JsonFieldType type;
+    size_t offset;
+    size_t size;
+    unsigned int flags;
+} JsonField;
+
+typedef struct {
+    const JsonField *fields;
+    int count;
+    uint32_t seed;
+    uint8_t slots[JSONFIELDS_SLOTS]; // Field index + 1, 0 = empty
+    bool built;
+} JsonFieldTable;
+
+// Describe a struct member: JSON_FIELD(Rom, "fs_name", fsName, JSON_FIELD_STRING, 0)
+#define JSON_FIELD(type, key, member, kind, flags)                                                                     \
+    {key, kind, offsetof(type, member), sizeof(((type *)0)->member), flags}
+
+// Static initializer for a table over a JsonField array
+#define JSON_FIELD_TABLE(array) {array, (int)(sizeof(array) / sizeof((array)[0])), 0, {0}, false}
+
+// Find the field for a key, or NULL if the table doesn't want it
+const JsonField *jsonfields_lookup(JsonFieldTable *table, const char *key);
+
+// Store a number or string into out according to field
+void jsonfields_store_number(const JsonField *field, void *out, double value);
+void jsonfields_store_string(const JsonField *field, void *out, const char *value);
+
+// Fill out from every wanted member of a cJSON object in a single pass
+void jsonfields_decode(JsonFieldTable *table, const cJSON *object, void *out);
+
+#endif // JSONFIELDS_H
@@ -0,0 +1,284 @@
+/*
+ * JSON stream module - Incremental (SAX-style) JSON tokenizer
+ */
+
+#include "jsonstream.h"
+#include <string.h>
+
+typedef enum { LEX_VALUE, LEX_STRING, LEX_ESCAPE, LEX_UNICODE, LEX_NUMBER, LEX_LITERAL } LexState;
+
+void jsonstream_init(JsonStream *js, JsonEventCb callback, void *ctx) {
+    memset(js, 0, sizeof(JsonStream));
+    js->callback = callback;
+    js->ctx = ctx;
+    js->lexState = LEX_VALUE;
+}
+
+static bool emit(JsonStream *js, JsonEvent event, const char *text, size_t len) {
+    if (!js->callback(js->ctx, event, text, len, js->depth)) {
+        js->failed = true;
+        return false;
+    }
+    return true;
+}
+
+static void token_reset(JsonStream *js) {
+    js->tokenLen = 0;
+    js->truncated = false;
+}
+
+// Append bytes to the current token. Once the buffer fills, the rest of the token is
+// dropped, cutting on a UTF-8 sequence boundary.
+static void token_append(JsonStream *js, const char *bytes, size_t len) {
+    if (js->truncated) return;
+    size_t space = sizeof(js->token) - 1 - js->tokenLen;
+    if (len > space) {
+        len = space;
+        while (len > 0 && ((unsigned char)bytes[len] & 0xC0) == 0x80) len--;
+        js->truncated = true;
+    }
+    memcpy(js->token + js->tokenLen, bytes, len);
+    js->tokenLen += len;
+}
+
+static void token_append_utf8(JsonStream *js, unsigned int cp) {
+    char out[4];
+    size_t len;
+    if (cp < 0x80) {
+        out[0] = (char)cp;
+        len = 1;
+    } else if (cp < 0x800) {
+        out[0] = (char)(0xC0 | (cp >> 6));
+        out[1] = (char)(0x80 | (cp & 0x3F));
+        len = 2;
+    } else if (cp < 0x10000) {
+        out[0] = (char)(0xE0 | (cp >> 12));
+        out[1] = (char)(0x80 | ((cp >> 6) & 0x3F));
+        out[2] = (char)(0x80 | (cp & 0x3F));
+        len = 3;
+    } else {
+        out[0] = (char)(0xF0 | (cp >> 18));
+        out[1] = (char)(0x80 | ((cp >> 12) & 0x3F));
+        out[2] = (char)(0x80 | ((cp >> 6) & 0x3F));
+        out[3] = (char)(0x80 | (cp & 0x3F));
+        len = 4;
+    }
+    token_append(js, out, len);
+}
+
+// A scalar value finished; at depth 0 that completes the document
+static void value_done(JsonStream *js) {
+    if (js->depth == 0) js->sawRoot = true;
+}
+
+static bool finish_token(JsonStream *js, JsonEvent event) {
+    js->token[js->tokenLen] = '\0';
+    bool ok = emit(js, event, js->token, js->tokenLen);
+    token_reset(js);
+    if (event != JSON_EVENT_KEY) value_done(js);
+    return ok;
+}
+
+static bool open_container(JsonStream *js, char type) {
+    if (js->depth >= JSONSTREAM_MAX_DEPTH) return false;
+    if (!emit(js, type == '{' ? JSON_EVENT_OBJECT_START : JSON_EVENT_ARRAY_START, NULL, 0)) return false;
+    js->stack[js->depth++] = type;
+    js->expectKey = (type == '{');
+    return true;
+}
+
+static bool close_container(JsonStream *js, char type) {
+    if (js->depth == 0 || js->stack[js->depth - 1] != type) return false;
+    js->depth--;
+    js->expectKey = false;
+    if (!emit(js, type == '{' ? JSON_EVENT_OBJECT_END : JSON_EVENT_ARRAY_END, NULL, 0)) return false;
+    value_done(js);
+    return true;
+}
+
+// Handle one character while between tokens
+static bool lex_value(JsonStream *js, char c) {
+    switch (c) {
+    case ' ':
+    case '\t':
+    case '\r':
+    case '\n':
+    case ':':
+        return true;
+    case ',':
+        js->expectKey = js->depth > 0 && js->stack[js->depth - 1] == '{';
+        return true;
+    case '{':
+    case '[':
+        return open_container(js, c);
+    case '}':
+        return close_container(js, '{');
+    case ']':
+        return close_container(js, '[');
+    case '"':
+        js->lexState = LEX_STRING;
+        token_reset(js);
+        return true;
+    case 't':
+        js->literal = "true";
+        break;
+    case 'f':
+        js->literal = "false";
+        break;
+    case 'n':
+        js->literal = "null";
+        break;
+    default:
+        if (c == '-' || (c >= '0' && c <= '9')) {
+            js->lexState = LEX_NUMBER;
+            token_reset(js);
+            token_append(js, &c, 1);
+            return true;
+        }
+        return false;
+    }
+    js->lexState = LEX_LITERAL;
+    js->literalPos = 1;
+    return true;
+}
+
+static bool lex_literal(JsonStream *js, char c) {
+    if (c != js->literal[js->literalPos]) return false;
+    js->literalPos++;
+    if (js->literal[js->literalPos] != '\0') return true;
+
+    js->lexState = LEX_VALUE;
+    JsonEvent event = JSON_EVENT_NULL;
+    if (js->literal[0] == 't') event = JSON_EVENT_TRUE;
+    if (js->literal[0] == 'f') event = JSON_EVENT_FALSE;
+    if (!emit(js, event, NULL, 0)) return false;
+    value_done(js);
+    return true;
+}
+
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static bool lex_unicode(JsonStream *js, char c) {
+    int v = hex_value(c);
+    if (v < 0) return false;
+    js->unicode = (js->unicode << 4) | (unsigned int)v;
+    if (++js->unicodeDigits < 4) return true;
+
+    js->lexState = LEX_STRING;
+    unsigned int cp = js->unicode;
+    if (cp >= 0xD800 && cp <= 0xDBFF) {
+        js->highSurrogate = cp; // Wait for the low half
+        return true;
+    }
+    if (cp >= 0xDC00 && cp <= 0xDFFF) {
+        if (!js->highSurrogate) return true; // Unpaired low surrogate, drop it
+        cp = 0x10000 + ((js->highSurrogate - 0xD800) << 10) + (cp - 0xDC00);
+    }
+    js->highSurrogate = 0;
+    token_append_utf8(js, cp);
+    return true;
+}
+
+static bool lex_escape(JsonStream *js, char c) {
+    char out;
+    switch (c) {
+    case '"':
+    case '\\':
+    case '/':
+        out = c;
+        break;
+    case 'b':
+        out = '\b';
+        break;
+    case 'f':
+        out = '\f';
+        break;
+    case 'n':
+        out = '\n';
+        break;
+    case 'r':
+        out = '\r';
+        break;
+    case 't':
+        out = '\t';
+        break;
+    case 'u':
+        js->lexState = LEX_UNICODE;
+        js->unicode = 0;
+        js->unicodeDigits = 0;
+        return true;
+    default:
+        return false;
+    }
+    js->lexState = LEX_STRING;
+    token_append(js, &out, 1);
+    return true;
+}
+
+bool jsonstream_feed(JsonStream *js, const char *data, size_t len) {
+    if (js->failed) return false;
+
+    for (size_t i = 0; i < len; i++) {
+        char c = data[i];
+        bool ok = true;
+
+        switch (js->lexState) {
+        case LEX_VALUE:
+            ok = lex_value(js, c);
+            break;
+        case LEX_STRING:
+            if (c == '"') {
+                js->lexState = LEX_VALUE;
+                bool isKey = js->expectKey;
+                js->expectKey = false;
+                ok = finish_token(js, isKey ? JSON_EVENT_KEY : JSON_EVENT_STRING);
+            } else if (c == '\\') {
+                js->lexState = LEX_ESCAPE;
+            } else {
+                // Copy the run of plain characters in one go
+                size_t run = 1;
+                while (i + run < len && data[i + run] != '"' && data[i + run] != '\\') run++;
+                token_append(js, data + i, run);
+                i += run - 1;
+            }
+            break;
+        case LEX_ESCAPE:
+            ok = lex_escape(js, c);
+            break;
+        case LEX_UNICODE:
+            ok = lex_unicode(js, c);
+            break;
+        case LEX_NUMBER:
+            if ((c >= '0' && c <= '9') || c == '.' || c == 'e' || c == 'E' || c == '+' || c == '-') {
+                token_append(js, &c, 1);
+            } else {
+                js->lexState = LEX_VALUE;
+                ok = finish_token(js, JSON_EVENT_NUMBER) && lex_value(js, c);
+            }
+            break;
+        case LEX_LITERAL:
+            ok = lex_literal(js, c);
+            break;
+        }
+
+        if (!ok) {
+            js->failed = true;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool jsonstream_finish(JsonStream *js) {
+    if (js->failed) return false;
+    if (js->lexState == LEX_NUMBER) {
+        js->lexState = LEX_VALUE;
+        if (!finish_token(js, JSON_EVENT_NUMBER)) return false;
+    }
+    return js->lexState == LEX_VALUE && js->depth == 0 && js->sawRoot;
+}
@@ -0,0 +1,67 @@
+/*
+ * JSON stream module - Incremental (SAX-style) JSON tokenizer
+ *
+ * Consumes a document in arbitrary chunks as they arrive from the network and
+ * reports each token through a callback, without building a tree or allocating.
+ */
+
+#ifndef JSONSTREAM_H
+#define JSONSTREAM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#define JSONSTREAM_MAX_DEPTH 32
+#define JSONSTREAM_TOKEN_SIZE 1024 // Longer strings are truncated (still valid UTF-8 up to the cut)
+
+typedef enum {
+    JSON_EVENT_OBJECT_START,
+    JSON_EVENT_OBJECT_END,
+    JSON_EVENT_ARRAY_START,
+    JSON_EVENT_ARRAY_END,
+    JSON_EVENT_KEY,
+    JSON_EVENT_STRING,
+    JSON_EVENT_NUMBER,
+    JSON_EVENT_TRUE,
+    JSON_EVENT_FALSE,
+    JSON_EVENT_NULL
+} JsonEvent;
+
+// Token callback. text is NUL-terminated for KEY, STRING and NUMBER events (NULL otherwise) and
+// only valid during the call. depth is the number of enclosing containers: the root value is at
+// depth 0, keys and values of the root object at depth 1, and so on. Start events report the
+// depth of the container itself. Return false to abort parsing.
+typedef bool (*JsonEventCb)(void *ctx, JsonEvent event, const char *text, size_t len, int depth);
+
+typedef struct {
+    JsonEventCb callback;
+    void *ctx;
+
+    int lexState;
+    int depth;
+    char stack[JSONSTREAM_MAX_DEPTH]; // '{' or '[' for each open container
+    bool expectKey;
+
+    char token[JSONSTREAM_TOKEN_SIZE];
+    size_t tokenLen;
+    bool truncated;
+    unsigned int unicode;
+    int unicodeDigits;
+    unsigned int highSurrogate;
+    const char *literal;
+    int literalPos;
+
+    bool sawRoot;
+    bool failed;
+} JsonStream;
+
+// Prepare a stream for a new document
+void jsonstream_init(JsonStream *js, JsonEventCb callback, void *ctx);
+
+// Feed the next chunk. Returns false on a syntax error or if the callback aborted.
+bool jsonstream_feed(JsonStream *js, const char *data, size_t len);
+
+// Signal end of input. Returns true if a complete document was parsed.
+bool jsonstream_finish(JsonStream *js);
+
+#endif // JSONSTREAM_H
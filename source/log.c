@@ -3,6 +3,7 @@
  */
 
 #include "log.h"
+#include "thread.h"
 #include <stdio.h>
 #include <stdarg.h>
 #include <string.h>
@@ -13,9 +14,17 @@ static LogLevel currentLevel = LOG_INFO;
 static LogSubscriber subscribers[LOG_MAX_SUBSCRIBERS] = {NULL};
 static int subscriberCount = 0;
 
+// Download workers log from their own threads; subscribers see one message at a time
+static ThreadMutex logLock;
+static bool logLockReady = false;
+
 static const char *levelNames[] = {"TRACE", "DEBUG", "INFO", "WARN", "ERROR", "FATAL"};
 
 void log_init(void) {
+    if (!logLockReady) {
+        thread_mutex_init(&logLock);
+        logLockReady = true;
+    }
     currentLevel = LOG_INFO;
     subscriberCount = 0;
     for (int i = 0; i < LOG_MAX_SUBSCRIBERS; i++) {
@@ -87,11 +96,13 @@ static void log_message(LogLevel level, const char *fmt, va_list args) {
     vsnprintf(buffer, sizeof(buffer), fmt, args);
 
     // Notify all subscribers
+    if (logLockReady) thread_mutex_lock(&logLock);
     for (int i = 0; i < subscriberCount; i++) {
         if (subscribers[i]) {
             subscribers[i](level, buffer);
         }
     }
+    if (logLockReady) thread_mutex_unlock(&logLock);
 }
 
 void log_trace(const char *fmt, ...) {
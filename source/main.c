@@ -24,11 +24,15 @@
 #include "screens/romdetail.h"
 #include "screens/bottom.h"
 #include "queue.h"
+#include "queuesizes.h"
 #include "screens/queuescreen.h"
 #include "screens/search.h"
 #include "screens/about.h"
 #include "debuglog.h"
 #include "zip.h"
+#include "downloader.h"
+#include "storage.h"
+#include "filesink.h"
 
 // App states
 typedef enum {
@@ -48,6 +52,8 @@ static AppState currentState = STATE_LOADING;
 static bool needsConfigSetup = false;
 static bool queueAddPending = false;   // Track if folder selection is for queue add
 static bool queueConfirmShown = false; // Track if clear-queue confirmation is showing
+static bool queueSizesFetched = false; // Sizes of entries queued without one are looked up once per run
+static bool queueSizesDirty = false;   // Sizes found but not yet saved
 
 // Navigation stack — push current state before entering a new screen, pop on back
 #define NAV_STACK_MAX 8
@@ -95,41 +101,6 @@ static void show_loading(const char *message) {
     C3D_FrameEnd(0);
 }
 
-// Progress state for download/extraction callbacks.
-// Set progressLabel before calling api_download_rom() or zip_extract().
-static char downloadNameBuf[384];
-static const char *downloadName = NULL;
-static const char *downloadQueueText = NULL;
-static const char *progressLabel = "Downloading...";
-
-static void set_download_name(const char *slug, const char *name) {
-    snprintf(downloadNameBuf, sizeof(downloadNameBuf), "[%s] %s", slug, name);
-    downloadName = downloadNameBuf;
-}
-
-// Progress callback shared by download and extraction
-// Returns true to continue, false to cancel
-static bool progress_callback(uint32_t current, uint32_t total) {
-    float progress = total > 0 ? (float)current / total : -1.0f;
-
-    char sizeText[64];
-    if (total > 0) {
-        snprintf(sizeText, sizeof(sizeText), "%.1f / %.1f MB", current / (1024.0f * 1024.0f),
-                 total / (1024.0f * 1024.0f));
-    } else {
-        snprintf(sizeText, sizeof(sizeText), "%.1f MB", current / (1024.0f * 1024.0f));
-    }
-
-    C3D_FrameBegin(C3D_FRAME_SYNCDRAW);
-    C2D_TargetClear(topScreen, UI_COLOR_BG);
-    C2D_SceneBegin(topScreen);
-    ui_draw_progress(progress, progressLabel, sizeText, downloadName, downloadQueueText);
-    bottom_draw();
-    C3D_FrameEnd(0);
-
-    return !bottom_check_cancel();
-}
-
 // Helper to fetch platforms from API
 static void fetch_platforms(void) {
     show_loading("Fetching platforms...");
@@ -232,6 +203,8 @@ static bool get_focused_rom(Rom *out, const char **slug) {
         out->platformId = romDetail->platformId;
         snprintf(out->name, sizeof(out->name), "%s", romDetail->name);
         snprintf(out->fsName, sizeof(out->fsName), "%s", romDetail->fsName);
+        snprintf(out->md5Hash, sizeof(out->md5Hash), "%s", romDetail->md5Hash);
+        out->sizeBytes = romDetail->sizeBytes;
         *slug = currentPlatformSlug;
         return true;
     } else if (currentState == STATE_ROMS) {
@@ -253,11 +226,8 @@ static bool get_focused_rom(Rom *out, const char **slug) {
     return false;
 }
 
-// Transition to targetState and sync the bottom screen for ROM actions
-static void sync_bottom_after_action(AppState targetState) {
-    currentState = targetState;
-    bottom_set_mode(BOTTOM_MODE_ROM_ACTIONS);
-    bottom_set_queue_count(queue_count());
+// Refresh the exists/queued flags for the ROM focused in a rom-list state
+static void sync_focused_rom_flags(AppState targetState) {
     if (targetState == STATE_ROMS) {
         const Rom *rom = roms_get_at(roms_get_selected_index());
         if (rom) {
@@ -278,6 +248,14 @@ static void sync_bottom_after_action(AppState targetState) {
     }
 }
 
+// Transition to targetState and sync the bottom screen for ROM actions
+static void sync_bottom_after_action(AppState targetState) {
+    currentState = targetState;
+    bottom_set_mode(BOTTOM_MODE_ROM_ACTIONS);
+    bottom_set_queue_count(queue_count());
+    sync_focused_rom_flags(targetState);
+}
+
 // Update bottom screen state for the selected ROM in the list
 static void sync_roms_bottom(int index) {
     const Rom *rom = roms_get_at(index);
@@ -288,63 +266,198 @@ static void sync_roms_bottom(int index) {
     lastRomListIndex = index;
 }
 
-// Extract a zip file after download, showing progress. Returns true on success.
-static bool extract_if_zip(const char *destPath) {
-    if (!zip_is_zip_file(destPath)) return true;
-
-    // Derive directory from the full path
-    char destDir[CONFIG_MAX_PATH_LEN + CONFIG_MAX_SLUG_LEN + 2];
-    snprintf(destDir, sizeof(destDir), "%s", destPath);
-    char *lastSlash = strrchr(destDir, '/');
-    if (lastSlash) *lastSlash = '\0';
-
-    log_info("Extracting zip: %s", destPath);
-    progressLabel = "Extracting...";
-    if (zip_extract(destPath, destDir, progress_callback)) {
-        log_info("Extraction complete!");
-        return true;
-    } else {
-        log_error("Extraction failed!");
+// Hand a ROM to the download worker. Returns false if it could not be queued.
+static bool submit_download(int romId, const char *name, const char *fsName, const char *md5Hash, uint64_t sizeBytes,
+                            const char *slug, const char *folderName) {
+    DownloadJob job;
+    memset(&job, 0, sizeof(job));
+    job.romId = romId;
+    snprintf(job.fsName, sizeof(job.fsName), "%s", fsName);
+    snprintf(job.label, sizeof(job.label), "[%s] %s", slug, name);
+    build_rom_path(job.destPath, sizeof(job.destPath), folderName, fsName);
+    snprintf(job.md5, sizeof(job.md5), "%s", md5Hash);
+    job.sizeBytes = sizeBytes;
+    if (!downloader_submit(&job)) {
+        if (downloader_has_job(romId)) {
+            log_warn("'%s' is already downloading", name);
+        } else {
+            log_error("Too many downloads waiting (%d), '%s' was not started", DOWNLOADER_MAX_JOBS, name);
+        }
         return false;
     }
+    log_info("Queued download: %s", job.label);
+    return true;
 }
 
 // Download the currently focused ROM to the given platform folder
 static void download_focused_rom(const Rom *rom, const char *slug, const char *folderName) {
-    char destPath[CONFIG_MAX_PATH_LEN + CONFIG_MAX_SLUG_LEN + 256 + 3];
-    build_rom_path(destPath, sizeof(destPath), folderName, rom->fsName);
-    bottom_set_mode(BOTTOM_MODE_DOWNLOADING);
-    set_download_name(slug, rom->name);
-    downloadQueueText = NULL;
-    progressLabel = "Downloading...";
-    log_info("Downloading to: %s", destPath);
-    if (api_download_rom(rom->id, rom->fsName, destPath, progress_callback)) {
-        log_info("Download complete!");
-        if (!extract_if_zip(destPath)) {
-            remove(destPath);
+    submit_download(rom->id, rom->name, rom->fsName, rom->md5Hash, rom->sizeBytes, slug, folderName);
+}
+
+// Hand every queue entry to the download worker in the chosen order, marking entries without a folder as failed.
+// Free space is planned across the whole queue: an entry that doesn't fit in what earlier entries leave is
+// deferred rather than started, and smaller ones after it still go ahead.
+static void start_queue_downloads(void) {
+    int order[QUEUE_MAX_ENTRIES];
+    int count = queue_schedule(order);
+    uint64_t space = 0;
+    bool spaceKnown = storage_available(config.romFolder, &space);
+    // Submitted jobs that haven't started (from an earlier Start, or single ROMs) have claimed nothing yet
+    uint64_t waiting = downloader_pending_bytes();
+    space = space > waiting ? space - waiting : 0;
+    for (int n = 0; n < count; n++) {
+        int i = order[n];
+        QueueEntry *entry = queue_get(i);
+        // An entry already submitted is counted in waiting, or by its running job's claim
+        if (!entry || downloader_has_job(entry->romId)) continue;
+
+        const char *folderName = config_get_platform_folder(entry->platformSlug);
+        if (!folderName || !folderName[0]) {
+            log_error("No folder for platform '%s', skipping", entry->platformSlug);
+            queue_set_state(i, QUEUE_ENTRY_FAILED);
+            continue;
         }
-    } else {
-        log_error("Download failed!");
+        if (spaceKnown && entry->sizeBytes > space) {
+            log_warn("Deferring '%s': %.1f MB won't fit in %.1f MB", entry->name, entry->sizeBytes / (1024.0 * 1024.0),
+                     space / (1024.0 * 1024.0));
+            queue_set_state(i, QUEUE_ENTRY_NO_SPACE);
+            continue;
+        }
+        if (!submit_download(entry->romId, entry->name, entry->fsName, entry->md5Hash, entry->sizeBytes,
+                             entry->platformSlug, folderName)) {
+            // Shown as failed so Start can try it again once the job list has room
+            queue_set_state(i, QUEUE_ENTRY_FAILED);
+            continue;
+        }
+        space -= entry->sizeBytes;
+        queue_set_state(i, QUEUE_ENTRY_PENDING);
     }
 }
 
-// Download a single queue entry. Returns true on success.
-static bool download_queue_entry(QueueEntry *entry) {
-    const char *folderName = config_get_platform_folder(entry->platformSlug);
-    if (!folderName || !folderName[0]) {
-        log_error("No folder for platform '%s', skipping", entry->platformSlug);
-        return false;
+static int queue_index_of(int romId) {
+    for (int i = 0; i < queue_count(); i++) {
+        QueueEntry *entry = queue_get(i);
+        if (entry && entry->romId == romId) return i;
     }
-    char destPath[CONFIG_MAX_PATH_LEN + CONFIG_MAX_SLUG_LEN + 256 + 3];
-    build_rom_path(destPath, sizeof(destPath), folderName, entry->fsName);
-    log_info("Downloading '%s' to: %s", entry->name, destPath);
-    progressLabel = "Downloading...";
-    if (!api_download_rom(entry->romId, entry->fsName, destPath, progress_callback)) return false;
-    if (!extract_if_zip(destPath)) {
-        remove(destPath);
-        return false;
+    return -1;
+}
+
+// Look up sizes for entries queued before the server reported them, so the queue can be ordered by size.
+// The requests run in the background; poll_queue_sizes() fills the sizes in as they arrive.
+static void fetch_queue_sizes(void) {
+    if (queueSizesFetched) return;
+    int romIds[QUEUE_MAX_ENTRIES];
+    int count = 0;
+    for (int i = 0; i < queue_count(); i++) {
+        QueueEntry *entry = queue_get(i);
+        if (entry && entry->sizeBytes == 0) romIds[count++] = entry->romId;
     }
-    return true;
+    queueSizesFetched = count == 0 || queuesizes_start(romIds, count);
+}
+
+// Apply sizes found by the background lookup, writing the queue file once they are all in
+static void poll_queue_sizes(void) {
+    int romId;
+    uint64_t sizeBytes;
+    while (queuesizes_poll(&romId, &sizeBytes)) {
+        if (queue_set_size(queue_index_of(romId), sizeBytes)) queueSizesDirty = true;
+    }
+    if (queueSizesDirty && !queuesizes_busy()) {
+        queue_save();
+        queueSizesDirty = false;
+    }
+}
+
+#define SINK_BENCHMARK_SIZE (4 * 1024 * 1024) // Written once per sink and buffer size
+
+// Time each file sink on the card once and keep the fastest in the config, so later starts skip the test
+static void benchmark_file_sink(void) {
+    show_loading("Measuring SD card write speed...");
+    size_t chunk = config.downloadChunkKB > 0 ? config.downloadChunkKB * 1024 : FILESINK_DEFAULT_BUFFER;
+    if (!filesink_benchmark(CONFIG_DIR, SINK_BENCHMARK_SIZE, chunk)) return;
+    snprintf(config.fileSink, CONFIG_MAX_SINK_LEN, "%s", filesink_get_backend()->name);
+    config.writeBufferKB = (int)(filesink_get_buffer_size() / 1024);
+    config_save(&config);
+}
+
+// Apply finished downloads to the queue and the bottom screen. Runs on the main thread each frame,
+// so the worker never touches the queue.
+static void poll_downloads(void) {
+    DownloadResult result;
+    bool changed = false;
+    while (downloader_poll_result(&result)) {
+        int index = queue_index_of(result.romId);
+        if (result.success) {
+            if (index >= 0) queue_remove(result.romId);
+        } else if (!result.cancelled && index >= 0) {
+            QueueEntryState state = QUEUE_ENTRY_FAILED;
+            if (result.corrupt) state = QUEUE_ENTRY_CORRUPT;
+            if (result.noSpace) state = QUEUE_ENTRY_NO_SPACE;
+            queue_set_state(index, state);
+        }
+        changed = true;
+    }
+
+    DownloadStatus status;
+    downloader_get_status(&status);
+    bottom_set_downloads_active(status.active > 0 || status.pending > 0);
+    queue_screen_set_status(&status);
+
+    if (!changed) return;
+    bottom_set_queue_count(queue_count());
+    if (currentState == STATE_ROMS || currentState == STATE_SEARCH_RESULTS || currentState == STATE_ROM_DETAIL) {
+        sync_focused_rom_flags(currentState);
+    }
+}
+
+// Draw the running download as a strip along the bottom of the top screen
+static void draw_download_status(const DownloadStatus *status) {
+    if (status->active == 0) return;
+
+    char text[DOWNLOADER_LABEL_LEN + 128];
+    float progress;
+    if (status->active == 1) {
+        const DownloadJobStatus *job = &status->jobs[0];
+        const char *action = job->state == DOWNLOAD_STATE_EXTRACTING ? "Extracting" : "Downloading";
+        char sizeText[64];
+        int len;
+        if (job->total > 0) {
+            len = snprintf(sizeText, sizeof(sizeText), "%.1f / %.1f MB", job->current / (1024.0f * 1024.0f),
+                           job->total / (1024.0f * 1024.0f));
+        } else {
+            len = snprintf(sizeText, sizeof(sizeText), "%.1f MB", job->current / (1024.0f * 1024.0f));
+        }
+        if (job->bytesPerSecond > 0 && len > 0 && (size_t)len < sizeof(sizeText)) {
+            snprintf(sizeText + len, sizeof(sizeText) - len, " (%.0f KB/s)", job->bytesPerSecond / 1024.0f);
+        }
+
+        if (status->pending > 0) {
+            snprintf(text, sizeof(text), "%s %s \xC2\xB7 %s \xC2\xB7 %d more", action, job->label, sizeText,
+                     status->pending);
+        } else {
+            snprintf(text, sizeof(text), "%s %s \xC2\xB7 %s", action, job->label, sizeText);
+        }
+        progress = job->total > 0 ? (float)job->current / job->total : -1.0f;
+    } else {
+        // Several jobs at once: one line for the whole batch, per stage, e.g.
+        // "3 active · 12/40 done · 4.2 MB/s" or "2 downloading · 1 extracting · 12/40 done · 4.2 MB/s"
+        float finished = (float)status->done;
+        for (int i = 0; i < status->active; i++) {
+            const DownloadJobStatus *job = &status->jobs[i];
+            if (job->total > 0) finished += (float)job->current / job->total;
+        }
+        char stages[64];
+        if (status->extracting > 0) {
+            snprintf(stages, sizeof(stages), "%d downloading \xC2\xB7 %d extracting",
+                     status->active - status->extracting, status->extracting);
+        } else {
+            snprintf(stages, sizeof(stages), "%d active", status->active);
+        }
+        snprintf(text, sizeof(text), "%s \xC2\xB7 %d/%d done \xC2\xB7 %.1f MB/s", stages, status->done,
+                 status->batchSize, status->bytesPerSecond / (1024.0f * 1024.0f));
+        progress = finished / status->batchSize;
+    }
+    ui_draw_status_bar(progress, text);
 }
 
 // Fetch and display ROM detail, updating all navigation state
@@ -412,6 +525,7 @@ static void handle_bottom_action(BottomAction action) {
     if (action == BOTTOM_ACTION_SAVE_SETTINGS && currentState == STATE_SETTINGS) {
         sound_play_click();
         config_save(&config);
+        downloader_cancel_all(); // Jobs belong to the old server
         api_set_auth(config.username, config.password);
         api_set_base_url(config.serverUrl);
         bottom_set_mode(BOTTOM_MODE_DEFAULT);
@@ -449,6 +563,7 @@ static void handle_bottom_action(BottomAction action) {
         sound_play_click();
         nav_push(currentState);
         queue_clear_failed();
+        fetch_queue_sizes();
         queue_screen_init();
         bottom_set_mode(BOTTOM_MODE_QUEUE);
         bottom_set_queue_count(queue_count());
@@ -516,7 +631,7 @@ static void handle_bottom_action(BottomAction action) {
                 bottom_set_queue_count(queue_count());
             } else {
                 if (check_platform_folder_valid(slug)) {
-                    if (queue_add(rom.id, rom.platformId, rom.name, rom.fsName, slug)) {
+                    if (queue_add(rom.id, rom.platformId, rom.name, rom.fsName, slug, rom.md5Hash, rom.sizeBytes)) {
                         log_info("Added '%s' to download queue", rom.name);
                     }
                     bottom_set_rom_queued(queue_contains(rom.id));
@@ -547,45 +662,20 @@ static void handle_bottom_action(BottomAction action) {
     // Queue management actions
     if (action == BOTTOM_ACTION_START_DOWNLOADS && currentState == STATE_QUEUE) {
         sound_play_click();
-        int count = queue_count();
-        if (count > 0) {
-            bottom_set_mode(BOTTOM_MODE_DOWNLOADING);
-            int completed = 0;
-            int i = 0;
-            while (i < queue_count()) {
-                QueueEntry *entry = queue_get(i);
-                if (!entry) {
-                    i++;
-                    continue;
-                }
-
-                char queueText[64];
-                snprintf(queueText, sizeof(queueText), "ROM %d of %d in your queue", completed + 1, count);
-                set_download_name(entry->platformSlug, entry->name);
-                downloadQueueText = queueText;
-
-                if (download_queue_entry(entry)) {
-                    log_info("Queue download complete: %s", entry->name);
-                    queue_remove(entry->romId);
-                    completed++;
-                } else {
-                    log_error("Queue download failed: %s", entry->name);
-                    queue_set_failed(i, true);
-                    i++;
-                }
-            }
-            downloadName = NULL;
-            downloadQueueText = NULL;
-            bottom_set_mode(BOTTOM_MODE_QUEUE);
-            bottom_set_queue_count(queue_count());
-            queue_screen_init();
-        }
+        start_queue_downloads();
+        return;
+    }
+    if (action == BOTTOM_ACTION_CANCEL_DOWNLOADS && currentState == STATE_QUEUE) {
+        sound_play_pop();
+        downloader_cancel_all();
+        log_info("Downloads cancelled");
         return;
     }
     if (action == BOTTOM_ACTION_CLEAR_QUEUE && currentState == STATE_QUEUE) {
         sound_play_click();
         if (queueConfirmShown) {
             queueConfirmShown = false;
+            downloader_cancel_all();
             queue_clear();
             log_info("Download queue cleared");
             bottom_set_mode(BOTTOM_MODE_QUEUE);
@@ -738,7 +828,7 @@ static void handle_state_select_folder(u32 kDown, BottomAction bottomAction) {
                 const char *slug;
                 Rom rom;
                 if (get_focused_rom(&rom, &slug)) {
-                    if (queue_add(rom.id, rom.platformId, rom.name, rom.fsName, slug)) {
+                    if (queue_add(rom.id, rom.platformId, rom.name, rom.fsName, slug, rom.md5Hash, rom.sizeBytes)) {
                         log_info("Added '%s' to download queue", rom.name);
                     }
                 }
@@ -768,6 +858,10 @@ static void handle_state_queue(u32 kDown) {
         sound_play_pop();
         bottom_set_mode(BOTTOM_MODE_DEFAULT);
         currentState = nav_pop();
+    } else if (qResult == QUEUE_REORDERED) {
+        sound_play_click();
+        // Kept in memory; written with the rest of the settings
+        snprintf(config.queueOrder, sizeof(config.queueOrder), "%s", queue_order_key(queue_get_order()));
     } else if (qResult == QUEUE_SELECTED) {
         sound_play_click();
         QueueEntry *entry = queue_get(queue_screen_get_selected_index());
@@ -895,7 +989,6 @@ int main(int argc, char *argv[]) {
     topScreen = C2D_CreateScreenTarget(GFX_TOP, GFX_LEFT);
 
     romfsInit();
-    httpcInit(0);
 
     ui_init();
     sound_init();
@@ -910,6 +1003,24 @@ int main(int argc, char *argv[]) {
         api_set_base_url(config.serverUrl);
         api_set_auth(config.username, config.password);
     }
+    api_set_download_segments(config.downloadSegments);
+    api_set_download_buffers(config.downloadBuffers, config.downloadChunkKB > 0 ? config.downloadChunkKB * 1024 : 0);
+    api_set_max_connections(config.maxConnections);
+    api_set_json_compression(config.compressJson != 0);
+    api_set_token_auth(config.tokenAuth != 0);
+    api_set_download_retries(config.downloadRetries);
+    api_set_stall_timeout(config.stallTimeoutSec > 0 ? (uint32_t)config.stallTimeoutSec * 1000 : 0);
+    api_set_timeouts(config.connectTimeoutSec > 0 ? (uint32_t)config.connectTimeoutSec * 1000 : 0,
+                     config.responseTimeoutSec > 0 ? (uint32_t)config.responseTimeoutSec * 1000 : 0);
+    api_set_download_rate(config.downloadRateKB > 0 ? (uint32_t)config.downloadRateKB * 1024 : 0);
+    api_set_download_backoff(config.downloadBackoffKB > 0 ? (uint32_t)config.downloadBackoffKB * 1024 : 0);
+    downloader_set_slots(config.downloadSlots);
+    filesink_set_buffer_size(config.writeBufferKB > 0 ? (size_t)config.writeBufferKB * 1024 : 0);
+    if (strcmp(config.fileSink, "auto") != 0 && !filesink_select(config.fileSink)) {
+        log_warn("Unknown file sink %s, using %s", config.fileSink, filesink_get_backend()->name);
+    }
+    storage_init();
+    downloader_init();
 
     settings_init(&config);
     platforms_init();
@@ -917,11 +1028,13 @@ int main(int argc, char *argv[]) {
     romdetail_init();
     bottom_init();
     queue_init();
+    queue_set_order(queue_order_from_key(config.queueOrder));
     queue_screen_init();
     debuglog_init();
 
     log_subscribe(debuglog_subscriber);
     log_info("Rommlet - RomM Client");
+    if (!needsConfigSetup && strcmp(config.fileSink, "auto") == 0) benchmark_file_sink();
 
     while (aptMainLoop()) {
         hidScanInput();
@@ -931,6 +1044,8 @@ int main(int argc, char *argv[]) {
         if (kDown & KEY_START) break;
 
         handle_bottom_action(bottomAction);
+        poll_downloads();
+        poll_queue_sizes();
 
         switch (currentState) {
         case STATE_LOADING:
@@ -968,11 +1083,20 @@ int main(int argc, char *argv[]) {
         C3D_FrameBegin(C3D_FRAME_SYNCDRAW);
         C2D_TargetClear(topScreen, UI_COLOR_BG);
         C2D_SceneBegin(topScreen);
+        DownloadStatus downloads;
+        downloader_get_status(&downloads);
+        ui_reserve_status_bar(downloads.active > 0);
         draw_top_screen();
+        draw_download_status(&downloads);
         bottom_draw();
         C3D_FrameEnd(0);
     }
 
+    downloader_exit();
+    queuesizes_exit();
+    poll_queue_sizes();
+    filesink_exit();
+
     if (platforms) api_free_platforms(platforms, platformCount);
     roms_clear();
     if (romDetail) api_free_rom_detail(romDetail);
@@ -982,7 +1106,6 @@ int main(int argc, char *argv[]) {
     ui_exit();
     api_exit();
 
-    httpcExit();
     romfsExit();
     C2D_Fini();
     C3D_Fini();
@@ -0,0 +1,147 @@
+/*
+ * MD5 module - Incremental MD5 (RFC 1321) for download verification
+ */
+
+#include "md5.h"
+#include <stdio.h>
+#include <string.h>
+
+#define ROTL(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+
+static const uint32_t K[64] = {
+    0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+    0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+    0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+    0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+    0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+    0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+    0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+    0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391,
+};
+
+static const uint8_t R[64] = {
+    7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22, 5, 9, 14, 20, 5, 9, 14, 20, 5, 9, 14, 20, 5, 9, 14, 20,
+    4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23, 6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15,
+    21,
+};
+
+static void transform(uint32_t state[4], const uint8_t block[64]) {
+    uint32_t m[16];
+    for (int i = 0; i < 16; i++) {
+        m[i] = (uint32_t)block[i * 4] | ((uint32_t)block[i * 4 + 1] << 8) | ((uint32_t)block[i * 4 + 2] << 16) |
+               ((uint32_t)block[i * 4 + 3] << 24);
+    }
+
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+    for (int i = 0; i < 64; i++) {
+        uint32_t f;
+        int g;
+        if (i < 16) {
+            f = (b & c) | (~b & d);
+            g = i;
+        } else if (i < 32) {
+            f = (d & b) | (~d & c);
+            g = (5 * i + 1) & 15;
+        } else if (i < 48) {
+            f = b ^ c ^ d;
+            g = (3 * i + 5) & 15;
+        } else {
+            f = c ^ (b | ~d);
+            g = (7 * i) & 15;
+        }
+        uint32_t tmp = d;
+        d = c;
+        c = b;
+        b = b + ROTL(a + f + K[i] + m[g], R[i]);
+        a = tmp;
+    }
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+}
+
+void md5_init(Md5Context *ctx) {
+    memset(ctx, 0, sizeof(Md5Context));
+    ctx->state[0] = 0x67452301;
+    ctx->state[1] = 0xefcdab89;
+    ctx->state[2] = 0x98badcfe;
+    ctx->state[3] = 0x10325476;
+}
+
+void md5_update(Md5Context *ctx, const void *data, size_t len) {
+    const uint8_t *p = data;
+    size_t used = ctx->length & 63;
+    ctx->length += len;
+
+    if (used > 0) {
+        size_t take = 64 - used < len ? 64 - used : len;
+        memcpy(ctx->block + used, p, take);
+        p += take;
+        len -= take;
+        if (used + take < 64) return;
+        transform(ctx->state, ctx->block);
+    }
+    // Whole blocks straight from the input
+    for (; len >= 64; p += 64, len -= 64) transform(ctx->state, p);
+    memcpy(ctx->block, p, len);
+}
+
+void md5_final_hex(Md5Context *ctx, char out[MD5_HEX_LEN]) {
+    uint64_t bits = ctx->length * 8;
+    static const uint8_t pad[64] = {0x80};
+    size_t used = ctx->length & 63;
+    md5_update(ctx, pad, used < 56 ? 56 - used : 120 - used);
+
+    uint8_t lengthBytes[8];
+    for (int i = 0; i < 8; i++) lengthBytes[i] = (uint8_t)(bits >> (8 * i));
+    md5_update(ctx, lengthBytes, sizeof(lengthBytes));
+
+    for (int i = 0; i < 16; i++) {
+        snprintf(out + i * 2, 3, "%02x", (unsigned int)((ctx->state[i / 4] >> (8 * (i % 4))) & 0xff));
+    }
+}
+
+void md5_state_to_hex(const Md5Context *ctx, char out[MD5_STATE_HEX_LEN]) {
+    int pos = 0;
+    for (int i = 0; i < 4; i++) {
+        pos += snprintf(out + pos, MD5_STATE_HEX_LEN - pos, "%08lx", (unsigned long)ctx->state[i]);
+    }
+    pos += snprintf(out + pos, MD5_STATE_HEX_LEN - pos, "%016llx", (unsigned long long)ctx->length);
+    for (int i = 0; i < 64; i++) pos += snprintf(out + pos, MD5_STATE_HEX_LEN - pos, "%02x", ctx->block[i]);
+}
+
+static bool parse_hex(const char *hex, int digits, uint64_t *out) {
+    uint64_t value = 0;
+    for (int i = 0; i < digits; i++) {
+        char c = hex[i];
+        int v;
+        if (c >= '0' && c <= '9') {
+            v = c - '0';
+        } else if (c >= 'a' && c <= 'f') {
+            v = c - 'a' + 10;
+        } else {
+            return false;
+        }
+        value = (value << 4) | (uint64_t)v;
+    }
+    *out = value;
+    return true;
+}
+
+bool md5_state_from_hex(Md5Context *ctx, const char *hex) {
+    if (strlen(hex) != MD5_STATE_HEX_LEN - 1) return false;
+    uint64_t v;
+    for (int i = 0; i < 4; i++, hex += 8) {
+        if (!parse_hex(hex, 8, &v)) return false;
+        ctx->state[i] = (uint32_t)v;
+    }
+    if (!parse_hex(hex, 16, &v)) return false;
+    ctx->length = v;
+    hex += 16;
+    for (int i = 0; i < 64; i++, hex += 2) {
+        if (!parse_hex(hex, 2, &v)) return false;
+        ctx->block[i] = (uint8_t)v;
+    }
+    return true;
+}
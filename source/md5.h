@@ -0,0 +1,34 @@
+/*
+ * MD5 module - Incremental MD5 (RFC 1321) for download verification
+ *
+ * The context is plain data so it can be saved with a part file and a
+ * resumed download can keep hashing where it stopped.
+ */
+
+#ifndef MD5_H
+#define MD5_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define MD5_HEX_LEN 33 // 32 hex digits + NUL
+#define MD5_STATE_HEX_LEN (2 * (16 + 8 + 64) + 1)
+
+typedef struct {
+    uint32_t state[4];
+    uint64_t length; // Bytes hashed so far
+    uint8_t block[64];
+} Md5Context;
+
+void md5_init(Md5Context *ctx);
+void md5_update(Md5Context *ctx, const void *data, size_t len);
+
+// Finish the digest as 32 lowercase hex digits. The context is left unusable.
+void md5_final_hex(Md5Context *ctx, char out[MD5_HEX_LEN]);
+
+// Save and restore a running context as hex (for part file sidecars)
+void md5_state_to_hex(const Md5Context *ctx, char out[MD5_STATE_HEX_LEN]);
+bool md5_state_from_hex(Md5Context *ctx, const char *hex);
+
+#endif // MD5_H
@@ -0,0 +1,125 @@
+/*
+ * Part file module - Resume state for interrupted downloads
+ */
+
+#include "partfile.h"
+#include "log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/stat.h>
+
+#define PARTFILE_PATH_LEN 1024
+
+void partfile_path(const char *destPath, char *out, size_t outSize) {
+    snprintf(out, outSize, "%s.part", destPath);
+}
+
+static void meta_path(const char *destPath, char *out, size_t outSize) {
+    snprintf(out, outSize, "%s.part.meta", destPath);
+}
+
+bool partfile_load(const char *destPath, PartInfo *info) {
+    memset(info, 0, sizeof(PartInfo));
+
+    char path[PARTFILE_PATH_LEN];
+    meta_path(destPath, path, sizeof(path));
+    FILE *f = fopen(path, "r");
+    if (!f) return false;
+
+    char line[PARTFILE_MAX_URL_LEN + 32];
+    while (fgets(line, sizeof(line), f)) {
+        char *newline = strchr(line, '\n');
+        if (newline) *newline = '\0';
+        newline = strchr(line, '\r');
+        if (newline) *newline = '\0';
+
+        char *eq = strchr(line, '=');
+        if (!eq) continue;
+        *eq = '\0';
+        const char *key = line;
+        const char *value = eq + 1;
+
+        if (strcmp(key, "bytes") == 0) {
+            info->bytesWritten = (uint32_t)strtoul(value, NULL, 10);
+        } else if (strcmp(key, "total") == 0) {
+            info->totalSize = (uint32_t)strtoul(value, NULL, 10);
+        } else if (strcmp(key, "validator") == 0) {
+            snprintf(info->validator, sizeof(info->validator), "%s", value);
+        } else if (strcmp(key, "url") == 0) {
+            snprintf(info->url, sizeof(info->url), "%s", value);
+        } else if (strcmp(key, "md5") == 0) {
+            info->hasMd5 = md5_state_from_hex(&info->md5, value);
+        }
+    }
+    fclose(f);
+
+    // The data file must hold at least as much as the sidecar claims
+    char part[PARTFILE_PATH_LEN];
+    partfile_path(destPath, part, sizeof(part));
+    struct stat st;
+    if (stat(part, &st) != 0 || (uint64_t)st.st_size < info->bytesWritten) {
+        log_debug("Part file missing or short, not resuming: %s", part);
+        return false;
+    }
+    if (info->hasMd5 && info->md5.length != info->bytesWritten) info->hasMd5 = false;
+    return info->bytesWritten > 0;
+}
+
+uint64_t partfile_allocated(const char *destPath) {
+    char part[PARTFILE_PATH_LEN];
+    partfile_path(destPath, part, sizeof(part));
+    struct stat st;
+    return stat(part, &st) == 0 ? (uint64_t)st.st_size : 0;
+}
+
+bool partfile_save(const char *destPath, const PartInfo *info) {
+    char path[PARTFILE_PATH_LEN];
+    meta_path(destPath, path, sizeof(path));
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        log_error("Failed to open part metadata: %s (errno: %d)", path, errno);
+        return false;
+    }
+
+    fprintf(f, "bytes=%lu\n", (unsigned long)info->bytesWritten);
+    fprintf(f, "total=%lu\n", (unsigned long)info->totalSize);
+    fprintf(f, "validator=%s\n", info->validator);
+    fprintf(f, "url=%s\n", info->url);
+    if (info->hasMd5) {
+        char state[MD5_STATE_HEX_LEN];
+        md5_state_to_hex(&info->md5, state);
+        fprintf(f, "md5=%s\n", state);
+    }
+
+    bool ok = !ferror(f);
+    if (fclose(f) != 0) ok = false;
+    if (!ok) log_error("Failed to write part metadata: %s", path);
+    return ok;
+}
+
+void partfile_discard(const char *destPath) {
+    char path[PARTFILE_PATH_LEN];
+    partfile_path(destPath, path, sizeof(path));
+    remove(path);
+    meta_path(destPath, path, sizeof(path));
+    remove(path);
+}
+
+bool partfile_commit(const char *destPath) {
+    char part[PARTFILE_PATH_LEN];
+    partfile_path(destPath, part, sizeof(part));
+
+    // FAT won't rename over an existing file
+    remove(destPath);
+    if (rename(part, destPath) != 0) {
+        log_error("Failed to rename %s (errno: %d)", part, errno);
+        return false;
+    }
+
+    char path[PARTFILE_PATH_LEN];
+    meta_path(destPath, path, sizeof(path));
+    remove(path);
+    return true;
+}
@@ -0,0 +1,49 @@
+/*
+ * Part file module - Resume state for interrupted downloads
+ *
+ * A download in progress is written to "<dest>.part". A small sidecar,
+ * "<dest>.part.meta", records how many bytes of it are known good, the total
+ * size, the server's validator, the URL the download resolved to and the
+ * running MD5 of the known-good bytes, so a later attempt can continue with a
+ * Range request without re-reading what is already on the card.
+ */
+
+#ifndef PARTFILE_H
+#define PARTFILE_H
+
+#include "md5.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define PARTFILE_MAX_URL_LEN 1024
+
+typedef struct {
+    uint32_t bytesWritten;          // Bytes of the .part file that are flushed and valid
+    uint32_t totalSize;             // Full file size, 0 if unknown
+    char validator[128];            // Strong ETag, or Last-Modified, for If-Range (may be empty)
+    char url[PARTFILE_MAX_URL_LEN]; // Final URL after redirects
+    bool hasMd5;                    // md5 covers exactly bytesWritten bytes
+    Md5Context md5;
+} PartInfo;
+
+// Build the .part path for a destination
+void partfile_path(const char *destPath, char *out, size_t outSize);
+
+// Load the sidecar for destPath. Returns false if there is nothing usable to resume.
+bool partfile_load(const char *destPath, PartInfo *info);
+
+// Bytes the .part file for destPath takes on the card: its length, which is the whole file once it has been
+// preallocated. 0 if there is none.
+uint64_t partfile_allocated(const char *destPath);
+
+// Write the sidecar for destPath. Call only after the .part data it describes is flushed.
+bool partfile_save(const char *destPath, const PartInfo *info);
+
+// Delete the .part file and its sidecar
+void partfile_discard(const char *destPath);
+
+// Move a finished .part file to destPath and delete the sidecar
+bool partfile_commit(const char *destPath);
+
+#endif // PARTFILE_H
@@ -14,9 +14,19 @@
 
 static QueueEntry entries[QUEUE_MAX_ENTRIES];
 static int entryCount = 0;
+static QueueOrder order = QUEUE_ORDER_FIFO;
+
+static const struct {
+    const char *key;
+    const char *label;
+} orderNames[QUEUE_ORDER_COUNT] = {
+    [QUEUE_ORDER_FIFO] = {"fifo", "Oldest first"},
+    [QUEUE_ORDER_SHORTEST_FIRST] = {"shortest", "Smallest first"},
+    [QUEUE_ORDER_LARGEST_FIRST] = {"largest", "Largest first"},
+};
 
 // Persist queue to SD card (tab-separated, one entry per line)
-static void queue_save(void) {
+void queue_save(void) {
     if (entryCount == 0) {
         remove(QUEUE_PATH);
         return;
@@ -28,8 +38,9 @@ static void queue_save(void) {
     }
     if (!f) return;
     for (int i = 0; i < entryCount; i++) {
-        fprintf(f, "%d\t%d\t%s\t%s\t%s\n", entries[i].romId, entries[i].platformId, entries[i].platformSlug,
-                entries[i].fsName, entries[i].name);
+        const QueueEntry *e = &entries[i];
+        fprintf(f, "%d\t%d\t%s\t%s\t%s\t%llu\t%s\n", e->romId, e->platformId, e->platformSlug, e->fsName, e->md5Hash,
+                (unsigned long long)e->sizeBytes, e->name);
     }
     if (ferror(f)) {
         log_error("Failed to write queue file");
@@ -51,11 +62,12 @@ static void queue_load(void) {
         if (nl) *nl = '\0';
         if (line[0] == '\0') continue;
 
-        // Parse: romId \t platformId \t platformSlug \t fsName \t name
-        char *fields[5];
+        // Parse: romId \t platformId \t platformSlug \t fsName \t md5 \t size \t name
+        // Files written before the md5 and size columns have five or six fields.
+        char *fields[7];
         int fieldCount = 0;
         char *p = line;
-        for (int i = 0; i < 4 && p; i++) {
+        for (int i = 0; i < 6 && p; i++) {
             fields[fieldCount++] = p;
             p = strchr(p, '\t');
             if (p) *p++ = '\0';
@@ -71,8 +83,10 @@ static void queue_load(void) {
         e->platformId = atoi(fields[1]);
         snprintf(e->platformSlug, sizeof(e->platformSlug), "%s", fields[2]);
         snprintf(e->fsName, sizeof(e->fsName), "%s", fields[3]);
-        snprintf(e->name, sizeof(e->name), "%s", fields[4]);
-        e->failed = false;
+        snprintf(e->md5Hash, sizeof(e->md5Hash), "%s", fieldCount >= 6 ? fields[4] : "");
+        e->sizeBytes = fieldCount == 7 ? strtoull(fields[5], NULL, 10) : 0;
+        snprintf(e->name, sizeof(e->name), "%s", fields[fieldCount - 1]);
+        e->state = QUEUE_ENTRY_PENDING;
         entryCount++;
     }
 
@@ -92,7 +106,8 @@ void queue_init(void) {
     queue_load();
 }
 
-bool queue_add(int romId, int platformId, const char *name, const char *fsName, const char *platformSlug) {
+bool queue_add(int romId, int platformId, const char *name, const char *fsName, const char *platformSlug,
+               const char *md5Hash, uint64_t sizeBytes) {
     if (entryCount >= QUEUE_MAX_ENTRIES) return false;
     if (queue_contains(romId)) return false;
 
@@ -102,7 +117,9 @@ bool queue_add(int romId, int platformId, const char *name, const char *fsName,
     snprintf(e->name, sizeof(e->name), "%s", name);
     snprintf(e->fsName, sizeof(e->fsName), "%s", fsName);
     snprintf(e->platformSlug, sizeof(e->platformSlug), "%s", platformSlug);
-    e->failed = false;
+    snprintf(e->md5Hash, sizeof(e->md5Hash), "%s", md5Hash ? md5Hash : "");
+    e->sizeBytes = sizeBytes;
+    e->state = QUEUE_ENTRY_PENDING;
     entryCount++;
     queue_save();
     return true;
@@ -138,10 +155,70 @@ QueueEntry *queue_get(int index) {
     return &entries[index];
 }
 
-void queue_set_failed(int index, bool failed) {
+void queue_set_state(int index, QueueEntryState state) {
     if (index >= 0 && index < entryCount) {
-        entries[index].failed = failed;
+        entries[index].state = state;
+    }
+}
+
+bool queue_set_size(int index, uint64_t sizeBytes) {
+    if (index < 0 || index >= entryCount || entries[index].sizeBytes == sizeBytes) return false;
+    entries[index].sizeBytes = sizeBytes;
+    return true;
+}
+
+uint64_t queue_total_bytes(int *unknownCount) {
+    uint64_t total = 0;
+    int unknown = 0;
+    for (int i = 0; i < entryCount; i++) {
+        if (entries[i].state != QUEUE_ENTRY_PENDING) continue;
+        total += entries[i].sizeBytes;
+        if (entries[i].sizeBytes == 0) unknown++;
     }
+    if (unknownCount) *unknownCount = unknown;
+    return total;
+}
+
+void queue_set_order(QueueOrder newOrder) {
+    if (newOrder >= 0 && newOrder < QUEUE_ORDER_COUNT) order = newOrder;
+}
+
+QueueOrder queue_get_order(void) {
+    return order;
+}
+
+const char *queue_order_key(QueueOrder o) {
+    return orderNames[o].key;
+}
+
+const char *queue_order_label(QueueOrder o) {
+    return orderNames[o].label;
+}
+
+QueueOrder queue_order_from_key(const char *key) {
+    for (int i = 0; i < QUEUE_ORDER_COUNT; i++) {
+        if (strcmp(key, orderNames[i].key) == 0) return (QueueOrder)i;
+    }
+    return QUEUE_ORDER_FIFO;
+}
+
+// Whether entry a should be downloaded before entry b under the current order
+static bool schedule_before(const QueueEntry *a, const QueueEntry *b) {
+    if (a->sizeBytes == 0 || b->sizeBytes == 0) return a->sizeBytes != 0 && b->sizeBytes == 0;
+    if (order == QUEUE_ORDER_SHORTEST_FIRST) return a->sizeBytes < b->sizeBytes;
+    return a->sizeBytes > b->sizeBytes;
+}
+
+int queue_schedule(int out[QUEUE_MAX_ENTRIES]) {
+    // Insertion sort: stable, so equal sizes keep the order they were queued in
+    for (int i = 0; i < entryCount; i++) {
+        int j = i;
+        if (order != QUEUE_ORDER_FIFO) {
+            for (; j > 0 && schedule_before(&entries[i], &entries[out[j - 1]]); j--) out[j] = out[j - 1];
+        }
+        out[j] = i;
+    }
+    return entryCount;
 }
 
 void queue_clear(void) {
@@ -152,6 +229,6 @@ void queue_clear(void) {
 
 void queue_clear_failed(void) {
     for (int i = 0; i < entryCount; i++) {
-        entries[i].failed = false;
+        entries[i].state = QUEUE_ENTRY_PENDING;
     }
 }
@@ -6,23 +6,42 @@
 #define QUEUE_H
 
 #include <stdbool.h>
+#include <stdint.h>
 
 #define QUEUE_MAX_ENTRIES 64
 
+typedef enum {
+    QUEUE_ENTRY_PENDING,
+    QUEUE_ENTRY_FAILED,   // Download or extraction failed
+    QUEUE_ENTRY_CORRUPT,  // Downloaded, but the checksum didn't match the server's
+    QUEUE_ENTRY_NO_SPACE, // Deferred: doesn't fit in the free space left on the card
+} QueueEntryState;
+
+// Order in which queue entries are downloaded. Entries of unknown size go last under the size orders.
+typedef enum {
+    QUEUE_ORDER_FIFO,
+    QUEUE_ORDER_SHORTEST_FIRST, // Many small ROMs finish before one large image holds them back
+    QUEUE_ORDER_LARGEST_FIRST,
+    QUEUE_ORDER_COUNT,
+} QueueOrder;
+
 typedef struct {
     int romId;
     int platformId;
     char name[256];
     char fsName[256];
     char platformSlug[64];
-    bool failed;
+    char md5Hash[33];   // Expected MD5 from the server, empty if unknown
+    uint64_t sizeBytes; // File size from the server, 0 if unknown
+    QueueEntryState state;
 } QueueEntry;
 
 // Initialize queue
 void queue_init(void);
 
 // Add a ROM to the queue. Returns true if added, false if full or duplicate.
-bool queue_add(int romId, int platformId, const char *name, const char *fsName, const char *platformSlug);
+bool queue_add(int romId, int platformId, const char *name, const char *fsName, const char *platformSlug,
+               const char *md5Hash, uint64_t sizeBytes);
 
 // Remove entry by romId. Returns true if found and removed.
 bool queue_remove(int romId);
@@ -36,13 +55,38 @@ int queue_count(void);
 // Get entry at index (returns NULL if out of bounds)
 QueueEntry *queue_get(int index);
 
-// Mark entry as failed
-void queue_set_failed(int index, bool failed);
+// Set the state shown for an entry (not persisted)
+void queue_set_state(int index, QueueEntryState state);
+
+// Cache the size of an entry added before it was known. Returns true if it changed; call queue_save() to keep
+// it, once after a batch of sizes rather than per entry.
+bool queue_set_size(int index, uint64_t sizeBytes);
+
+// Write the queue file (every other change saves itself)
+void queue_save(void);
+
+// Sum of the known sizes of pending entries (failed and deferred ones are left out); unknownCount (optional)
+// receives how many pending entries have none
+uint64_t queue_total_bytes(int *unknownCount);
+
+// Choose the download order, and read it back
+void queue_set_order(QueueOrder order);
+QueueOrder queue_get_order(void);
+
+// Config file key ("fifo", "shortest", "largest") and display label for an order
+const char *queue_order_key(QueueOrder order);
+const char *queue_order_label(QueueOrder order);
+
+// Parse a config key, falling back to FIFO
+QueueOrder queue_order_from_key(const char *key);
+
+// Fill order with every entry index in download order for the current policy. Returns the count.
+int queue_schedule(int order[QUEUE_MAX_ENTRIES]);
 
 // Clear all entries
 void queue_clear(void);
 
-// Clear failed flags (reset all to not-failed)
+// Reset every entry to pending
 void queue_clear_failed(void);
 
 #endif // QUEUE_H
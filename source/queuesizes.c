@@ -0,0 +1,108 @@
+/*
+ * Queue sizes module - Looks up sizes missing from queue entries in the background
+ */
+
+#include "queuesizes.h"
+#include "api.h"
+#include "log.h"
+#include "queue.h"
+#include "thread.h"
+#include <string.h>
+
+#define QUEUESIZES_STACK_SIZE (64 * 1024) // Requests resolve, connect and inflate
+
+typedef struct {
+    int romId;
+    uint64_t sizeBytes;
+} SizeResult;
+
+static ThreadHandle *thread = NULL;
+static bool lockReady = false;
+
+// Guarded by lock
+static ThreadMutex lock;
+static int romIds[QUEUE_MAX_ENTRIES];
+static int romCount;
+static SizeResult results[QUEUE_MAX_ENTRIES];
+static int resultHead;
+static int resultCount;
+static bool running = false;
+static bool stopping = false;
+
+static void queuesizes_main(void *arg) {
+    (void)arg;
+    int found = 0;
+    thread_mutex_lock(&lock);
+    for (int i = 0; i < romCount && !stopping; i++) {
+        int romId = romIds[i];
+        thread_mutex_unlock(&lock);
+        uint64_t sizeBytes;
+        bool ok = api_get_rom_size(romId, &sizeBytes);
+        thread_mutex_lock(&lock);
+        if (ok) {
+            results[(resultHead + resultCount) % QUEUE_MAX_ENTRIES] = (SizeResult){romId, sizeBytes};
+            resultCount++;
+            found++;
+        }
+    }
+    log_info("Found sizes for %d of %d queued ROMs", found, romCount);
+    running = false;
+    thread_mutex_unlock(&lock);
+}
+
+bool queuesizes_start(const int *ids, int count) {
+    if (!lockReady) {
+        thread_mutex_init(&lock);
+        lockReady = true;
+    }
+    thread_mutex_lock(&lock);
+    bool busy = running;
+    thread_mutex_unlock(&lock);
+    if (busy) return false;
+    if (thread) thread_join(thread); // Finished; release it
+
+    if (count > QUEUE_MAX_ENTRIES) count = QUEUE_MAX_ENTRIES;
+    memcpy(romIds, ids, count * sizeof(int));
+    romCount = count;
+    resultHead = resultCount = 0;
+    running = true;
+    stopping = false;
+    thread = thread_start(queuesizes_main, NULL, QUEUESIZES_STACK_SIZE);
+    if (!thread) {
+        log_error("Failed to start ROM size lookup");
+        running = false;
+        return false;
+    }
+    return true;
+}
+
+bool queuesizes_poll(int *romId, uint64_t *sizeBytes) {
+    if (!lockReady) return false;
+    thread_mutex_lock(&lock);
+    bool found = resultCount > 0;
+    if (found) {
+        *romId = results[resultHead].romId;
+        *sizeBytes = results[resultHead].sizeBytes;
+        resultHead = (resultHead + 1) % QUEUE_MAX_ENTRIES;
+        resultCount--;
+    }
+    thread_mutex_unlock(&lock);
+    return found;
+}
+
+bool queuesizes_busy(void) {
+    if (!lockReady) return false;
+    thread_mutex_lock(&lock);
+    bool busy = running || resultCount > 0;
+    thread_mutex_unlock(&lock);
+    return busy;
+}
+
+void queuesizes_exit(void) {
+    if (!thread) return;
+    thread_mutex_lock(&lock);
+    stopping = true;
+    thread_mutex_unlock(&lock);
+    thread_join(thread);
+    thread = NULL;
+}
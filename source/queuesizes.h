@@ -0,0 +1,28 @@
+/*
+ * Queue sizes module - Looks up sizes missing from queue entries in the background
+ *
+ * Entries queued before the server reported a size need a request each to
+ * learn it. A thread sends them one after another, so the queue screen opens
+ * at once and fills in (and re-sorts) as sizes arrive. Results are handed to
+ * the main thread, which owns the queue.
+ */
+
+#ifndef QUEUESIZES_H
+#define QUEUESIZES_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Start looking up the sizes of romIds. Returns false if a lookup is still running or the thread can't start.
+bool queuesizes_start(const int *romIds, int count);
+
+// Take the next size found, on the main thread. Returns false if there is none yet.
+bool queuesizes_poll(int *romId, uint64_t *sizeBytes);
+
+// True while lookups are running or results are waiting to be polled
+bool queuesizes_busy(void);
+
+// Stop after the request in flight and wait for the thread
+void queuesizes_exit(void);
+
+#endif // QUEUESIZES_H
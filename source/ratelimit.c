@@ -0,0 +1,94 @@
+/*
+ * Rate limit module - Token bucket shared by concurrent transfers
+ */
+
+#include "ratelimit.h"
+#include "transport.h"
+#include <string.h>
+
+void ratelimit_init(RateLimit *rl) {
+    memset(rl, 0, sizeof(RateLimit));
+    thread_mutex_init(&rl->lock);
+    rl->lastRefillUs = transport_now_us();
+}
+
+void ratelimit_set_rate(RateLimit *rl, uint32_t bytesPerSecond) {
+    thread_mutex_lock(&rl->lock);
+    rl->bytesPerSecond = bytesPerSecond;
+    thread_mutex_unlock(&rl->lock);
+}
+
+void ratelimit_set_backoff(RateLimit *rl, uint32_t bytesPerSecond) {
+    thread_mutex_lock(&rl->lock);
+    rl->backoffBytesPerSecond = bytesPerSecond;
+    thread_mutex_unlock(&rl->lock);
+}
+
+void ratelimit_foreground_begin(RateLimit *rl) {
+    thread_mutex_lock(&rl->lock);
+    rl->foreground++;
+    thread_mutex_unlock(&rl->lock);
+}
+
+void ratelimit_foreground_end(RateLimit *rl) {
+    thread_mutex_lock(&rl->lock);
+    if (rl->foreground > 0) rl->foreground--;
+    rl->foregroundEndUs = transport_now_us();
+    thread_mutex_unlock(&rl->lock);
+}
+
+// Rate in force at now, 0 if unlimited. Caller holds lock.
+static uint32_t current_rate(const RateLimit *rl, uint64_t now) {
+    uint32_t rate = rl->bytesPerSecond;
+    bool recent = rl->foregroundEndUs > 0 && now - rl->foregroundEndUs < RATELIMIT_LINGER_MS * 1000ULL;
+    bool backOff = (rl->foreground > 0 || recent) && rl->backoffBytesPerSecond > 0;
+    if (backOff && (rate == 0 || rl->backoffBytesPerSecond < rate)) rate = rl->backoffBytesPerSecond;
+    return rate;
+}
+
+size_t ratelimit_acquire(RateLimit *rl, size_t want) {
+    thread_mutex_lock(&rl->lock);
+    uint64_t now = transport_now_us();
+    uint32_t rate = current_rate(rl, now);
+    if (rate == 0) {
+        rl->lastRefillUs = now;
+        thread_mutex_unlock(&rl->lock);
+        return want;
+    }
+
+    // Refill, keeping at most a burst's worth so an idle spell doesn't turn into a flood
+    double burst = rate * (RATELIMIT_BURST_MS / 1000.0);
+    rl->tokens += rate * ((now - rl->lastRefillUs) / 1000000.0);
+    if (rl->tokens > burst) rl->tokens = burst;
+    rl->lastRefillUs = now;
+
+    // Grants below a burst (or the whole request, if smaller) would only mean more, smaller reads
+    double need = want < burst ? want : burst;
+    if (rl->tokens >= need) {
+        size_t granted = rl->tokens < want ? (size_t)rl->tokens : want;
+        rl->tokens -= granted;
+        thread_mutex_unlock(&rl->lock);
+        return granted;
+    }
+
+    uint32_t waitMs = (uint32_t)((need - rl->tokens) * 1000.0 / rate) + 1;
+    if (waitMs > RATELIMIT_MAX_WAIT_MS) waitMs = RATELIMIT_MAX_WAIT_MS;
+    rl->waitedMs += waitMs;
+    thread_mutex_unlock(&rl->lock);
+    thread_sleep_ms(waitMs);
+    return 0;
+}
+
+void ratelimit_refund(RateLimit *rl, size_t unused) {
+    if (unused == 0) return;
+    thread_mutex_lock(&rl->lock);
+    rl->tokens += unused;
+    thread_mutex_unlock(&rl->lock);
+}
+
+uint64_t ratelimit_waited_ms(RateLimit *rl) {
+    thread_mutex_lock(&rl->lock);
+    uint64_t waited = rl->waitedMs;
+    thread_mutex_unlock(&rl->lock);
+    return waited;
+}
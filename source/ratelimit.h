@@ -0,0 +1,56 @@
+/*
+ * Rate limit module - Token bucket shared by concurrent transfers
+ *
+ * Readers take tokens before each read, so every transfer drawing from one
+ * bucket together stays under its rate. A second, lower rate applies while
+ * foreground requests are in flight, so background downloads give way to the
+ * small requests the UI is waiting on. The lower rate holds for a while after
+ * the last one ends: data a transfer already has in flight sits in the link
+ * ahead of the next request, so backing off only once it starts is too late.
+ */
+
+#ifndef RATELIMIT_H
+#define RATELIMIT_H
+
+#include "thread.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#define RATELIMIT_BURST_MS 100   // Tokens saved up while idle, in milliseconds of the current rate
+#define RATELIMIT_MAX_WAIT_MS 50 // Longest single sleep, so rate changes are noticed quickly
+#define RATELIMIT_LINGER_MS 3000 // Back off this long after the last foreground request ends
+
+typedef struct {
+    ThreadMutex lock;
+    uint32_t bytesPerSecond;        // 0 = unlimited
+    uint32_t backoffBytesPerSecond; // Applies while foreground requests are in flight, 0 = no back off
+    int foreground;                 // Foreground requests in flight
+    uint64_t foregroundEndUs;       // When the last one finished
+    double tokens;
+    uint64_t lastRefillUs;
+    uint64_t waitedMs; // Time readers spent waiting for tokens
+} RateLimit;
+
+void ratelimit_init(RateLimit *rl);
+
+// Cap the combined rate of every reader (0 = unlimited)
+void ratelimit_set_rate(RateLimit *rl, uint32_t bytesPerSecond);
+
+// Rate to drop to while foreground requests are in flight and for RATELIMIT_LINGER_MS after (0 = don't back off)
+void ratelimit_set_backoff(RateLimit *rl, uint32_t bytesPerSecond);
+
+// Mark a foreground request as started / finished
+void ratelimit_foreground_begin(RateLimit *rl);
+void ratelimit_foreground_end(RateLimit *rl);
+
+// Wait for tokens and take up to want of them. Returns how many bytes the caller may read now (want if
+// unlimited). Sleeps at most RATELIMIT_MAX_WAIT_MS per call, so it can return 0; callers loop.
+size_t ratelimit_acquire(RateLimit *rl, size_t want);
+
+// Give back tokens for bytes granted but not read
+void ratelimit_refund(RateLimit *rl, size_t unused);
+
+// Total time readers have spent waiting for tokens
+uint64_t ratelimit_waited_ms(RateLimit *rl);
+
+#endif // RATELIMIT_H
@@ -0,0 +1,160 @@
+/*
+ * Reachability module - Tracks whether the RomM server can be reached
+ */
+
+#include "reachability.h"
+#include "log.h"
+#include "thread.h"
+#include "transport.h"
+#include <stdio.h>
+
+#define REACHABILITY_URL_LEN 512
+#define REACHABILITY_STACK_SIZE (32 * 1024) // Probes resolve and connect, which can be stack hungry
+
+typedef enum {
+    REACHABILITY_UNKNOWN, // Nothing sent yet since startup or the last server change
+    REACHABILITY_ONLINE,  // The last request got a response
+    REACHABILITY_OFFLINE, // The last request got none; probing until one does
+} ReachabilityState;
+
+static ThreadMutex lock;
+static ThreadCond wake;
+static ThreadHandle *thread = NULL;
+static bool stopping = false;
+
+// Guarded by lock
+static ReachabilityState state = REACHABILITY_UNKNOWN;
+static char probeUrl[REACHABILITY_URL_LEN];
+static uint32_t generation;        // Bumped when the server changes, so a stale probe result is dropped
+static uint64_t offlineSinceMs;
+static uint64_t nextProbeMs;
+static uint32_t probeDelayMs;
+static TransportRequest *probeReq; // In flight, so exit can abort it
+
+// Caller holds lock
+static void set_offline(void) {
+    state = REACHABILITY_OFFLINE;
+    offlineSinceMs = transport_now_ms();
+    probeDelayMs = REACHABILITY_PROBE_MIN_MS;
+    nextProbeMs = offlineSinceMs + probeDelayMs;
+    thread_cond_signal(&wake);
+}
+
+// Caller holds lock
+static void set_online(void) {
+    if (state == REACHABILITY_OFFLINE) {
+        log_info("Server reachable again after %llu ms", (unsigned long long)(transport_now_ms() - offlineSinceMs));
+    }
+    state = REACHABILITY_ONLINE;
+}
+
+// Send one request to url. Anything but a failed connect or a timeout means the server is back; the response
+// itself isn't needed.
+static bool probe(const char *url) {
+    TransportRequest *req = transport_open(TRANSPORT_METHOD_GET, url);
+    if (!req) return false;
+    transport_add_header(req, "User-Agent", "Rommlet/1.0");
+
+    thread_mutex_lock(&lock);
+    probeReq = req;
+    thread_mutex_unlock(&lock);
+
+    bool reached = transport_begin(req) || !transport_unreachable(req);
+
+    thread_mutex_lock(&lock);
+    probeReq = NULL;
+    thread_mutex_unlock(&lock);
+    transport_close(req);
+    return reached;
+}
+
+static void reachability_main(void *arg) {
+    (void)arg;
+    thread_mutex_lock(&lock);
+    while (!stopping) {
+        if (state != REACHABILITY_OFFLINE || probeUrl[0] == '\0') {
+            thread_cond_wait(&wake, &lock);
+            continue;
+        }
+        uint64_t now = transport_now_ms();
+        if (now < nextProbeMs) {
+            thread_cond_wait_ms(&wake, &lock, (uint32_t)(nextProbeMs - now));
+            continue;
+        }
+
+        char url[REACHABILITY_URL_LEN];
+        snprintf(url, sizeof(url), "%s", probeUrl);
+        uint32_t probeGeneration = generation;
+        thread_mutex_unlock(&lock);
+        bool reached = probe(url);
+        thread_mutex_lock(&lock);
+
+        // A request may have got through meanwhile, or the server may have changed
+        if (stopping || probeGeneration != generation || state != REACHABILITY_OFFLINE) continue;
+        if (reached) {
+            set_online();
+        } else {
+            probeDelayMs = probeDelayMs * 2 < REACHABILITY_PROBE_MAX_MS ? probeDelayMs * 2 : REACHABILITY_PROBE_MAX_MS;
+            nextProbeMs = transport_now_ms() + probeDelayMs;
+            log_debug("Server still unreachable, next probe in %lu ms", (unsigned long)probeDelayMs);
+        }
+    }
+    thread_mutex_unlock(&lock);
+}
+
+void reachability_init(void) {
+    thread_mutex_init(&lock);
+    thread_cond_init(&wake);
+    stopping = false;
+    state = REACHABILITY_UNKNOWN;
+    probeReq = NULL;
+    thread = thread_start(reachability_main, NULL, REACHABILITY_STACK_SIZE);
+    if (!thread) log_warn("Failed to start reachability probe, an offline server is only retried by requests");
+}
+
+void reachability_exit(void) {
+    if (!thread) return;
+    thread_mutex_lock(&lock);
+    stopping = true;
+    if (probeReq) transport_abort(probeReq);
+    thread_cond_signal(&wake);
+    thread_mutex_unlock(&lock);
+    thread_join(thread);
+    thread = NULL;
+}
+
+void reachability_set_probe_url(const char *url) {
+    thread_mutex_lock(&lock);
+    snprintf(probeUrl, sizeof(probeUrl), "%s", url);
+    state = REACHABILITY_UNKNOWN;
+    generation++;
+    thread_cond_signal(&wake);
+    thread_mutex_unlock(&lock);
+}
+
+bool reachability_offline(void) {
+    // Without the probe thread nothing would bring the server back, so keep sending requests
+    if (!thread) return false;
+    thread_mutex_lock(&lock);
+    bool offline = state == REACHABILITY_OFFLINE;
+    if (offline && probeDelayMs > REACHABILITY_PROBE_MIN_MS) {
+        // Someone wants the server: probe again soon instead of after the backed-off gap
+        probeDelayMs = REACHABILITY_PROBE_MIN_MS;
+        uint64_t soon = transport_now_ms() + probeDelayMs;
+        if (soon < nextProbeMs) nextProbeMs = soon;
+        thread_cond_signal(&wake);
+    }
+    thread_mutex_unlock(&lock);
+    return offline;
+}
+
+void reachability_report(bool reached) {
+    thread_mutex_lock(&lock);
+    if (reached) {
+        set_online();
+    } else if (state != REACHABILITY_OFFLINE) {
+        log_warn("Server unreachable, skipping requests until it answers");
+        set_offline();
+    }
+    thread_mutex_unlock(&lock);
+}
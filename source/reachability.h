@@ -0,0 +1,36 @@
+/*
+ * Reachability module - Tracks whether the RomM server can be reached
+ *
+ * Every request to an unreachable server costs a full connect or response
+ * timeout, and navigating would pay it again on each screen. The first
+ * request that gets no response marks the server offline; later requests
+ * check first and fail at once (the API layer serves cached responses
+ * instead). While offline a background thread probes the server with
+ * growing gaps and marks it online again as soon as it answers.
+ */
+
+#ifndef REACHABILITY_H
+#define REACHABILITY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define REACHABILITY_PROBE_MIN_MS 1000
+#define REACHABILITY_PROBE_MAX_MS 30000
+
+// Start / stop the probe thread
+void reachability_init(void);
+void reachability_exit(void);
+
+// URL probed while offline (any HTTP response counts). Resets the state to unknown.
+void reachability_set_probe_url(const char *url);
+
+// True while requests should not be sent. Asking brings a backed-off probe forward, so the server is found
+// again soon after the user next tries something.
+bool reachability_offline(void);
+
+// Record the outcome of a request: reached is false only if it couldn't connect or got no response in time
+// (see transport_unreachable()); a dropped connection or an error status still means the server is there
+void reachability_report(bool reached);
+
+#endif // REACHABILITY_H
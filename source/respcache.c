@@ -0,0 +1,144 @@
+/*
+ * Response cache module - Last good JSON responses, for use while offline
+ */
+
+#include "respcache.h"
+#include "log.h"
+#include "thread.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    char *url; // NULL for a free slot
+    char *body;
+    size_t len;
+    uint32_t lastUsed;
+} RespCacheEntry;
+
+static ThreadMutex lock;
+static RespCacheEntry entries[RESPCACHE_MAX_ENTRIES]; // Guarded by lock
+static size_t totalBytes;
+static uint32_t useClock;
+
+// Caller holds lock
+static void drop_entry(RespCacheEntry *e) {
+    totalBytes -= e->len;
+    free(e->url);
+    free(e->body);
+    memset(e, 0, sizeof(*e));
+}
+
+// Caller holds lock
+static RespCacheEntry *find_entry(const char *url) {
+    for (int i = 0; i < RESPCACHE_MAX_ENTRIES; i++) {
+        if (entries[i].url && strcmp(entries[i].url, url) == 0) return &entries[i];
+    }
+    return NULL;
+}
+
+// Least recently used entry, or NULL if there are none. Caller holds lock.
+static RespCacheEntry *lru_entry(void) {
+    RespCacheEntry *oldest = NULL;
+    for (int i = 0; i < RESPCACHE_MAX_ENTRIES; i++) {
+        if (entries[i].url && (!oldest || entries[i].lastUsed < oldest->lastUsed)) oldest = &entries[i];
+    }
+    return oldest;
+}
+
+// A free slot, evicting the least recently used entry if there is none. Caller holds lock.
+static RespCacheEntry *free_entry(void) {
+    for (int i = 0; i < RESPCACHE_MAX_ENTRIES; i++) {
+        if (!entries[i].url) return &entries[i];
+    }
+    RespCacheEntry *e = lru_entry();
+    drop_entry(e);
+    return e;
+}
+
+void respcache_init(void) {
+    thread_mutex_init(&lock);
+}
+
+void respcache_clear(void) {
+    thread_mutex_lock(&lock);
+    for (int i = 0; i < RESPCACHE_MAX_ENTRIES; i++) {
+        if (entries[i].url) drop_entry(&entries[i]);
+    }
+    thread_mutex_unlock(&lock);
+}
+
+void respcache_store(const char *url, const char *body, size_t len) {
+    if (len > RESPCACHE_MAX_ENTRY_SIZE) return;
+    char *urlCopy = strdup(url);
+    char *bodyCopy = malloc(len + 1);
+    if (!urlCopy || !bodyCopy) {
+        free(urlCopy);
+        free(bodyCopy);
+        return;
+    }
+    memcpy(bodyCopy, body, len);
+    bodyCopy[len] = '\0';
+
+    thread_mutex_lock(&lock);
+    RespCacheEntry *e = find_entry(url);
+    if (e) drop_entry(e);
+    while (totalBytes + len > RESPCACHE_MAX_BYTES) drop_entry(lru_entry());
+    e = free_entry();
+    e->url = urlCopy;
+    e->body = bodyCopy;
+    e->len = len;
+    e->lastUsed = ++useClock;
+    totalBytes += len;
+    thread_mutex_unlock(&lock);
+}
+
+char *respcache_lookup(const char *url, size_t *len) {
+    char *copy = NULL;
+    thread_mutex_lock(&lock);
+    RespCacheEntry *e = find_entry(url);
+    if (e && (copy = malloc(e->len + 1))) {
+        memcpy(copy, e->body, e->len + 1);
+        *len = e->len;
+        e->lastUsed = ++useClock;
+    }
+    thread_mutex_unlock(&lock);
+    return copy;
+}
+
+void respcache_record_append(RespCacheRecord *rec, const char *data, size_t len) {
+    if (rec->tooLarge) return;
+    if (rec->len + len > RESPCACHE_MAX_ENTRY_SIZE) {
+        respcache_record_discard(rec);
+        rec->tooLarge = true;
+        return;
+    }
+    if (rec->len + len > rec->capacity) {
+        size_t newCapacity = rec->capacity > 0 ? rec->capacity : len;
+        while (newCapacity < rec->len + len) newCapacity *= 2;
+        if (newCapacity > RESPCACHE_MAX_ENTRY_SIZE) newCapacity = RESPCACHE_MAX_ENTRY_SIZE;
+        char *grown = realloc(rec->data, newCapacity);
+        if (!grown) {
+            respcache_record_discard(rec);
+            rec->tooLarge = true;
+            return;
+        }
+        rec->data = grown;
+        rec->capacity = newCapacity;
+    }
+    memcpy(rec->data + rec->len, data, len);
+    rec->len += len;
+}
+
+void respcache_record_commit(RespCacheRecord *rec, const char *url) {
+    if (!rec->tooLarge) respcache_store(url, rec->data ? rec->data : "", rec->len);
+    respcache_record_discard(rec);
+}
+
+void respcache_record_discard(RespCacheRecord *rec) {
+    free(rec->data);
+    rec->data = NULL;
+    rec->len = 0;
+    rec->capacity = 0;
+    rec->tooLarge = false;
+}
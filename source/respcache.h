@@ -0,0 +1,48 @@
+/*
+ * Response cache module - Last good JSON responses, for use while offline
+ *
+ * Decoded bodies of successful JSON requests are kept in memory by URL, least
+ * recently used first out, so screens visited before the server became
+ * unreachable can still be shown. Nothing is persisted; online requests
+ * always go to the server.
+ */
+
+#ifndef RESPCACHE_H
+#define RESPCACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#define RESPCACHE_MAX_BYTES (512 * 1024)     // All entries together
+#define RESPCACHE_MAX_ENTRY_SIZE (128 * 1024) // Larger responses aren't kept
+#define RESPCACHE_MAX_ENTRIES 32
+
+// A body collected chunk by chunk while it streams, stored once complete
+typedef struct {
+    char *data;
+    size_t len;
+    size_t capacity;
+    bool tooLarge;
+} RespCacheRecord;
+
+void respcache_init(void);
+
+// Drop every entry (the server changed)
+void respcache_clear(void);
+
+// Keep a copy of the body of url, replacing any older one
+void respcache_store(const char *url, const char *body, size_t len);
+
+// Copy of the cached body of url, NUL-terminated, or NULL if none. Caller frees.
+char *respcache_lookup(const char *url, size_t *len);
+
+// Append a streamed chunk; gives up (and frees what it had) once the body outgrows an entry
+void respcache_record_append(RespCacheRecord *rec, const char *data, size_t len);
+
+// Store a complete recorded body under url and free the record
+void respcache_record_commit(RespCacheRecord *rec, const char *url);
+
+// Free a record without storing it
+void respcache_record_discard(RespCacheRecord *rec);
+
+#endif // RESPCACHE_H
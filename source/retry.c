@@ -0,0 +1,85 @@
+/*
+ * Retry module - Backoff policy for failed requests
+ */
+
+#include "retry.h"
+#include "log.h"
+#include "transport.h"
+#include <stdlib.h>
+
+void retry_init(Retry *r, const RetryPolicy *policy) {
+    r->policy = policy;
+    r->failures = 0;
+    r->seed = (uint32_t)transport_now_us() | 1;
+}
+
+RetryReason retry_classify_status(int status) {
+    if (status == 408) return RETRY_TIMEOUT;
+    if (status == 429) return RETRY_THROTTLED;
+    // 501 and 505 won't change on a second try
+    if (status >= 500 && status != 501 && status != 505) return RETRY_SERVER;
+    return RETRY_FATAL;
+}
+
+uint32_t retry_parse_after(const char *value) {
+    char *end;
+    unsigned long seconds = strtoul(value, &end, 10);
+    if (end == value || *end != '\0' || seconds > UINT32_MAX / 1000) return 0;
+    return (uint32_t)seconds * 1000;
+}
+
+// xorshift32; rand() isn't safe to share between download threads
+static uint32_t next_random(Retry *r) {
+    uint32_t x = r->seed;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    r->seed = x;
+    return x;
+}
+
+bool retry_next(Retry *r, const RetryCause *cause, uint32_t *delayMs) {
+    const RetryPolicy *policy = r->policy;
+    if (cause->reason == RETRY_FATAL) return false;
+    if (r->failures >= policy->maxRetries) {
+        log_warn("Giving up after %d retries (%s)", r->failures, retry_reason_name(cause->reason));
+        return false;
+    }
+    if (cause->retryAfterMs > policy->maxRetryAfterMs) {
+        log_warn("Server asked to retry in %lu s, giving up", (unsigned long)(cause->retryAfterMs / 1000));
+        return false;
+    }
+
+    uint32_t backoff = policy->baseDelayMs;
+    for (int i = 0; i < r->failures && backoff < policy->maxDelayMs; i++) backoff *= 2;
+    if (backoff > policy->maxDelayMs) backoff = policy->maxDelayMs;
+    // Equal jitter: at least half the backoff, so the delay still grows
+    *delayMs = backoff / 2 + next_random(r) % (backoff / 2 + 1);
+    if (cause->retryAfterMs > 0) *delayMs = cause->retryAfterMs;
+
+    r->failures++;
+    log_info("Retry %d/%d in %lu ms (%s)", r->failures, policy->maxRetries, (unsigned long)*delayMs,
+             retry_reason_name(cause->reason));
+    return true;
+}
+
+void retry_progress(Retry *r) {
+    r->failures = 0;
+}
+
+const char *retry_reason_name(RetryReason reason) {
+    switch (reason) {
+    case RETRY_CONNECT:
+        return "connect failed";
+    case RETRY_DROPPED:
+        return "connection dropped";
+    case RETRY_TIMEOUT:
+        return "timed out";
+    case RETRY_SERVER:
+        return "server error";
+    case RETRY_THROTTLED:
+        return "throttled";
+    default:
+        return "fatal";
+    }
+}
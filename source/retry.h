@@ -0,0 +1,60 @@
+/*
+ * Retry module - Backoff policy for failed requests
+ *
+ * Failures are classified by what went wrong, so only those a later attempt
+ * can fix are retried. Delays grow exponentially up to a cap, with half of
+ * each one randomized so clients that failed together don't retry together.
+ * A server's Retry-After replaces the computed delay.
+ */
+
+#ifndef RETRY_H
+#define RETRY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef enum {
+    RETRY_FATAL,     // Retrying won't help: success, client errors, local failures, cancel
+    RETRY_CONNECT,   // Request couldn't be sent or got no response headers
+    RETRY_DROPPED,   // Connection failed part-way through the body
+    RETRY_TIMEOUT,   // No progress for the stall timeout, or 408
+    RETRY_SERVER,    // 5xx
+    RETRY_THROTTLED, // 429
+} RetryReason;
+
+// Why an attempt failed. retryAfterMs is the server's Retry-After (0 = none).
+typedef struct {
+    RetryReason reason;
+    uint32_t retryAfterMs;
+} RetryCause;
+
+typedef struct {
+    int maxRetries;           // Consecutive failed attempts retried before giving up
+    uint32_t baseDelayMs;     // First delay; doubles with each consecutive failure
+    uint32_t maxDelayMs;      // Cap on the computed delay
+    uint32_t maxRetryAfterMs; // Give up instead when the server asks for a longer wait
+} RetryPolicy;
+
+typedef struct {
+    const RetryPolicy *policy;
+    int failures; // Consecutive, reset by retry_progress()
+    uint32_t seed;
+} Retry;
+
+void retry_init(Retry *r, const RetryPolicy *policy);
+
+// Classify an HTTP status. 2xx/3xx and most 4xx are fatal.
+RetryReason retry_classify_status(int status);
+
+// Parse a Retry-After header in delta-seconds form. Returns 0 for dates or garbage.
+uint32_t retry_parse_after(const char *value);
+
+// Record a failed attempt. Returns true with *delayMs set if it should be retried.
+bool retry_next(Retry *r, const RetryCause *cause, uint32_t *delayMs);
+
+// The last attempt moved the transfer forward; later failures start the backoff over
+void retry_progress(Retry *r);
+
+const char *retry_reason_name(RetryReason reason);
+
+#endif // RETRY_H
@@ -29,5 +29,5 @@ void about_draw(void) {
                          "To say thanks, scan the QR code below to sponsor the project.",
                          UI_COLOR_TEXT, 4, 0);
 
-    ui_draw_text(UI_PADDING, SCREEN_TOP_HEIGHT - UI_LINE_HEIGHT - UI_PADDING, "B: Back", UI_COLOR_TEXT_DIM);
+    ui_draw_text(UI_PADDING, ui_hint_y(), "B: Back", UI_COLOR_TEXT_DIM);
 }
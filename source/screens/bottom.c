@@ -37,6 +37,7 @@ static bool cancelButtonPressed = false;
 static bool downloadButtonPressed = false;
 static bool queueButtonPressed = false;
 static bool startDownloadsPressed = false;
+static bool downloadsActive = false;
 static bool clearQueuePressed = false;
 static bool confirmClearPressed = false;
 static bool cancelClearPressed = false;
@@ -149,6 +150,10 @@ void bottom_set_queue_count(int count) {
     queueItemCount = count;
 }
 
+void bottom_set_downloads_active(bool active) {
+    downloadsActive = active;
+}
+
 void bottom_set_folder_name(const char *name) {
     if (name) {
         snprintf(folderName, sizeof(folderName), "%s", name);
@@ -189,10 +194,11 @@ BottomAction bottom_update(void) {
     } else if (currentMode == BOTTOM_MODE_QUEUE) {
         TouchButton buttons[] = {
             {BUTTON_X, SAVE_BUTTON_Y_DUAL, BUTTON_WIDTH, BUTTON_HEIGHT, &startDownloadsPressed,
-             BOTTOM_ACTION_START_DOWNLOADS},
+             downloadsActive ? BOTTOM_ACTION_CANCEL_DOWNLOADS : BOTTOM_ACTION_START_DOWNLOADS},
             {BUTTON_X, CANCEL_BUTTON_Y, BUTTON_WIDTH, BUTTON_HEIGHT, &clearQueuePressed, BOTTOM_ACTION_CLEAR_QUEUE},
         };
-        action = handle_touch_buttons(buttons, queueItemCount > 0 ? 2 : 0, kDown, kHeld, kUp);
+        int buttonCount = queueItemCount > 0 ? 2 : (downloadsActive ? 1 : 0);
+        action = handle_touch_buttons(buttons, buttonCount, kDown, kHeld, kUp);
     } else if (currentMode == BOTTOM_MODE_QUEUE_CONFIRM) {
         TouchButton buttons[] = {
             {BUTTON_X, SAVE_BUTTON_Y_DUAL, BUTTON_WIDTH, BUTTON_HEIGHT, &confirmClearPressed,
@@ -304,19 +310,18 @@ static void draw_rom_actions_screen(void) {
     ui_draw_button(BUTTON_X, CANCEL_BUTTON_Y, BUTTON_WIDTH, BUTTON_HEIGHT, queueLabel, queueButtonPressed, queueStyle);
 }
 
-static void draw_downloading_screen(void) {
-    ui_draw_rect(0, 0, SCREEN_BOTTOM_WIDTH, SCREEN_BOTTOM_HEIGHT, UI_COLOR_BG);
-    ui_draw_button(BUTTON_X, SAVE_BUTTON_Y_SINGLE, BUTTON_WIDTH, BUTTON_HEIGHT, "Cancel Download", false,
-                   UI_BUTTON_DANGER);
-}
-
 static void draw_queue_screen(void) {
     ui_draw_rect(0, 0, SCREEN_BOTTOM_WIDTH, SCREEN_BOTTOM_HEIGHT, UI_COLOR_BG);
     draw_toolbar();
 
-    if (queueItemCount > 0) {
+    if (downloadsActive) {
+        ui_draw_button(BUTTON_X, SAVE_BUTTON_Y_DUAL, BUTTON_WIDTH, BUTTON_HEIGHT, "Cancel Downloads",
+                       startDownloadsPressed, UI_BUTTON_DANGER);
+    } else if (queueItemCount > 0) {
         ui_draw_button(BUTTON_X, SAVE_BUTTON_Y_DUAL, BUTTON_WIDTH, BUTTON_HEIGHT, "Start Downloads",
                        startDownloadsPressed, UI_BUTTON_PRIMARY);
+    }
+    if (queueItemCount > 0) {
         ui_draw_button(BUTTON_X, CANCEL_BUTTON_Y, BUTTON_WIDTH, BUTTON_HEIGHT, "Clear Queue", clearQueuePressed,
                        UI_BUTTON_DANGER);
     }
@@ -347,8 +352,6 @@ void bottom_draw(void) {
         draw_settings_screen();
     } else if (currentMode == BOTTOM_MODE_ROM_ACTIONS) {
         draw_rom_actions_screen();
-    } else if (currentMode == BOTTOM_MODE_DOWNLOADING) {
-        draw_downloading_screen();
     } else if (currentMode == BOTTOM_MODE_QUEUE) {
         draw_queue_screen();
     } else if (currentMode == BOTTOM_MODE_QUEUE_CONFIRM) {
@@ -383,21 +386,3 @@ void bottom_draw(void) {
         draw_toolbar();
     }
 }
-
-// Called from the download progress callback, which renders its own frames.
-// Safe to call hidScanInput() here because the normal main-loop frame cycle
-// is not running during downloads — the progress callback IS the frame loop.
-bool bottom_check_cancel(void) {
-    hidScanInput();
-    u32 kDown = hidKeysDown();
-
-    if (kDown & KEY_TOUCH) {
-        touchPosition touch;
-        hidTouchRead(&touch);
-        if (ui_touch_in_rect(touch.px, touch.py, BUTTON_X, SAVE_BUTTON_Y_SINGLE, BUTTON_WIDTH, BUTTON_HEIGHT)) {
-            return true;
-        }
-    }
-
-    return false;
-}
@@ -14,7 +14,6 @@ typedef enum {
     BOTTOM_MODE_DEFAULT,
     BOTTOM_MODE_SETTINGS,
     BOTTOM_MODE_ROM_ACTIONS,
-    BOTTOM_MODE_DOWNLOADING,
     BOTTOM_MODE_QUEUE,
     BOTTOM_MODE_QUEUE_CONFIRM,
     BOTTOM_MODE_SEARCH_FORM,
@@ -36,6 +35,7 @@ typedef enum {
     BOTTOM_ACTION_SEARCH_FIELD,
     BOTTOM_ACTION_SEARCH_EXECUTE,
     BOTTOM_ACTION_START_DOWNLOADS,
+    BOTTOM_ACTION_CANCEL_DOWNLOADS,
     BOTTOM_ACTION_CLEAR_QUEUE,
     BOTTOM_ACTION_CANCEL_CLEAR,
     BOTTOM_ACTION_SELECT_FOLDER,
@@ -62,6 +62,9 @@ void bottom_set_rom_queued(bool queued);
 // Set queue count (for showing/hiding clear button)
 void bottom_set_queue_count(int count);
 
+// Set whether the download worker has jobs (queue screen offers Cancel instead of Start)
+void bottom_set_downloads_active(bool active);
+
 // Set the currently highlighted folder name (for folder browser mode)
 void bottom_set_folder_name(const char *name);
 
@@ -72,8 +75,4 @@ BottomAction bottom_update(void);
 // Draw bottom screen
 void bottom_draw(void);
 
-// Check if user wants to cancel a download (polls input, no full update)
-// Returns true if cancel was requested
-bool bottom_check_cancel(void);
-
 #endif // BOTTOM_H
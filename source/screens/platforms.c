@@ -62,5 +62,5 @@ void platforms_draw(void) {
         listnav_draw_scroll_indicator(&nav);
     }
 
-    ui_draw_text(UI_PADDING, SCREEN_TOP_HEIGHT - UI_LINE_HEIGHT - UI_PADDING, "A: Select", UI_COLOR_TEXT_DIM);
+    ui_draw_text(UI_PADDING, ui_hint_y(), "A: Select", UI_COLOR_TEXT_DIM);
 }
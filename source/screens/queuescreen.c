@@ -10,6 +10,8 @@
 #include <string.h>
 
 static ListNav nav;
+static int order[QUEUE_MAX_ENTRIES]; // Row -> queue index
+static DownloadStatus downloads;
 
 void queue_screen_init(void) {
     nav.selectedIndex = 0;
@@ -21,10 +23,16 @@ QueueResult queue_screen_update(u32 kDown) {
         return QUEUE_BACK;
     }
 
-    nav.count = queue_count();
+    nav.count = queue_schedule(order);
     nav.total = nav.count;
     if (nav.count == 0) return QUEUE_NONE;
 
+    if (kDown & KEY_Y) {
+        queue_set_order((queue_get_order() + 1) % QUEUE_ORDER_COUNT);
+        nav.count = queue_schedule(order);
+        return QUEUE_REORDERED;
+    }
+
     // Clamp selection if queue shrank
     if (nav.selectedIndex >= nav.count) {
         nav.selectedIndex = nav.count - 1;
@@ -41,17 +49,70 @@ QueueResult queue_screen_update(u32 kDown) {
 }
 
 int queue_screen_get_selected_index(void) {
-    return nav.selectedIndex;
+    if (nav.selectedIndex < 0 || nav.selectedIndex >= nav.count) return -1;
+    return order[nav.selectedIndex];
+}
+
+void queue_screen_set_status(const DownloadStatus *status) {
+    downloads = *status;
+}
+
+// Bytes the running jobs have already fetched for pending entries. A job being extracted has fetched everything.
+static uint64_t transferred_bytes(void) {
+    uint64_t done = 0;
+    for (int j = 0; j < downloads.active; j++) {
+        const DownloadJobStatus *job = &downloads.jobs[j];
+        for (int i = 0; i < queue_count(); i++) {
+            QueueEntry *entry = queue_get(i);
+            if (entry->romId != job->romId || entry->state != QUEUE_ENTRY_PENDING) continue;
+            uint64_t fetched = job->state == DOWNLOAD_STATE_EXTRACTING ? entry->sizeBytes : job->current;
+            done += fetched < entry->sizeBytes ? fetched : entry->sizeBytes;
+            break;
+        }
+    }
+    return done;
+}
+
+// Header line: entry count, size still to download and, once a download has been measured, the ETA
+static void format_summary(char *out, size_t outSize) {
+    int unknown;
+    uint64_t total = queue_total_bytes(&unknown);
+    uint64_t done = transferred_bytes();
+    total = total > done ? total - done : 0;
+    int len = snprintf(out, outSize, "Queue (%d) \xC2\xB7 ", nav.count);
+    if (total >= 1024ULL * 1024 * 1024) {
+        len += snprintf(out + len, outSize - len, "%.2f GB", total / (1024.0 * 1024.0 * 1024.0));
+    } else {
+        len += snprintf(out + len, outSize - len, "%.1f MB", total / (1024.0 * 1024.0));
+    }
+    if (unknown > 0) len += snprintf(out + len, outSize - len, " + %d unknown", unknown);
+    if (downloads.averageBytesPerSecond == 0 || total == 0) return;
+
+    uint64_t seconds = total / downloads.averageBytesPerSecond;
+    if (seconds >= 3600) {
+        snprintf(out + len, outSize - len, " \xC2\xB7 ETA %lluh %02llum", (unsigned long long)(seconds / 3600),
+                 (unsigned long long)(seconds % 3600 / 60));
+    } else {
+        snprintf(out + len, outSize - len, " \xC2\xB7 ETA %llum %02llus", (unsigned long long)(seconds / 60),
+                 (unsigned long long)(seconds % 60));
+    }
 }
 
 void queue_screen_draw(void) {
-    ui_draw_header("Download Queue");
+    nav.count = queue_schedule(order);
+    if (nav.count == 0) {
+        ui_draw_header("Download Queue");
+    } else {
+        char header[128];
+        format_summary(header, sizeof(header));
+        ui_draw_header(header);
+    }
 
     if (nav.count == 0) {
         const char *emptyMsg = "No ROMs queued";
         float emptyWidth = ui_get_text_width(emptyMsg);
         ui_draw_text((SCREEN_TOP_WIDTH - emptyWidth) / 2, SCREEN_TOP_HEIGHT / 2, emptyMsg, UI_COLOR_TEXT_DIM);
-        ui_draw_text(UI_PADDING, SCREEN_TOP_HEIGHT - UI_LINE_HEIGHT - UI_PADDING, "B: Back", UI_COLOR_TEXT_DIM);
+        ui_draw_text(UI_PADDING, ui_hint_y(), "B: Back", UI_COLOR_TEXT_DIM);
         return;
     }
 
@@ -62,7 +123,7 @@ void queue_screen_draw(void) {
     listnav_visible_range(&nav, &start, &end);
 
     for (int i = start; i < end; i++) {
-        QueueEntry *entry = queue_get(i);
+        QueueEntry *entry = queue_get(order[i]);
         if (!entry) continue;
 
         char displayText[384];
@@ -70,13 +131,24 @@ void queue_screen_draw(void) {
 
         bool selected = (i == nav.selectedIndex);
 
-        if (entry->failed) {
+        if (entry->state != QUEUE_ENTRY_PENDING) {
             if (selected) {
                 ui_draw_rect(UI_PADDING, y, itemWidth, UI_LINE_HEIGHT, UI_COLOR_SELECTED);
             }
+            // Checksum mismatches get their own marker: retrying won't help if the server's copy is bad.
+            // Entries deferred for lack of space are dimmed: freeing space and pressing Start retries them.
+            const char *marker = "X";
+            u32 color = C2D_Color32(0xFF, 0x44, 0x44, 0xFF);
+            if (entry->state == QUEUE_ENTRY_CORRUPT) {
+                marker = "!";
+                color = C2D_Color32(0xFF, 0xAA, 0x22, 0xFF);
+            } else if (entry->state == QUEUE_ENTRY_NO_SPACE) {
+                marker = "~";
+                color = UI_COLOR_TEXT_DIM;
+            }
             char failText[400];
-            snprintf(failText, sizeof(failText), "X %s", displayText);
-            ui_draw_text(UI_PADDING + UI_PADDING, y + 2, failText, C2D_Color32(0xFF, 0x44, 0x44, 0xFF));
+            snprintf(failText, sizeof(failText), "%s %s", marker, displayText);
+            ui_draw_text(UI_PADDING + UI_PADDING, y + 2, failText, color);
         } else {
             ui_draw_list_item(UI_PADDING, y, itemWidth, displayText, selected);
         }
@@ -85,6 +157,8 @@ void queue_screen_draw(void) {
 
     listnav_draw_scroll_indicator(&nav);
 
-    ui_draw_text(UI_PADDING, SCREEN_TOP_HEIGHT - UI_LINE_HEIGHT - UI_PADDING,
-                 "A: Details \xC2\xB7 B: Back \xC2\xB7 L/R: Page", UI_COLOR_TEXT_DIM);
+    char footer[128];
+    snprintf(footer, sizeof(footer), "A: Details \xC2\xB7 B: Back \xC2\xB7 Y: %s \xC2\xB7 L/R: Page",
+             queue_order_label(queue_get_order()));
+    ui_draw_text(UI_PADDING, ui_hint_y(), footer, UI_COLOR_TEXT_DIM);
 }
@@ -7,8 +7,9 @@
 
 #include <3ds.h>
 #include "../queue.h"
+#include "../downloader.h"
 
-typedef enum { QUEUE_NONE, QUEUE_BACK, QUEUE_SELECTED } QueueResult;
+typedef enum { QUEUE_NONE, QUEUE_BACK, QUEUE_SELECTED, QUEUE_REORDERED } QueueResult;
 
 // Initialize queue screen
 void queue_screen_init(void);
@@ -16,9 +17,12 @@ void queue_screen_init(void);
 // Update queue screen, returns result
 QueueResult queue_screen_update(u32 kDown);
 
-// Get current selected index
+// Get the queue index of the selected entry (rows are shown in download order)
 int queue_screen_get_selected_index(void);
 
+// Set the downloader snapshot used for the remaining size and the ETA (no measured rate hides the ETA)
+void queue_screen_set_status(const DownloadStatus *status);
+
 // Draw queue screen on top screen
 void queue_screen_draw(void);
 
@@ -74,11 +74,11 @@ void romdetail_draw(void) {
         ui_draw_text(UI_PADDING, y, "Description:", UI_COLOR_TEXT_DIM);
         y += UI_LINE_HEIGHT;
 
-        int maxDescLines = (SCREEN_TOP_HEIGHT - y - UI_LINE_HEIGHT - UI_PADDING * 2) / UI_LINE_HEIGHT;
+        int maxDescLines = (ui_hint_y() - UI_PADDING - y) / UI_LINE_HEIGHT;
         ui_draw_wrapped_text(UI_PADDING, y, contentWidth, currentDetail->summary, UI_COLOR_TEXT, maxDescLines,
                              scrollOffset);
     }
 
     // Help text
-    ui_draw_text(UI_PADDING, SCREEN_TOP_HEIGHT - UI_LINE_HEIGHT - UI_PADDING, "B: Back", UI_COLOR_TEXT_DIM);
+    ui_draw_text(UI_PADDING, ui_hint_y(), "B: Back", UI_COLOR_TEXT_DIM);
 }
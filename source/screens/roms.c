@@ -109,8 +109,7 @@ void roms_draw(void) {
 
     if (!romList || nav.count == 0) {
         ui_draw_text(UI_PADDING, SCREEN_TOP_HEIGHT / 2, "No ROMs found for this platform.", UI_COLOR_TEXT_DIM);
-        ui_draw_text(UI_PADDING, SCREEN_TOP_HEIGHT - UI_LINE_HEIGHT - UI_PADDING, "B: Back to Platforms",
-                     UI_COLOR_TEXT_DIM);
+        ui_draw_text(UI_PADDING, ui_hint_y(), "B: Back to Platforms", UI_COLOR_TEXT_DIM);
         return;
     }
 
@@ -135,6 +134,5 @@ void roms_draw(void) {
 
     listnav_draw_scroll_indicator(&nav);
 
-    ui_draw_text(UI_PADDING, SCREEN_TOP_HEIGHT - UI_LINE_HEIGHT - UI_PADDING,
-                 "A: Details \xC2\xB7 B: Back \xC2\xB7 L/R: Page", UI_COLOR_TEXT_DIM);
+    ui_draw_text(UI_PADDING, ui_hint_y(), "A: Details \xC2\xB7 B: Back \xC2\xB7 L/R: Page", UI_COLOR_TEXT_DIM);
 }
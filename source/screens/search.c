@@ -294,8 +294,7 @@ void search_results_draw(void) {
         const char *msg = "No matching ROMs found";
         float msgW = ui_get_text_width(msg);
         ui_draw_text((SCREEN_TOP_WIDTH - msgW) / 2, SCREEN_TOP_HEIGHT / 2 - UI_LINE_HEIGHT / 2, msg, UI_COLOR_TEXT_DIM);
-        ui_draw_text(UI_PADDING, SCREEN_TOP_HEIGHT - UI_LINE_HEIGHT - UI_PADDING, "B: Back to Search",
-                     UI_COLOR_TEXT_DIM);
+        ui_draw_text(UI_PADDING, ui_hint_y(), "B: Back to Search", UI_COLOR_TEXT_DIM);
         return;
     }
 
@@ -323,6 +322,5 @@ void search_results_draw(void) {
 
     listnav_draw_scroll_indicator(&nav);
 
-    ui_draw_text(UI_PADDING, SCREEN_TOP_HEIGHT - UI_LINE_HEIGHT - UI_PADDING,
-                 "A: Details \xC2\xB7 B: Back \xC2\xB7 L/R: Page", UI_COLOR_TEXT_DIM);
+    ui_draw_text(UI_PADDING, ui_hint_y(), "A: Details \xC2\xB7 B: Back \xC2\xB7 L/R: Page", UI_COLOR_TEXT_DIM);
 }
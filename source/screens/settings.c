@@ -160,7 +160,7 @@ void settings_draw(void) {
     if (FIELD_COUNT > SETTINGS_VISIBLE_FIELDS) {
         float scrollbarX = SCREEN_TOP_WIDTH - 6;
         float scrollbarY = UI_HEADER_HEIGHT + UI_PADDING;
-        float scrollbarHeight = SCREEN_TOP_HEIGHT - UI_HEADER_HEIGHT - UI_LINE_HEIGHT - (UI_PADDING * 3);
+        float scrollbarHeight = ui_hint_y() - UI_PADDING - scrollbarY;
 
         // Track (thin line)
         ui_draw_rect(scrollbarX, scrollbarY, 4, scrollbarHeight, UI_COLOR_SCROLLBAR_TRACK);
@@ -174,6 +174,5 @@ void settings_draw(void) {
     }
 
     // Help text at bottom
-    ui_draw_text(UI_PADDING, SCREEN_TOP_HEIGHT - UI_LINE_HEIGHT - UI_PADDING, "A: Select \xC2\xB7 B: Cancel",
-                 UI_COLOR_TEXT_DIM);
+    ui_draw_text(UI_PADDING, ui_hint_y(), "A: Select \xC2\xB7 B: Cancel", UI_COLOR_TEXT_DIM);
 }
@@ -0,0 +1,78 @@
+/*
+ * Storage module - Free space checks and preallocation for SD card writes
+ */
+
+#include "storage.h"
+#include "log.h"
+#include "thread.h"
+#include <stdio.h>
+#include <string.h>
+#include <sys/statvfs.h>
+
+#define STORAGE_PATH_LEN 1024
+
+static ThreadMutex lock;
+static uint64_t reservedBytes; // Claimed by writers that haven't finished
+
+void storage_init(void) {
+    thread_mutex_init(&lock);
+    reservedBytes = 0;
+}
+
+bool storage_free_bytes(const char *path, uint64_t *out) {
+    // The destination usually doesn't exist yet; walk up to the nearest directory that does
+    char dir[STORAGE_PATH_LEN];
+    snprintf(dir, sizeof(dir), "%s", path);
+    struct statvfs fs;
+    while (statvfs(dir, &fs) != 0) {
+        char *lastSlash = strrchr(dir, '/');
+        if (!lastSlash || lastSlash == dir) return false;
+        *lastSlash = '\0';
+    }
+    *out = (uint64_t)fs.f_bavail * fs.f_frsize;
+    return true;
+}
+
+// Free space less the headroom and existing claims. Caller holds lock.
+static bool available_locked(const char *path, uint64_t *out) {
+    uint64_t freeBytes;
+    if (!storage_free_bytes(path, &freeBytes)) return false;
+    uint64_t unusable = STORAGE_HEADROOM + reservedBytes;
+    *out = freeBytes > unusable ? freeBytes - unusable : 0;
+    return true;
+}
+
+bool storage_available(const char *path, uint64_t *out) {
+    thread_mutex_lock(&lock);
+    bool ok = available_locked(path, out);
+    thread_mutex_unlock(&lock);
+    return ok;
+}
+
+bool storage_reserve(const char *path, uint64_t bytes) {
+    thread_mutex_lock(&lock);
+    uint64_t available;
+    bool known = available_locked(path, &available);
+    bool fits = !known || bytes <= available;
+    if (fits) reservedBytes += bytes;
+    thread_mutex_unlock(&lock);
+
+    if (!fits) {
+        log_error("Not enough free space for %s: need %.1f MB, %.1f MB available", path, bytes / (1024.0 * 1024.0),
+                  available / (1024.0 * 1024.0));
+    }
+    return fits;
+}
+
+void storage_release(uint64_t bytes) {
+    thread_mutex_lock(&lock);
+    reservedBytes = bytes < reservedBytes ? reservedBytes - bytes : 0;
+    thread_mutex_unlock(&lock);
+}
+
+bool storage_preallocate(FileSink *sink, uint64_t size) {
+    if (size == 0) return true;
+    bool ok = filesink_set_size(sink, size);
+    if (!ok) log_warn("Failed to preallocate %llu bytes", (unsigned long long)size);
+    return ok;
+}
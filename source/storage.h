@@ -0,0 +1,40 @@
+/*
+ * Storage module - Free space checks and preallocation for SD card writes
+ *
+ * Writers claim the bytes they are about to write before starting, so a
+ * transfer that cannot fit is refused up front instead of failing in fwrite
+ * hundreds of MB in. Claims are counted against one filesystem: everything
+ * the app writes lives on sdmc. Files whose size is known are grown to it
+ * before the first write, so FAT allocates them in one run.
+ */
+
+#ifndef STORAGE_H
+#define STORAGE_H
+
+#include "filesink.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#define STORAGE_HEADROOM (4 * 1024 * 1024) // Left free for FAT metadata, cluster slack, config and queue files
+
+void storage_init(void);
+
+// Free bytes on the filesystem holding path. Returns false if it can't be queried.
+bool storage_free_bytes(const char *path, uint64_t *out);
+
+// Bytes a new write could use: free space less the headroom and what other writers have claimed.
+// Returns false if free space can't be queried.
+bool storage_available(const char *path, uint64_t *out);
+
+// Claim bytes for a write about to start. Returns false (and logs) if they don't fit.
+// Free space that can't be queried doesn't block the write. Every success must be released.
+bool storage_reserve(const char *path, uint64_t bytes);
+
+// Give back a claim once its write has finished or failed
+void storage_release(uint64_t bytes);
+
+// Grow a newly opened file to its final size before writing it, so the filesystem allocates its clusters
+// in one contiguous run instead of extending the chain write by write. The position is left unchanged.
+bool storage_preallocate(FileSink *sink, uint64_t size);
+
+#endif // STORAGE_H
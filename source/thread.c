@@ -0,0 +1,175 @@
+/*
+ * Thread module - Minimal threads, locks and condition variables
+ */
+
+#include "thread.h"
+#include "log.h"
+#include <stdlib.h>
+#include <time.h>
+#include <errno.h>
+#ifndef __3DS__
+#include <limits.h>
+#endif
+
+#ifdef __3DS__
+
+struct ThreadHandle {
+    Thread thread;
+    ThreadEntry entry;
+    void *arg;
+};
+
+static void thread_trampoline(void *arg) {
+    ThreadHandle *handle = arg;
+    handle->entry(handle->arg);
+}
+
+ThreadHandle *thread_start(ThreadEntry entry, void *arg, size_t stackSize) {
+    ThreadHandle *handle = calloc(1, sizeof(ThreadHandle));
+    if (!handle) return NULL;
+    handle->entry = entry;
+    handle->arg = arg;
+
+    s32 priority = 0x30;
+    svcGetThreadPriority(&priority, CUR_THREAD_HANDLE);
+    if (priority < 0x3F) priority++;
+
+    handle->thread = threadCreate(thread_trampoline, handle, stackSize, priority, -2, false);
+    if (!handle->thread) {
+        log_error("threadCreate failed");
+        free(handle);
+        return NULL;
+    }
+    return handle;
+}
+
+void thread_join(ThreadHandle *thread) {
+    if (!thread) return;
+    threadJoin(thread->thread, U64_MAX);
+    threadFree(thread->thread);
+    free(thread);
+}
+
+void thread_sleep_ms(uint32_t ms) {
+    svcSleepThread((s64)ms * 1000000LL);
+}
+
+void thread_mutex_init(ThreadMutex *mutex) {
+    LightLock_Init(mutex);
+}
+
+void thread_mutex_lock(ThreadMutex *mutex) {
+    LightLock_Lock(mutex);
+}
+
+void thread_mutex_unlock(ThreadMutex *mutex) {
+    LightLock_Unlock(mutex);
+}
+
+void thread_cond_init(ThreadCond *cond) {
+    CondVar_Init(cond);
+}
+
+void thread_cond_wait(ThreadCond *cond, ThreadMutex *mutex) {
+    CondVar_Wait(cond, mutex);
+}
+
+bool thread_cond_wait_ms(ThreadCond *cond, ThreadMutex *mutex, uint32_t ms) {
+    return CondVar_WaitTimeout(cond, mutex, (s64)ms * 1000000LL) == 0;
+}
+
+void thread_cond_signal(ThreadCond *cond) {
+    CondVar_Signal(cond);
+}
+
+void thread_cond_broadcast(ThreadCond *cond) {
+    CondVar_Broadcast(cond);
+}
+
+#else
+
+struct ThreadHandle {
+    pthread_t thread;
+    ThreadEntry entry;
+    void *arg;
+};
+
+static void *thread_trampoline(void *arg) {
+    ThreadHandle *handle = arg;
+    handle->entry(handle->arg);
+    return NULL;
+}
+
+ThreadHandle *thread_start(ThreadEntry entry, void *arg, size_t stackSize) {
+    ThreadHandle *handle = calloc(1, sizeof(ThreadHandle));
+    if (!handle) return NULL;
+    handle->entry = entry;
+    handle->arg = arg;
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    if (stackSize < PTHREAD_STACK_MIN) stackSize = PTHREAD_STACK_MIN;
+    pthread_attr_setstacksize(&attr, stackSize);
+    int err = pthread_create(&handle->thread, &attr, thread_trampoline, handle);
+    pthread_attr_destroy(&attr);
+    if (err != 0) {
+        log_error("pthread_create failed: %d", err);
+        free(handle);
+        return NULL;
+    }
+    return handle;
+}
+
+void thread_join(ThreadHandle *thread) {
+    if (!thread) return;
+    pthread_join(thread->thread, NULL);
+    free(thread);
+}
+
+void thread_sleep_ms(uint32_t ms) {
+    struct timespec ts = {ms / 1000, (long)(ms % 1000) * 1000000L};
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {
+    }
+}
+
+void thread_mutex_init(ThreadMutex *mutex) {
+    pthread_mutex_init(mutex, NULL);
+}
+
+void thread_mutex_lock(ThreadMutex *mutex) {
+    pthread_mutex_lock(mutex);
+}
+
+void thread_mutex_unlock(ThreadMutex *mutex) {
+    pthread_mutex_unlock(mutex);
+}
+
+void thread_cond_init(ThreadCond *cond) {
+    pthread_cond_init(cond, NULL);
+}
+
+void thread_cond_wait(ThreadCond *cond, ThreadMutex *mutex) {
+    pthread_cond_wait(cond, mutex);
+}
+
+bool thread_cond_wait_ms(ThreadCond *cond, ThreadMutex *mutex, uint32_t ms) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ts.tv_sec += ms / 1000;
+    ts.tv_nsec += (long)(ms % 1000) * 1000000L;
+    if (ts.tv_nsec >= 1000000000L) {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000L;
+    }
+    return pthread_cond_timedwait(cond, mutex, &ts) == 0;
+}
+
+void thread_cond_signal(ThreadCond *cond) {
+    pthread_cond_signal(cond);
+}
+
+void thread_cond_broadcast(ThreadCond *cond) {
+    pthread_cond_broadcast(cond);
+}
+
+#endif
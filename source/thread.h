@@ -0,0 +1,54 @@
+/*
+ * Thread module - Minimal threads, locks and condition variables
+ *
+ * Wraps libctru threads and light locks on the 3DS and pthreads elsewhere,
+ * so network workers can also run in the host build.
+ */
+
+#ifndef THREAD_H
+#define THREAD_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#ifdef __3DS__
+#include <3ds.h>
+#else
+#include <pthread.h>
+#endif
+
+#define THREAD_DEFAULT_STACK_SIZE (32 * 1024)
+
+typedef struct ThreadHandle ThreadHandle;
+typedef void (*ThreadEntry)(void *arg);
+
+#ifdef __3DS__
+typedef LightLock ThreadMutex;
+typedef CondVar ThreadCond;
+#else
+typedef pthread_mutex_t ThreadMutex;
+typedef pthread_cond_t ThreadCond;
+#endif
+
+// Start a thread running entry(arg), at a slightly lower priority than the caller.
+// Returns NULL on failure.
+ThreadHandle *thread_start(ThreadEntry entry, void *arg, size_t stackSize);
+
+// Wait for a thread to finish and release it
+void thread_join(ThreadHandle *thread);
+
+// Sleep the calling thread
+void thread_sleep_ms(uint32_t ms);
+
+void thread_mutex_init(ThreadMutex *mutex);
+void thread_mutex_lock(ThreadMutex *mutex);
+void thread_mutex_unlock(ThreadMutex *mutex);
+
+void thread_cond_init(ThreadCond *cond);
+void thread_cond_wait(ThreadCond *cond, ThreadMutex *mutex);
+// Returns false if the timeout expired before a signal
+bool thread_cond_wait_ms(ThreadCond *cond, ThreadMutex *mutex, uint32_t ms);
+void thread_cond_signal(ThreadCond *cond);
+void thread_cond_broadcast(ThreadCond *cond);
+
+#endif // THREAD_H
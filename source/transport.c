@@ -0,0 +1,171 @@
+/*
+ * Transport module - Pluggable HTTP backend used by the API layer
+ */
+
+#include "transport.h"
+#include "log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#ifdef __3DS__
+#include <3ds.h>
+#endif
+
+struct TransportRequest {
+    const TransportBackend *backend;
+    void *handle;
+    uint64_t startMs;
+    uint64_t bytesRead;
+};
+
+#if defined(HTTP_BACKEND_CURL)
+static const TransportBackend *activeBackend = &transport_curl_backend;
+#elif defined(HTTP_BACKEND_SOCKET) || !defined(__3DS__)
+static const TransportBackend *activeBackend = &transport_socket_backend;
+#else
+static const TransportBackend *activeBackend = &transport_httpc_backend;
+#endif
+
+static bool initialized = false;
+static uint32_t connectTimeoutMs = TRANSPORT_DEFAULT_CONNECT_TIMEOUT_MS;
+static uint32_t responseTimeoutMs = TRANSPORT_DEFAULT_RESPONSE_TIMEOUT_MS;
+
+bool transport_init(void) {
+    if (initialized) return true;
+    if (activeBackend->init && !activeBackend->init()) {
+        log_error("Failed to initialize %s transport", activeBackend->name);
+        return false;
+    }
+    initialized = true;
+    log_debug("Using %s transport", activeBackend->name);
+    return true;
+}
+
+void transport_exit(void) {
+    if (!initialized) return;
+    if (activeBackend->exit) activeBackend->exit();
+    initialized = false;
+}
+
+void transport_set_backend(const TransportBackend *backend) {
+    if (backend) activeBackend = backend;
+}
+
+const TransportBackend *transport_get_backend(void) {
+    return activeBackend;
+}
+
+void transport_set_timeouts(uint32_t connectMs, uint32_t responseMs) {
+    connectTimeoutMs = connectMs;
+    responseTimeoutMs = responseMs;
+}
+
+uint32_t transport_connect_timeout_ms(void) {
+    return connectTimeoutMs;
+}
+
+uint32_t transport_response_timeout_ms(void) {
+    return responseTimeoutMs;
+}
+
+TransportRequest *transport_open(TransportMethod method, const char *url) {
+    TransportRequest *req = calloc(1, sizeof(TransportRequest));
+    if (!req) return NULL;
+
+    req->backend = activeBackend;
+    req->startMs = transport_now_ms();
+    req->handle = req->backend->open(method, url);
+    if (!req->handle) {
+        free(req);
+        return NULL;
+    }
+    return req;
+}
+
+bool transport_add_header(TransportRequest *req, const char *name, const char *value) {
+    return req->backend->add_header(req->handle, name, value);
+}
+
+bool transport_set_body(TransportRequest *req, const void *data, size_t len) {
+    return req->backend->set_body(req->handle, data, len);
+}
+
+bool transport_begin(TransportRequest *req) {
+    return req->backend->begin(req->handle);
+}
+
+bool transport_unreachable(TransportRequest *req) {
+    return req->backend->unreachable(req->handle);
+}
+
+bool transport_get_status(TransportRequest *req, int *status) {
+    return req->backend->get_status(req->handle, status);
+}
+
+bool transport_get_header(TransportRequest *req, const char *name, char *value, size_t valueSize) {
+    if (valueSize > 0) value[0] = '\0';
+    return req->backend->get_header(req->handle, name, value, valueSize);
+}
+
+uint32_t transport_get_content_length(TransportRequest *req) {
+    return req->backend->get_content_length(req->handle);
+}
+
+TransportReadResult transport_read(TransportRequest *req, void *buffer, size_t size, size_t *bytesRead) {
+    *bytesRead = 0;
+    TransportReadResult result = req->backend->read(req->handle, buffer, size, bytesRead);
+    req->bytesRead += *bytesRead;
+    return result;
+}
+
+void transport_abort(TransportRequest *req) {
+    req->backend->abort(req->handle);
+}
+
+void transport_close(TransportRequest *req) {
+    if (!req) return;
+    req->backend->close(req->handle);
+    log_debug("%s: %llu bytes in %llu ms", req->backend->name, (unsigned long long)req->bytesRead,
+              (unsigned long long)(transport_now_ms() - req->startMs));
+    free(req);
+}
+
+uint64_t transport_now_ms(void) {
+#ifdef __3DS__
+    return svcGetSystemTick() / (SYSCLOCK_ARM11 / 1000);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+#endif
+}
+
+uint64_t transport_now_us(void) {
+#ifdef __3DS__
+    return svcGetSystemTick() / (SYSCLOCK_ARM11 / 1000000);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#endif
+}
+
+bool transport_find_header(const char *headers, const char *name, char *value, size_t valueSize) {
+    size_t nameLen = strlen(name);
+    for (const char *line = headers; *line;) {
+        const char *end = strchr(line, '\n');
+        if (!end) break;
+        if (strncasecmp(line, name, nameLen) == 0 && line[nameLen] == ':') {
+            const char *v = line + nameLen + 1;
+            while (*v == ' ') v++;
+            const char *vEnd = end;
+            while (vEnd > v && (vEnd[-1] == '\r' || vEnd[-1] == ' ')) vEnd--;
+            snprintf(value, valueSize, "%.*s", (int)(vEnd - v), v);
+            return true;
+        }
+        line = end + 1;
+    }
+    return false;
+}
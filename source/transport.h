@@ -0,0 +1,120 @@
+/*
+ * Transport module - Pluggable HTTP backend used by the API layer
+ */
+
+#ifndef TRANSPORT_H
+#define TRANSPORT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define TRANSPORT_DEFAULT_CONNECT_TIMEOUT_MS 5000
+#define TRANSPORT_DEFAULT_RESPONSE_TIMEOUT_MS 15000
+
+// Request methods supported by the transport
+typedef enum { TRANSPORT_METHOD_GET, TRANSPORT_METHOD_HEAD, TRANSPORT_METHOD_POST } TransportMethod;
+
+// Result of a single body read
+typedef enum {
+    TRANSPORT_READ_MORE,  // Data may have been read, more is pending
+    TRANSPORT_READ_DONE,  // Body complete (bytesRead may still be > 0)
+    TRANSPORT_READ_ERROR, // Connection or protocol error
+} TransportReadResult;
+
+// Backend implementation. Each backend hands out its own opaque handle per request;
+// the transport module wraps it so callers never see backend types.
+typedef struct {
+    const char *name;
+    bool (*init)(void);
+    void (*exit)(void);
+    void *(*open)(TransportMethod method, const char *url);
+    bool (*add_header)(void *handle, const char *name, const char *value);
+    bool (*set_body)(void *handle, const void *data, size_t len); // POST only; the backend keeps its own copy
+    bool (*begin)(void *handle);
+    bool (*unreachable)(void *handle); // After a failed begin: no connection, or no response in time
+    bool (*get_status)(void *handle, int *status);
+    bool (*get_header)(void *handle, const char *name, char *value, size_t valueSize);
+    uint32_t (*get_content_length)(void *handle);
+    TransportReadResult (*read)(void *handle, void *buffer, size_t size, size_t *bytesRead);
+    void (*close)(void *handle);
+    void (*abort)(void *handle); // Called from another thread: make the current or next read fail promptly
+} TransportBackend;
+
+// Built-in backends (availability depends on the build, see Makefile HTTP_BACKEND)
+extern const TransportBackend transport_httpc_backend;  // 3DS only
+extern const TransportBackend transport_socket_backend; // Always available
+extern const TransportBackend transport_curl_backend;   // HTTP_BACKEND_CURL builds only
+
+// An in-flight request
+typedef struct TransportRequest TransportRequest;
+
+// Initialize the build's default backend (call once at startup)
+bool transport_init(void);
+
+// Shut down the active backend
+void transport_exit(void);
+
+// Replace the active backend. Must be called before transport_init() or after transport_exit().
+void transport_set_backend(const TransportBackend *backend);
+
+// Get the active backend
+const TransportBackend *transport_get_backend(void);
+
+// Fail transport_begin() when connecting takes longer than connectMs, or the response headers take longer
+// than responseMs after that (0 = wait as long as the backend does). Body reads are left to the watchdog.
+void transport_set_timeouts(uint32_t connectMs, uint32_t responseMs);
+uint32_t transport_connect_timeout_ms(void);
+uint32_t transport_response_timeout_ms(void);
+
+// Open a request. Returns NULL on failure.
+TransportRequest *transport_open(TransportMethod method, const char *url);
+
+// Add a request header (before transport_begin)
+bool transport_add_header(TransportRequest *req, const char *name, const char *value);
+
+// Attach a request body to a POST (before transport_begin). Content-Type is left to the caller.
+bool transport_set_body(TransportRequest *req, const void *data, size_t len);
+
+// Send the request and wait for the response headers
+bool transport_begin(TransportRequest *req);
+
+// After transport_begin() failed: true if the server couldn't be connected to or didn't answer in time, false
+// if it was there but the exchange failed (connection dropped, malformed response)
+bool transport_unreachable(TransportRequest *req);
+
+// Get the HTTP status code of the response
+bool transport_get_status(TransportRequest *req, int *status);
+
+// Get a response header value. Returns false if the header is missing.
+bool transport_get_header(TransportRequest *req, const char *name, char *value, size_t valueSize);
+
+// Get Content-Length of the response (0 if unknown)
+uint32_t transport_get_content_length(TransportRequest *req);
+
+// Read the next chunk of the response body
+TransportReadResult transport_read(TransportRequest *req, void *buffer, size_t size, size_t *bytesRead);
+
+// Make a read blocked on another thread, or the next one, fail with TRANSPORT_READ_ERROR. The request
+// must still be closed by its owner.
+void transport_abort(TransportRequest *req);
+
+// Close the request and free it. Logs body size and elapsed time at debug level.
+void transport_close(TransportRequest *req);
+
+// Monotonic clock in milliseconds, for timing requests
+uint64_t transport_now_ms(void);
+
+// Monotonic clock in microseconds, for timing work done per chunk
+uint64_t transport_now_us(void);
+
+// Backend helpers
+
+// Bring up / tear down the socket service (soc:u on the 3DS, no-op elsewhere)
+bool transport_socket_service_init(void);
+void transport_socket_service_exit(void);
+
+// Look up a header in a raw "Name: value\n" block. Returns false if missing.
+bool transport_find_header(const char *headers, const char *name, char *value, size_t valueSize);
+
+#endif // TRANSPORT_H
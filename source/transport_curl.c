@@ -0,0 +1,398 @@
+/*
+ * Transport backend - libcurl with persistent connections
+ *
+ * Keeps a small pool of easy handles per host so consecutive requests to the
+ * RomM server reuse the same keep-alive connection. A share handle caches DNS
+ * lookups and TLS sessions across all pooled handles, so even a fresh
+ * connection skips the full TLS handshake. The pool and share handle are
+ * locked, so requests may run on several threads at once.
+ */
+
+#ifdef HTTP_BACKEND_CURL
+
+#include "transport.h"
+#include "log.h"
+#include "thread.h"
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <curl/curl.h>
+
+#define CURL_POOL_SIZE 4
+#define CURL_HEADERS_SIZE 8192
+#define CURL_BUFFER_SIZE (CURL_MAX_WRITE_SIZE * 4)
+#define CURL_DNS_CACHE_SECONDS 600
+#define CURL_POLL_TIMEOUT_MS 1000
+
+// An idle easy handle (with its own multi) waiting to be reused for the same host
+typedef struct {
+    CURL *easy;
+    CURLM *multi;
+    char host[256];
+} PooledHandle;
+
+typedef struct {
+    CURL *easy;
+    CURLM *multi;
+    char host[256];
+    struct curl_slist *headers;
+
+    char responseHeaders[CURL_HEADERS_SIZE];
+    size_t responseHeadersLen;
+    int headerStatus;
+    bool headersDone;
+
+    // Body bytes handed over by libcurl but not yet read by the caller
+    char buffer[CURL_BUFFER_SIZE];
+    size_t bufferStart;
+    size_t bufferEnd;
+    bool paused;
+
+    bool added;
+    bool finished;
+    CURLcode result;
+    bool timedOut; // No response headers by the response deadline
+    atomic_bool aborted;
+} CurlRequest;
+
+static CURLSH *share = NULL;
+static PooledHandle pool[CURL_POOL_SIZE];
+static int poolCount = 0;
+static ThreadMutex poolLock;
+static ThreadMutex shareLocks[CURL_LOCK_DATA_LAST];
+
+static void share_lock(CURL *handle, curl_lock_data data, curl_lock_access access, void *userptr) {
+    (void)handle;
+    (void)access;
+    (void)userptr;
+    thread_mutex_lock(&shareLocks[data]);
+}
+
+static void share_unlock(CURL *handle, curl_lock_data data, void *userptr) {
+    (void)handle;
+    (void)userptr;
+    thread_mutex_unlock(&shareLocks[data]);
+}
+
+static bool curl_backend_init(void) {
+    if (!transport_socket_service_init()) return false;
+    if (curl_global_init(CURL_GLOBAL_DEFAULT) != CURLE_OK) {
+        log_error("curl_global_init failed");
+        transport_socket_service_exit();
+        return false;
+    }
+
+    thread_mutex_init(&poolLock);
+    for (int i = 0; i < CURL_LOCK_DATA_LAST; i++) thread_mutex_init(&shareLocks[i]);
+
+    share = curl_share_init();
+    if (share) {
+        curl_share_setopt(share, CURLSHOPT_LOCKFUNC, share_lock);
+        curl_share_setopt(share, CURLSHOPT_UNLOCKFUNC, share_unlock);
+        curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+        curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+        curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+    }
+    poolCount = 0;
+    return true;
+}
+
+static void curl_backend_exit(void) {
+    for (int i = 0; i < poolCount; i++) {
+        curl_easy_cleanup(pool[i].easy);
+        curl_multi_cleanup(pool[i].multi);
+    }
+    poolCount = 0;
+    if (share) curl_share_cleanup(share);
+    share = NULL;
+    curl_global_cleanup();
+    transport_socket_service_exit();
+}
+
+static void extract_host(const char *url, char *host, size_t hostSize) {
+    const char *start = strstr(url, "://");
+    start = start ? start + 3 : url;
+    size_t len = strcspn(start, "/?#");
+    snprintf(host, hostSize, "%.*s", (int)len, start);
+}
+
+// Take an idle handle for this host from the pool, or create a new one
+static bool acquire_handle(CurlRequest *req) {
+    thread_mutex_lock(&poolLock);
+    for (int i = 0; i < poolCount; i++) {
+        if (strcmp(pool[i].host, req->host) == 0) {
+            req->easy = pool[i].easy;
+            req->multi = pool[i].multi;
+            pool[i] = pool[--poolCount];
+            thread_mutex_unlock(&poolLock);
+            curl_easy_reset(req->easy);
+            return true;
+        }
+    }
+    thread_mutex_unlock(&poolLock);
+
+    req->easy = curl_easy_init();
+    req->multi = curl_multi_init();
+    if (!req->easy || !req->multi) {
+        if (req->easy) curl_easy_cleanup(req->easy);
+        if (req->multi) curl_multi_cleanup(req->multi);
+        return false;
+    }
+    return true;
+}
+
+// Return a handle to the pool, evicting the oldest idle handle if full
+static void release_handle(CurlRequest *req) {
+    thread_mutex_lock(&poolLock);
+    if (poolCount == CURL_POOL_SIZE) {
+        curl_easy_cleanup(pool[0].easy);
+        curl_multi_cleanup(pool[0].multi);
+        memmove(&pool[0], &pool[1], sizeof(PooledHandle) * (CURL_POOL_SIZE - 1));
+        poolCount--;
+    }
+    pool[poolCount].easy = req->easy;
+    pool[poolCount].multi = req->multi;
+    snprintf(pool[poolCount].host, sizeof(pool[poolCount].host), "%s", req->host);
+    poolCount++;
+    thread_mutex_unlock(&poolLock);
+}
+
+static size_t header_callback(char *data, size_t size, size_t nmemb, void *userdata) {
+    CurlRequest *req = userdata;
+    size_t len = size * nmemb;
+
+    // A new status line starts a new response (interim 1xx or redirect hop)
+    if (len > 5 && strncmp(data, "HTTP/", 5) == 0) {
+        req->responseHeadersLen = 0;
+        req->responseHeaders[0] = '\0';
+        req->headerStatus = 0;
+        sscanf(data, "HTTP/%*s %d", &req->headerStatus);
+        return len;
+    }
+
+    if (len <= 2 && (data[0] == '\r' || data[0] == '\n')) {
+        if (req->headerStatus >= 200) req->headersDone = true;
+        return len;
+    }
+
+    if (req->responseHeadersLen + len + 1 < sizeof(req->responseHeaders)) {
+        memcpy(req->responseHeaders + req->responseHeadersLen, data, len);
+        req->responseHeadersLen += len;
+        req->responseHeaders[req->responseHeadersLen] = '\0';
+    }
+    return len;
+}
+
+static size_t write_callback(char *data, size_t size, size_t nmemb, void *userdata) {
+    CurlRequest *req = userdata;
+    size_t len = size * nmemb;
+
+    if (req->bufferStart > 0 && req->bufferEnd + len > sizeof(req->buffer)) {
+        memmove(req->buffer, req->buffer + req->bufferStart, req->bufferEnd - req->bufferStart);
+        req->bufferEnd -= req->bufferStart;
+        req->bufferStart = 0;
+    }
+    if (req->bufferEnd + len > sizeof(req->buffer)) {
+        // Caller hasn't caught up; libcurl keeps the data and redelivers it on unpause
+        req->paused = true;
+        return CURL_WRITEFUNC_PAUSE;
+    }
+
+    memcpy(req->buffer + req->bufferEnd, data, len);
+    req->bufferEnd += len;
+    return len;
+}
+
+static void *curl_open(TransportMethod method, const char *url) {
+    CurlRequest *req = calloc(1, sizeof(CurlRequest));
+    if (!req) return NULL;
+
+    extract_host(url, req->host, sizeof(req->host));
+    if (!acquire_handle(req)) {
+        log_error("Failed to create curl handle");
+        free(req);
+        return NULL;
+    }
+
+    CURL *easy = req->easy;
+    curl_easy_setopt(easy, CURLOPT_URL, url);
+    curl_easy_setopt(easy, CURLOPT_HTTPGET, 1L); // Pooled handles may still be set up for a POST
+    curl_easy_setopt(easy, CURLOPT_NOBODY, method == TRANSPORT_METHOD_HEAD ? 1L : 0L);
+    curl_easy_setopt(easy, CURLOPT_SSL_VERIFYPEER, 0L);
+    curl_easy_setopt(easy, CURLOPT_SSL_VERIFYHOST, 0L);
+    curl_easy_setopt(easy, CURLOPT_TCP_KEEPALIVE, 1L);
+    curl_easy_setopt(easy, CURLOPT_DNS_CACHE_TIMEOUT, (long)CURL_DNS_CACHE_SECONDS);
+    curl_easy_setopt(easy, CURLOPT_CONNECTTIMEOUT_MS, (long)transport_connect_timeout_ms()); // 0 = curl's default
+    curl_easy_setopt(easy, CURLOPT_HEADERFUNCTION, header_callback);
+    curl_easy_setopt(easy, CURLOPT_HEADERDATA, req);
+    curl_easy_setopt(easy, CURLOPT_WRITEFUNCTION, write_callback);
+    curl_easy_setopt(easy, CURLOPT_WRITEDATA, req);
+    if (share) curl_easy_setopt(easy, CURLOPT_SHARE, share);
+    return req;
+}
+
+static bool curl_add_header(void *handle, const char *name, const char *value) {
+    CurlRequest *req = handle;
+    char line[1024];
+    snprintf(line, sizeof(line), "%s: %s", name, value);
+    struct curl_slist *headers = curl_slist_append(req->headers, line);
+    if (!headers) return false;
+    req->headers = headers;
+    return true;
+}
+
+static bool curl_set_body(void *handle, const void *data, size_t len) {
+    CurlRequest *req = handle;
+    curl_easy_setopt(req->easy, CURLOPT_POSTFIELDSIZE, (long)len);
+    return curl_easy_setopt(req->easy, CURLOPT_COPYPOSTFIELDS, data) == CURLE_OK;
+}
+
+// Drive the transfer once, waiting up to CURL_POLL_TIMEOUT_MS for socket activity
+static void pump(CurlRequest *req) {
+    int running = 0;
+    curl_multi_perform(req->multi, &running);
+
+    CURLMsg *msg;
+    int queued;
+    while ((msg = curl_multi_info_read(req->multi, &queued))) {
+        if (msg->msg == CURLMSG_DONE && msg->easy_handle == req->easy) {
+            req->finished = true;
+            req->result = msg->data.result;
+        }
+    }
+
+    if (!req->finished && running > 0 && !req->paused) {
+        curl_multi_poll(req->multi, NULL, 0, CURL_POLL_TIMEOUT_MS, NULL);
+    }
+}
+
+static bool curl_begin(void *handle) {
+    CurlRequest *req = handle;
+    curl_easy_setopt(req->easy, CURLOPT_HTTPHEADER, req->headers);
+
+    if (curl_multi_add_handle(req->multi, req->easy) != CURLM_OK) {
+        log_error("curl_multi_add_handle failed");
+        return false;
+    }
+    req->added = true;
+
+    // Connecting is bounded by CURLOPT_CONNECTTIMEOUT_MS; the response timeout starts once the request is sent
+    uint32_t responseTimeoutMs = transport_response_timeout_ms();
+    uint64_t deadlineMs = transport_now_ms() + transport_connect_timeout_ms() + responseTimeoutMs;
+    bool sent = false;
+    while (!req->headersDone && !req->finished) {
+        curl_off_t pretransferUs = 0;
+        if (!sent && curl_easy_getinfo(req->easy, CURLINFO_PRETRANSFER_TIME_T, &pretransferUs) == CURLE_OK &&
+            pretransferUs > 0) {
+            sent = true;
+            uint64_t responseDeadlineMs = transport_now_ms() + responseTimeoutMs;
+            if (responseDeadlineMs < deadlineMs) deadlineMs = responseDeadlineMs;
+        }
+        if (responseTimeoutMs > 0 && transport_now_ms() >= deadlineMs) {
+            log_error("No response from %s within %lu ms", req->host, (unsigned long)responseTimeoutMs);
+            req->timedOut = true;
+            return false;
+        }
+        pump(req);
+        if (req->paused) break;
+    }
+
+    if (req->finished && req->result != CURLE_OK) {
+        log_error("curl request failed: %s", curl_easy_strerror(req->result));
+        return false;
+    }
+
+    long connects = 0;
+    curl_easy_getinfo(req->easy, CURLINFO_NUM_CONNECTS, &connects);
+    log_debug("curl: %s connection to %s", connects > 0 ? "new" : "reused", req->host);
+    return true;
+}
+
+static bool curl_unreachable(void *handle) {
+    CurlRequest *req = handle;
+    if (req->timedOut) return true;
+    if (!req->finished) return false;
+    return req->result == CURLE_COULDNT_RESOLVE_HOST || req->result == CURLE_COULDNT_CONNECT ||
+           req->result == CURLE_OPERATION_TIMEDOUT;
+}
+
+static bool curl_get_status(void *handle, int *status) {
+    CurlRequest *req = handle;
+    long code = 0;
+    if (curl_easy_getinfo(req->easy, CURLINFO_RESPONSE_CODE, &code) != CURLE_OK || code == 0) return false;
+    *status = (int)code;
+    return true;
+}
+
+static bool curl_get_header(void *handle, const char *name, char *value, size_t valueSize) {
+    CurlRequest *req = handle;
+    return transport_find_header(req->responseHeaders, name, value, valueSize);
+}
+
+static uint32_t curl_get_content_length(void *handle) {
+    CurlRequest *req = handle;
+    curl_off_t length = -1;
+    curl_easy_getinfo(req->easy, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &length);
+    return length > 0 ? (uint32_t)length : 0;
+}
+
+static TransportReadResult curl_read(void *handle, void *buffer, size_t size, size_t *bytesRead) {
+    CurlRequest *req = handle;
+
+    while (req->bufferStart == req->bufferEnd && !req->finished) {
+        // Noticed within CURL_POLL_TIMEOUT_MS
+        if (atomic_load(&req->aborted)) return TRANSPORT_READ_ERROR;
+        if (req->paused) {
+            req->paused = false;
+            curl_easy_pause(req->easy, CURLPAUSE_CONT);
+        }
+        pump(req);
+    }
+
+    size_t avail = req->bufferEnd - req->bufferStart;
+    size_t n = avail < size ? avail : size;
+    memcpy(buffer, req->buffer + req->bufferStart, n);
+    req->bufferStart += n;
+    *bytesRead = n;
+
+    if (req->bufferStart < req->bufferEnd || !req->finished) return TRANSPORT_READ_MORE;
+    if (req->result != CURLE_OK) {
+        log_error("curl transfer failed: %s", curl_easy_strerror(req->result));
+        return TRANSPORT_READ_ERROR;
+    }
+    return TRANSPORT_READ_DONE;
+}
+
+static void curl_abort(void *handle) {
+    CurlRequest *req = handle;
+    atomic_store(&req->aborted, true);
+}
+
+static void curl_close(void *handle) {
+    CurlRequest *req = handle;
+    if (req->added) curl_multi_remove_handle(req->multi, req->easy);
+    curl_easy_setopt(req->easy, CURLOPT_HTTPHEADER, NULL);
+    curl_slist_free_all(req->headers);
+    release_handle(req);
+    free(req);
+}
+
+const TransportBackend transport_curl_backend = {
+    .name = "curl",
+    .init = curl_backend_init,
+    .exit = curl_backend_exit,
+    .open = curl_open,
+    .add_header = curl_add_header,
+    .set_body = curl_set_body,
+    .begin = curl_begin,
+    .unreachable = curl_unreachable,
+    .get_status = curl_get_status,
+    .get_header = curl_get_header,
+    .get_content_length = curl_get_content_length,
+    .read = curl_read,
+    .close = curl_close,
+    .abort = curl_abort,
+};
+
+#endif // HTTP_BACKEND_CURL
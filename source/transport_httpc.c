@@ -0,0 +1,158 @@
+/*
+ * Transport backend - libctru httpc service (3DS only)
+ */
+
+#ifdef __3DS__
+
+#include "transport.h"
+#include "log.h"
+#include <stdlib.h>
+#include <3ds.h>
+
+typedef struct {
+    httpcContext context;
+    bool unreachable;
+} HttpcRequest;
+
+static bool httpc_init(void) {
+    Result ret = httpcInit(0);
+    if (R_FAILED(ret)) {
+        log_error("httpcInit failed: %08lX", ret);
+        return false;
+    }
+    return true;
+}
+
+static void httpc_exit(void) {
+    httpcExit();
+}
+
+static void *httpc_open(TransportMethod method, const char *url) {
+    HttpcRequest *req = calloc(1, sizeof(HttpcRequest));
+    if (!req) return NULL;
+
+    HTTPC_RequestMethod httpcMethod = HTTPC_METHOD_GET;
+    if (method == TRANSPORT_METHOD_HEAD) httpcMethod = HTTPC_METHOD_HEAD;
+    if (method == TRANSPORT_METHOD_POST) httpcMethod = HTTPC_METHOD_POST;
+    Result ret = httpcOpenContext(&req->context, httpcMethod, url, 1);
+    if (R_FAILED(ret)) {
+        log_error("httpcOpenContext failed: %08lX", ret);
+        free(req);
+        return NULL;
+    }
+
+    httpcSetSSLOpt(&req->context, SSLCOPT_DisableVerify);
+    httpcSetKeepAlive(&req->context, HTTPC_KEEPALIVE_ENABLED);
+    return req;
+}
+
+static bool httpc_add_header(void *handle, const char *name, const char *value) {
+    HttpcRequest *req = handle;
+    return R_SUCCEEDED(httpcAddRequestHeaderField(&req->context, name, value));
+}
+
+static bool httpc_set_body(void *handle, const void *data, size_t len) {
+    HttpcRequest *req = handle;
+    return R_SUCCEEDED(httpcAddPostDataRaw(&req->context, (const u32 *)data, len));
+}
+
+static bool httpc_begin(void *handle) {
+    HttpcRequest *req = handle;
+    Result ret = httpcBeginRequest(&req->context);
+    if (R_FAILED(ret)) {
+        log_error("httpcBeginRequest failed: %08lX", ret);
+        req->unreachable = true; // httpc reports connect failures here
+        return false;
+    }
+
+    // httpc connects in the background and has no separate connect timeout, so both phases share one wait for
+    // the status line. Later status lookups return at once.
+    if (transport_response_timeout_ms() == 0) return true;
+    uint32_t timeoutMs = transport_connect_timeout_ms() + transport_response_timeout_ms();
+    u32 code = 0;
+    ret = httpcGetResponseStatusCodeTimeout(&req->context, &code, (u64)timeoutMs * 1000000);
+    if (ret == HTTPC_RESULTCODE_TIMEDOUT) {
+        log_error("No response within %lu ms", (unsigned long)timeoutMs);
+        httpcCancelConnection(&req->context);
+        req->unreachable = true;
+        return false;
+    }
+    if (R_FAILED(ret)) {
+        log_error("httpcGetResponseStatusCodeTimeout failed: %08lX", ret);
+        return false;
+    }
+    return true;
+}
+
+static bool httpc_unreachable(void *handle) {
+    HttpcRequest *req = handle;
+    return req->unreachable;
+}
+
+static bool httpc_get_status(void *handle, int *status) {
+    HttpcRequest *req = handle;
+    u32 code = 0;
+    Result ret = httpcGetResponseStatusCode(&req->context, &code);
+    if (R_FAILED(ret)) {
+        log_error("httpcGetResponseStatusCode failed: %08lX", ret);
+        return false;
+    }
+    *status = (int)code;
+    return true;
+}
+
+static bool httpc_get_header(void *handle, const char *name, char *value, size_t valueSize) {
+    HttpcRequest *req = handle;
+    return R_SUCCEEDED(httpcGetResponseHeader(&req->context, name, value, valueSize));
+}
+
+static uint32_t httpc_get_content_length(void *handle) {
+    HttpcRequest *req = handle;
+    u32 contentSize = 0;
+    httpcGetDownloadSizeState(&req->context, NULL, &contentSize);
+    return contentSize;
+}
+
+static TransportReadResult httpc_read(void *handle, void *buffer, size_t size, size_t *bytesRead) {
+    HttpcRequest *req = handle;
+    u32 downloaded = 0;
+    Result ret = httpcDownloadData(&req->context, buffer, size, &downloaded);
+    *bytesRead = downloaded;
+
+    if (ret == HTTPC_RESULTCODE_DOWNLOADPENDING) return TRANSPORT_READ_MORE;
+    if (R_FAILED(ret)) {
+        log_error("httpcDownloadData failed: %08lX", ret);
+        return TRANSPORT_READ_ERROR;
+    }
+    return TRANSPORT_READ_DONE;
+}
+
+static void httpc_abort(void *handle) {
+    HttpcRequest *req = handle;
+    httpcCancelConnection(&req->context);
+}
+
+static void httpc_close(void *handle) {
+    HttpcRequest *req = handle;
+    httpcCloseContext(&req->context);
+    free(req);
+}
+
+const TransportBackend transport_httpc_backend = {
+    .name = "httpc",
+    .init = httpc_init,
+    .exit = httpc_exit,
+    .open = httpc_open,
+    .add_header = httpc_add_header,
+    .set_body = httpc_set_body,
+    .begin = httpc_begin,
+    .unreachable = httpc_unreachable,
+    .get_status = httpc_get_status,
+    .get_header = httpc_get_header,
+    .get_content_length = httpc_get_content_length,
+    .read = httpc_read,
+    .close = httpc_close,
+    .abort = httpc_abort,
+};
+
+#endif // __3DS__
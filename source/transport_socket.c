@@ -0,0 +1,470 @@
+/*
+ * Transport backend - Plain HTTP/1.1 over BSD sockets
+ *
+ * Works on the 3DS (soc:u) and on any POSIX host, so the API layer can be
+ * exercised and profiled against a local server. No TLS support.
+ */
+
+#include "transport.h"
+#include "log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <stdatomic.h>
+#ifdef __3DS__
+#include <malloc.h>
+#include <3ds.h>
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+#define SOCKET_REQUEST_HEADERS_SIZE 2048
+#define SOCKET_RESPONSE_HEADERS_SIZE 8192
+#define SOCKET_RECV_BUFFER_SIZE (16 * 1024)
+#ifdef __3DS__
+#define SOC_BUFFER_SIZE 0x100000
+#endif
+
+typedef struct {
+    TransportMethod method;
+    char authority[256]; // host[:port] as given in the URL, for the Host header
+    char host[256];      // Without the brackets of an IPv6 literal
+    char port[8];
+    char path[1024];
+    char requestHeaders[SOCKET_REQUEST_HEADERS_SIZE];
+    size_t requestHeadersLen;
+    char *body; // POST only
+    size_t bodyLen;
+
+    int fd;
+    int status;
+    char responseHeaders[SOCKET_RESPONSE_HEADERS_SIZE];
+    uint32_t contentLength;
+    bool hasContentLength;
+    bool chunked;
+    uint64_t remaining; // Bytes left in the body (identity) or current chunk (chunked)
+    bool done;
+    uint64_t deadlineMs; // Reads fail after this while waiting for the response headers (0 = no limit)
+    bool unreachable;    // Connecting failed or the response deadline passed
+    atomic_bool aborted;
+
+    char recvBuf[SOCKET_RECV_BUFFER_SIZE];
+    size_t recvStart;
+    size_t recvEnd;
+} SocketRequest;
+
+#ifdef __3DS__
+static u32 *socBuffer = NULL;
+#endif
+
+bool transport_socket_service_init(void) {
+#ifdef __3DS__
+    if (socBuffer) return true;
+    socBuffer = memalign(0x1000, SOC_BUFFER_SIZE);
+    if (!socBuffer) {
+        log_error("Failed to allocate socket buffer");
+        return false;
+    }
+    Result ret = socInit(socBuffer, SOC_BUFFER_SIZE);
+    if (R_FAILED(ret)) {
+        log_error("socInit failed: %08lX", ret);
+        free(socBuffer);
+        socBuffer = NULL;
+        return false;
+    }
+#endif
+    return true;
+}
+
+void transport_socket_service_exit(void) {
+#ifdef __3DS__
+    if (!socBuffer) return;
+    socExit();
+    free(socBuffer);
+    socBuffer = NULL;
+#endif
+}
+
+// Split http://host[:port]/path (host may be a bracketed IPv6 literal) into its parts
+static bool parse_url(SocketRequest *req, const char *url) {
+    if (strncmp(url, "http://", 7) != 0) {
+        log_error("Socket transport only supports http:// URLs: %s", url);
+        return false;
+    }
+    const char *hostStart = url + 7;
+    const char *pathStart = strchr(hostStart, '/');
+    size_t hostLen = pathStart ? (size_t)(pathStart - hostStart) : strlen(hostStart);
+    if (hostLen == 0 || hostLen >= sizeof(req->authority)) return false;
+
+    snprintf(req->authority, sizeof(req->authority), "%.*s", (int)hostLen, hostStart);
+    snprintf(req->path, sizeof(req->path), "%s", pathStart ? pathStart : "/");
+    snprintf(req->port, sizeof(req->port), "80");
+
+    const char *host = req->authority;
+    const char *portStart;
+    if (host[0] == '[') {
+        const char *close = strchr(host, ']');
+        if (!close || (close[1] != '\0' && close[1] != ':')) return false;
+        host++;
+        hostLen = close - host;
+        portStart = close[1] == ':' ? close + 2 : NULL;
+    } else {
+        const char *colon = strrchr(host, ':');
+        hostLen = colon ? (size_t)(colon - host) : strlen(host);
+        portStart = colon ? colon + 1 : NULL;
+    }
+    if (hostLen == 0) return false;
+    snprintf(req->host, sizeof(req->host), "%.*s", (int)hostLen, host);
+    if (portStart && *portStart) {
+        if (strlen(portStart) >= sizeof(req->port)) return false;
+        snprintf(req->port, sizeof(req->port), "%s", portStart);
+    }
+    return true;
+}
+
+static void *socket_open(TransportMethod method, const char *url) {
+    SocketRequest *req = calloc(1, sizeof(SocketRequest));
+    if (!req) return NULL;
+
+    req->method = method;
+    req->fd = -1;
+    if (!parse_url(req, url)) {
+        free(req);
+        return NULL;
+    }
+    return req;
+}
+
+static bool socket_add_header(void *handle, const char *name, const char *value) {
+    SocketRequest *req = handle;
+    size_t avail = sizeof(req->requestHeaders) - req->requestHeadersLen;
+    int len = snprintf(req->requestHeaders + req->requestHeadersLen, avail, "%s: %s\r\n", name, value);
+    if (len < 0 || (size_t)len >= avail) {
+        req->requestHeaders[req->requestHeadersLen] = '\0';
+        return false;
+    }
+    req->requestHeadersLen += len;
+    return true;
+}
+
+static bool socket_set_body(void *handle, const void *data, size_t len) {
+    SocketRequest *req = handle;
+    char lengthStr[24];
+    snprintf(lengthStr, sizeof(lengthStr), "%lu", (unsigned long)len);
+    char *body = malloc(len ? len : 1);
+    if (!body || !socket_add_header(req, "Content-Length", lengthStr)) {
+        free(body);
+        return false;
+    }
+    memcpy(body, data, len);
+    free(req->body);
+    req->body = body;
+    req->bodyLen = len;
+    return true;
+}
+
+static const char *method_name(TransportMethod method) {
+    switch (method) {
+    case TRANSPORT_METHOD_HEAD:
+        return "HEAD";
+    case TRANSPORT_METHOD_POST:
+        return "POST";
+    default:
+        return "GET";
+    }
+}
+
+static bool send_all(int fd, const char *data, size_t len) {
+    while (len > 0) {
+        ssize_t sent = send(fd, data, len, MSG_NOSIGNAL);
+        if (sent <= 0) {
+            if (sent < 0 && errno == EINTR) continue;
+            return false;
+        }
+        data += sent;
+        len -= sent;
+    }
+    return true;
+}
+
+// Wait until fd is ready for events or deadlineMs passes. Returns false on timeout or error.
+static bool wait_ready(int fd, short events, uint64_t deadlineMs) {
+    while (true) {
+        uint64_t now = transport_now_ms();
+        if (now >= deadlineMs) return false;
+        struct pollfd pfd = {.fd = fd, .events = events};
+        int ready = poll(&pfd, 1, (int)(deadlineMs - now));
+        if (ready > 0) return true;
+        if (ready < 0 && errno != EINTR) return false;
+    }
+}
+
+// Refill the receive buffer if empty. Returns bytes available, 0 on EOF, -1 on error.
+static ssize_t fill_buffer(SocketRequest *req) {
+    if (req->recvStart < req->recvEnd) return req->recvEnd - req->recvStart;
+    if (req->deadlineMs != 0 && !wait_ready(req->fd, POLLIN, req->deadlineMs)) {
+        log_error("No response from %s within %lu ms", req->host, (unsigned long)transport_response_timeout_ms());
+        req->unreachable = true;
+        return -1;
+    }
+
+    ssize_t n;
+    do {
+        n = recv(req->fd, req->recvBuf, sizeof(req->recvBuf), 0);
+    } while (n < 0 && errno == EINTR);
+    if (n < 0) return -1;
+
+    req->recvStart = 0;
+    req->recvEnd = n;
+    return n;
+}
+
+// Read one CRLF-terminated line (CRLF stripped). Returns false on EOF, error or overflow.
+static bool read_line(SocketRequest *req, char *line, size_t lineSize) {
+    size_t len = 0;
+    while (true) {
+        if (fill_buffer(req) <= 0) return false;
+        char c = req->recvBuf[req->recvStart++];
+        if (c == '\n') break;
+        if (c == '\r') continue;
+        if (len + 1 >= lineSize) return false;
+        line[len++] = c;
+    }
+    line[len] = '\0';
+    return true;
+}
+
+// Connect fd, giving up at deadlineMs (0 = block until the stack gives up)
+static bool connect_with_timeout(int fd, const struct addrinfo *ai, uint64_t deadlineMs) {
+    if (deadlineMs == 0) return connect(fd, ai->ai_addr, ai->ai_addrlen) == 0;
+
+    int flags = fcntl(fd, F_GETFL, 0);
+    if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0) return connect(fd, ai->ai_addr, ai->ai_addrlen) == 0;
+    bool connected = connect(fd, ai->ai_addr, ai->ai_addrlen) == 0;
+    if (!connected && errno == EINPROGRESS) {
+        if (wait_ready(fd, POLLOUT, deadlineMs)) {
+            int err = 0;
+            socklen_t errLen = sizeof(err);
+            connected = getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &errLen) == 0 && err == 0;
+            if (!connected) errno = err;
+        } else {
+            errno = ETIMEDOUT;
+        }
+    }
+    fcntl(fd, F_SETFL, flags);
+    return connected;
+}
+
+static bool connect_socket(SocketRequest *req) {
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    struct addrinfo *result = NULL;
+    int err = getaddrinfo(req->host, req->port, &hints, &result);
+    if (err != 0 || !result) {
+        log_error("Failed to resolve %s:%s (%d)", req->host, req->port, err);
+        return false;
+    }
+
+    // One deadline for all addresses, so a host with several doesn't multiply the wait
+    uint32_t timeoutMs = transport_connect_timeout_ms();
+    uint64_t deadlineMs = transport_now_ms() + timeoutMs;
+    for (struct addrinfo *ai = result; ai; ai = ai->ai_next) {
+        int fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd < 0) continue;
+        if (connect_with_timeout(fd, ai, timeoutMs > 0 ? deadlineMs : 0)) {
+            req->fd = fd;
+            break;
+        }
+        close(fd);
+    }
+    freeaddrinfo(result);
+
+    if (req->fd < 0) {
+        log_error("Failed to connect to %s:%s (errno: %d)", req->host, req->port, errno);
+        return false;
+    }
+    return true;
+}
+
+static bool socket_begin(void *handle) {
+    SocketRequest *req = handle;
+    if (!connect_socket(req)) {
+        req->unreachable = true;
+        return false;
+    }
+
+    char head[SOCKET_REQUEST_HEADERS_SIZE + 1536];
+    int len = snprintf(head, sizeof(head), "%s %s HTTP/1.1\r\nHost: %s\r\nConnection: close\r\n%s\r\n",
+                       method_name(req->method), req->path, req->authority, req->requestHeaders);
+    if (len < 0 || (size_t)len >= sizeof(head) || !send_all(req->fd, head, len) ||
+        (req->bodyLen > 0 && !send_all(req->fd, req->body, req->bodyLen))) {
+        log_error("Failed to send request to %s", req->host);
+        return false;
+    }
+    uint32_t responseTimeoutMs = transport_response_timeout_ms();
+    if (responseTimeoutMs > 0) req->deadlineMs = transport_now_ms() + responseTimeoutMs;
+
+    // Status line
+    char line[1024];
+    if (!read_line(req, line, sizeof(line)) || sscanf(line, "HTTP/%*d.%*d %d", &req->status) != 1) {
+        log_error("Malformed HTTP status line from %s", req->host);
+        return false;
+    }
+
+    // Header block, kept raw for get_header lookups
+    size_t headersLen = 0;
+    while (true) {
+        if (!read_line(req, line, sizeof(line))) {
+            log_error("Truncated HTTP headers from %s", req->host);
+            return false;
+        }
+        if (line[0] == '\0') break;
+
+        size_t lineLen = strlen(line);
+        if (headersLen + lineLen + 2 < sizeof(req->responseHeaders)) {
+            memcpy(req->responseHeaders + headersLen, line, lineLen);
+            headersLen += lineLen;
+            req->responseHeaders[headersLen++] = '\n';
+            req->responseHeaders[headersLen] = '\0';
+        }
+
+        char *colon = strchr(line, ':');
+        if (!colon) continue;
+        *colon = '\0';
+        const char *value = colon + 1;
+        while (*value == ' ') value++;
+        if (strcasecmp(line, "Content-Length") == 0) {
+            req->contentLength = (uint32_t)strtoul(value, NULL, 10);
+            req->hasContentLength = true;
+        } else if (strcasecmp(line, "Transfer-Encoding") == 0 && strstr(value, "chunked")) {
+            req->chunked = true;
+        }
+    }
+
+    req->deadlineMs = 0;
+    if (req->method == TRANSPORT_METHOD_HEAD || req->status == 204 || req->status == 304) {
+        req->done = true;
+    } else if (!req->chunked && req->hasContentLength) {
+        req->remaining = req->contentLength;
+        req->done = req->remaining == 0;
+    }
+    return true;
+}
+
+static bool socket_unreachable(void *handle) {
+    SocketRequest *req = handle;
+    return req->unreachable;
+}
+
+static bool socket_get_status(void *handle, int *status) {
+    SocketRequest *req = handle;
+    if (req->status == 0) return false;
+    *status = req->status;
+    return true;
+}
+
+static bool socket_get_header(void *handle, const char *name, char *value, size_t valueSize) {
+    SocketRequest *req = handle;
+    return transport_find_header(req->responseHeaders, name, value, valueSize);
+}
+
+static uint32_t socket_get_content_length(void *handle) {
+    SocketRequest *req = handle;
+    return req->hasContentLength && !req->chunked ? req->contentLength : 0;
+}
+
+// Copy up to size bytes of raw stream data. Returns bytes copied, 0 on EOF, -1 on error.
+static ssize_t read_raw(SocketRequest *req, void *buffer, size_t size) {
+    ssize_t avail = fill_buffer(req);
+    if (avail <= 0) return avail;
+    size_t n = (size_t)avail < size ? (size_t)avail : size;
+    memcpy(buffer, req->recvBuf + req->recvStart, n);
+    req->recvStart += n;
+    return n;
+}
+
+static TransportReadResult socket_read(void *handle, void *buffer, size_t size, size_t *bytesRead) {
+    SocketRequest *req = handle;
+    char line[64];
+    if (atomic_load(&req->aborted)) return TRANSPORT_READ_ERROR;
+
+    while (!req->done && *bytesRead < size) {
+        // Chunked: start the next chunk once the current one is drained
+        if (req->chunked && req->remaining == 0) {
+            if (!read_line(req, line, sizeof(line))) return TRANSPORT_READ_ERROR;
+            if (line[0] == '\0' && !read_line(req, line, sizeof(line))) return TRANSPORT_READ_ERROR;
+            req->remaining = strtoull(line, NULL, 16);
+            if (req->remaining == 0) {
+                // Skip trailers up to the terminating empty line
+                do {
+                    if (!read_line(req, line, sizeof(line))) break;
+                } while (line[0] != '\0');
+                req->done = true;
+                break;
+            }
+        }
+
+        size_t want = size - *bytesRead;
+        if ((req->chunked || req->hasContentLength) && want > req->remaining) want = req->remaining;
+
+        ssize_t n = read_raw(req, (char *)buffer + *bytesRead, want);
+        if (n < 0 || atomic_load(&req->aborted)) return TRANSPORT_READ_ERROR;
+        if (n == 0) {
+            // EOF only terminates bodies without explicit framing
+            if (req->chunked || req->hasContentLength) return TRANSPORT_READ_ERROR;
+            req->done = true;
+            break;
+        }
+
+        *bytesRead += n;
+        if (req->chunked || req->hasContentLength) {
+            req->remaining -= n;
+            if (!req->chunked && req->remaining == 0) req->done = true;
+        }
+    }
+
+    return req->done ? TRANSPORT_READ_DONE : TRANSPORT_READ_MORE;
+}
+
+static void socket_abort(void *handle) {
+    SocketRequest *req = handle;
+    atomic_store(&req->aborted, true);
+    // Wakes a blocked recv with EOF
+    if (req->fd >= 0) shutdown(req->fd, SHUT_RDWR);
+}
+
+static void socket_close(void *handle) {
+    SocketRequest *req = handle;
+    if (req->fd >= 0) close(req->fd);
+    free(req->body);
+    free(req);
+}
+
+const TransportBackend transport_socket_backend = {
+    .name = "socket",
+    .init = transport_socket_service_init,
+    .exit = transport_socket_service_exit,
+    .open = socket_open,
+    .add_header = socket_add_header,
+    .set_body = socket_set_body,
+    .begin = socket_begin,
+    .unreachable = socket_unreachable,
+    .get_status = socket_get_status,
+    .get_header = socket_get_header,
+    .get_content_length = socket_get_content_length,
+    .read = socket_read,
+    .close = socket_close,
+    .abort = socket_abort,
+};
@@ -10,6 +10,7 @@
 static C2D_TextBuf textBuf;
 static C2D_Font font;
 static bool fontLoaded = false;
+static bool statusBarReserved = false;
 
 void ui_init(void) {
     textBuf = C2D_TextBufNew(4096);
@@ -76,52 +77,25 @@ void ui_draw_loading(const char *message) {
     ui_draw_text(x, y, message, UI_COLOR_TEXT);
 }
 
-void ui_draw_progress(float progress, const char *label, const char *sizeText, const char *name,
-                      const char *queueText) {
-    ui_draw_rect(0, 0, SCREEN_TOP_WIDTH, SCREEN_TOP_HEIGHT, C2D_Color32(0x1a, 0x1a, 0x2e, 0xE0));
-
-    float centerY = SCREEN_TOP_HEIGHT / 2;
-
-    // ROM name above progress bar
-    if (name) {
-        float nameWidth = ui_get_text_width(name);
-        ui_draw_text((SCREEN_TOP_WIDTH - nameWidth) / 2, centerY - 2 * UI_LINE_HEIGHT - UI_PADDING, name,
-                     UI_COLOR_TEXT);
-    }
-
-    // Action label
-    float labelWidth = ui_get_text_width(label);
-    ui_draw_text((SCREEN_TOP_WIDTH - labelWidth) / 2, centerY - UI_LINE_HEIGHT - UI_PADDING, label, UI_COLOR_TEXT_DIM);
-
-    // Progress bar
-    float barWidth = 300;
-    float barHeight = 16;
-    float barX = (SCREEN_TOP_WIDTH - barWidth) / 2;
-    float barY = centerY;
+void ui_draw_status_bar(float progress, const char *text) {
+    float barY = SCREEN_TOP_HEIGHT - UI_STATUS_BAR_HEIGHT;
 
-    // Track
-    ui_draw_rect(barX, barY, barWidth, barHeight, UI_COLOR_SCROLLBAR_TRACK);
-
-    // Fill
-    if (progress >= 0) {
-        float fillWidth = barWidth * progress;
-        if (fillWidth > 0) {
-            ui_draw_rect(barX, barY, fillWidth, barHeight, UI_COLOR_ACCENT);
-        }
+    ui_draw_rect(0, barY, SCREEN_TOP_WIDTH, UI_STATUS_BAR_HEIGHT, UI_COLOR_HEADER);
+    if (progress > 0) {
+        float fillWidth = SCREEN_TOP_WIDTH * (progress < 1.0f ? progress : 1.0f);
+        ui_draw_rect(0, barY, fillWidth, UI_STATUS_BAR_HEIGHT, UI_COLOR_ACCENT);
     }
+    ui_draw_text(UI_PADDING, barY + 4, text, UI_COLOR_TEXT);
+}
 
-    // Size text below bar
-    if (sizeText) {
-        float sizeWidth = ui_get_text_width(sizeText);
-        ui_draw_text((SCREEN_TOP_WIDTH - sizeWidth) / 2, barY + barHeight + UI_PADDING, sizeText, UI_COLOR_TEXT_DIM);
-    }
+void ui_reserve_status_bar(bool reserved) {
+    statusBarReserved = reserved;
+}
 
-    // Queue context below size text
-    if (queueText) {
-        float queueWidth = ui_get_text_width(queueText);
-        ui_draw_text((SCREEN_TOP_WIDTH - queueWidth) / 2, barY + barHeight + UI_PADDING + UI_LINE_HEIGHT, queueText,
-                     UI_COLOR_TEXT_DIM);
-    }
+float ui_hint_y(void) {
+    // Directly below a full list, which just clears the strip
+    if (statusBarReserved) return UI_HEADER_HEIGHT + UI_PADDING + UI_VISIBLE_ITEMS * UI_LINE_HEIGHT;
+    return SCREEN_TOP_HEIGHT - UI_LINE_HEIGHT - UI_PADDING;
 }
 
 float ui_get_text_width(const char *text) {
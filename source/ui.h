@@ -29,6 +29,7 @@
 #define UI_LINE_HEIGHT 20
 #define UI_HEADER_HEIGHT 30
 #define UI_VISIBLE_ITEMS 8
+#define UI_STATUS_BAR_HEIGHT (UI_LINE_HEIGHT + 4)
 
 // API/data constants
 #define ROM_PAGE_SIZE 50
@@ -64,11 +65,15 @@ float ui_get_text_width_scaled(const char *text, float scale);
 // Draw a centered loading message on top screen
 void ui_draw_loading(const char *message);
 
-// Draw progress bar on top screen (progress 0.0 to 1.0, negative if unknown)
-// label: action label (e.g., "Downloading...", "Extracting...")
-// name: ROM name to display above progress bar
-// queueText: optional queue context (e.g., "ROM 1 of 3 in your queue"), NULL if not queued
-void ui_draw_progress(float progress, const char *label, const char *sizeText, const char *name, const char *queueText);
+// Draw a one-line status strip with a progress fill along the bottom of the top screen
+// (progress 0.0 to 1.0, negative if unknown)
+void ui_draw_status_bar(float progress, const char *text);
+
+// Keep the bottom of the top screen clear for the status strip this frame (set before drawing the screen)
+void ui_reserve_status_bar(bool reserved);
+
+// Y of the control hint line at the bottom of the top screen, moved up above the status strip while reserved
+float ui_hint_y(void);
 
 // Show software keyboard and get input
 // Returns true if user confirmed, false if cancelled
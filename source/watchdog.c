@@ -0,0 +1,85 @@
+/*
+ * Watchdog module - Aborts transfers that stop making progress
+ */
+
+#include "watchdog.h"
+#include "log.h"
+#include "thread.h"
+
+#define WATCHDOG_STACK_SIZE (16 * 1024)
+
+static ThreadMutex lock;
+static ThreadCond wake;
+static ThreadHandle *thread = NULL;
+static bool stopping = false;
+static StallWatch *watches = NULL; // Guarded by lock
+static atomic_uint timeoutMs = WATCHDOG_DEFAULT_TIMEOUT_MS;
+
+static void watchdog_main(void *arg) {
+    (void)arg;
+    thread_mutex_lock(&lock);
+    while (!stopping) {
+        thread_cond_wait_ms(&wake, &lock, WATCHDOG_POLL_MS);
+        uint32_t timeout = atomic_load(&timeoutMs);
+        if (timeout == 0) continue;
+        uint32_t now = (uint32_t)transport_now_ms();
+        for (StallWatch *w = watches; w; w = w->next) {
+            uint32_t idle = now - atomic_load(&w->lastProgressMs);
+            if (w->fired || idle < timeout) continue;
+            log_warn("No data for %lu ms, aborting transfer", (unsigned long)idle);
+            w->fired = true;
+            transport_abort(w->req);
+        }
+    }
+    thread_mutex_unlock(&lock);
+}
+
+void watchdog_init(void) {
+    thread_mutex_init(&lock);
+    thread_cond_init(&wake);
+    stopping = false;
+    watches = NULL;
+    thread = thread_start(watchdog_main, NULL, WATCHDOG_STACK_SIZE);
+    if (!thread) log_warn("Failed to start watchdog, stalled transfers won't be aborted");
+}
+
+void watchdog_exit(void) {
+    if (!thread) return;
+    thread_mutex_lock(&lock);
+    stopping = true;
+    thread_cond_signal(&wake);
+    thread_mutex_unlock(&lock);
+    thread_join(thread);
+    thread = NULL;
+}
+
+void watchdog_set_timeout(uint32_t ms) {
+    atomic_store(&timeoutMs, ms);
+}
+
+void watchdog_start(StallWatch *watch, TransportRequest *req) {
+    watch->req = req;
+    atomic_store(&watch->lastProgressMs, (uint32_t)transport_now_ms());
+    watch->fired = false;
+    thread_mutex_lock(&lock);
+    watch->next = watches;
+    watches = watch;
+    thread_mutex_unlock(&lock);
+}
+
+void watchdog_progress(StallWatch *watch) {
+    atomic_store(&watch->lastProgressMs, (uint32_t)transport_now_ms());
+}
+
+bool watchdog_stop(StallWatch *watch) {
+    thread_mutex_lock(&lock);
+    for (StallWatch **p = &watches; *p; p = &(*p)->next) {
+        if (*p == watch) {
+            *p = watch->next;
+            break;
+        }
+    }
+    bool fired = watch->fired;
+    thread_mutex_unlock(&lock);
+    return fired;
+}
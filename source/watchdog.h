@@ -0,0 +1,47 @@
+/*
+ * Watchdog module - Aborts transfers that stop making progress
+ *
+ * A connection can go quiet without failing: the peer vanishes, Wi-Fi drops
+ * without a reset, and a blocking read then waits forever. Transfers register
+ * while they read a body and report each chunk; a background thread aborts
+ * any that received nothing for the stall timeout, so the read fails and the
+ * caller can resume from what it already has.
+ */
+
+#ifndef WATCHDOG_H
+#define WATCHDOG_H
+
+#include "transport.h"
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define WATCHDOG_DEFAULT_TIMEOUT_MS 20000
+#define WATCHDOG_POLL_MS 250
+
+// One watched transfer, owned by the caller
+typedef struct StallWatch {
+    TransportRequest *req;
+    atomic_uint lastProgressMs; // Low 32 bits of transport_now_ms(), updated from the transfer's thread
+    bool fired;
+    struct StallWatch *next;
+} StallWatch;
+
+// Start / stop the watchdog thread
+void watchdog_init(void);
+void watchdog_exit(void);
+
+// Abort transfers idle this long (0 = never)
+void watchdog_set_timeout(uint32_t ms);
+
+// Watch req until watchdog_stop(). req must stay open until then.
+void watchdog_start(StallWatch *watch, TransportRequest *req);
+
+// Bytes arrived
+void watchdog_progress(StallWatch *watch);
+
+// Stop watching. Returns true if the watchdog aborted the transfer.
+bool watchdog_stop(StallWatch *watch);
+
+#endif // WATCHDOG_H
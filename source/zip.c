@@ -4,9 +4,15 @@
 
 #include "zip.h"
 #include "log.h"
+#include "md5.h"
+#include "storage.h"
+#include "filesink.h"
+#include "zipstream.h"
 #include <minizip/unzip.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 #include <sys/stat.h>
 
 #define EXTRACT_CHUNK_SIZE (64 * 1024)
@@ -20,62 +26,93 @@ bool zip_is_zip_file(const char *filename) {
             (ext[3] == 'p' || ext[3] == 'P'));
 }
 
-// Ensure all directories in a path exist
-static bool ensure_parent_dirs(const char *filePath) {
-    char tmp[768];
-    snprintf(tmp, sizeof(tmp), "%s", filePath);
-
-    for (char *p = tmp + 1; *p; p++) {
-        if (*p == '/') {
-            *p = '\0';
-            mkdir(tmp, 0755);
-            *p = '/';
-        }
-    }
-    return true;
-}
-
 // Sum uncompressed sizes of all files in the archive
-static uint32_t get_total_uncompressed_size(unzFile uf) {
-    uint32_t total = 0;
+static uint64_t get_total_uncompressed_size(unzFile uf) {
+    uint64_t total = 0;
     unz_file_info fileInfo;
 
     if (unzGoToFirstFile(uf) != UNZ_OK) return 0;
 
     do {
         if (unzGetCurrentFileInfo(uf, &fileInfo, NULL, 0, NULL, 0, NULL, 0) == UNZ_OK) {
-            total += (uint32_t)fileInfo.uncompressed_size;
+            total += fileInfo.uncompressed_size;
         }
     } while (unzGoToNextFile(uf) == UNZ_OK);
 
     return total;
 }
 
-bool zip_extract(const char *zipPath, const char *destDir, ExtractProgressCb progressCb) {
+// Files opened for writing by this extraction, so a failure removes only what it wrote
+typedef struct {
+    char **paths;
+    int count;
+    int cap;
+} CreatedFiles;
+
+static bool remember_file(CreatedFiles *files, const char *path) {
+    if (files->count == files->cap) {
+        int cap = files->cap ? files->cap * 2 : 8;
+        char **grown = realloc(files->paths, cap * sizeof(char *));
+        if (!grown) return false;
+        files->paths = grown;
+        files->cap = cap;
+    }
+    size_t len = strlen(path) + 1;
+    char *copy = malloc(len);
+    if (!copy) return false;
+    memcpy(copy, path, len);
+    files->paths[files->count++] = copy;
+    return true;
+}
+
+// Free the list, deleting the files first after a failed, cancelled or corrupt extraction
+static void release_files(CreatedFiles *files, bool removeFiles) {
+    for (int i = 0; i < files->count; i++) {
+        if (removeFiles) remove(files->paths[i]);
+        free(files->paths[i]);
+    }
+    free(files->paths);
+}
+
+ZipExtractResult zip_extract(const char *zipPath, const char *destDir, ExtractProgressCb progressCb,
+                             const char *expectedMd5) {
     unzFile uf = unzOpen(zipPath);
     if (!uf) {
         log_error("Failed to open zip: %s", zipPath);
-        return false;
+        return ZIP_EXTRACT_FAILED;
     }
 
-    uint32_t totalSize = get_total_uncompressed_size(uf);
+    uint64_t totalSize = get_total_uncompressed_size(uf);
     uint32_t totalExtracted = 0;
+    CreatedFiles created = {0};
     bool success = true;
+    bool corrupt = false;
+    Md5Context md5;
+    md5_init(&md5);
 
     log_info("Extracting %s (%.1f MB uncompressed)", zipPath, totalSize / (1024.0f * 1024.0f));
 
     if (unzGoToFirstFile(uf) != UNZ_OK) {
         log_error("Failed to read first file in zip");
         unzClose(uf);
-        return false;
+        return ZIP_EXTRACT_FAILED;
     }
 
     unsigned char *buffer = malloc(EXTRACT_CHUNK_SIZE);
     if (!buffer) {
         log_error("Failed to allocate extraction buffer");
         unzClose(uf);
-        return false;
+        return ZIP_EXTRACT_FAILED;
+    }
+
+    // The archive stays on the card until extraction succeeds, so its contents need room of their own. Each
+    // entry's share of the claim is given back once its file is preallocated and holds the space itself.
+    if (!storage_reserve(destDir, totalSize)) {
+        free(buffer);
+        unzClose(uf);
+        return ZIP_EXTRACT_NO_SPACE;
     }
+    uint64_t claimed = totalSize;
 
     do {
         char filename[256];
@@ -87,23 +124,10 @@ bool zip_extract(const char *zipPath, const char *destDir, ExtractProgressCb pro
             break;
         }
 
-        // Build destination path, skipping if too long
-        size_t dirLen = strlen(destDir);
+        // Build destination path, skipping entries that are too long or escape destDir
         size_t nameLen = strlen(filename);
         char destPath[768];
-        if (dirLen + 1 + nameLen >= sizeof(destPath)) {
-            log_error("Path too long, skipping: %s/%s", destDir, filename);
-            continue;
-        }
-        memcpy(destPath, destDir, dirLen);
-        destPath[dirLen] = '/';
-        memcpy(destPath + dirLen + 1, filename, nameLen + 1);
-
-        // Reject path traversal (Zip Slip)
-        if (strstr(filename, "..") != NULL) {
-            log_error("Zip entry contains path traversal, skipping: %s", filename);
-            continue;
-        }
+        if (!zipstream_entry_path(destDir, filename, destPath, sizeof(destPath))) continue;
 
         // Skip directories (entries ending with /)
         if (nameLen > 0 && filename[nameLen - 1] == '/') {
@@ -111,7 +135,7 @@ bool zip_extract(const char *zipPath, const char *destDir, ExtractProgressCb pro
             continue;
         }
 
-        ensure_parent_dirs(destPath);
+        zipstream_make_parent_dirs(destPath);
 
         if (unzOpenCurrentFile(uf) != UNZ_OK) {
             log_error("Failed to open file in zip: %s", filename);
@@ -119,25 +143,33 @@ bool zip_extract(const char *zipPath, const char *destDir, ExtractProgressCb pro
             break;
         }
 
-        FILE *outFile = fopen(destPath, "wb");
-        if (!outFile) {
-            log_error("Failed to create file: %s", destPath);
+        FileSink *outFile = filesink_open(destPath, false, 0);
+        if (!outFile || !remember_file(&created, destPath)) {
+            if (outFile) {
+                filesink_close(outFile);
+                remove(destPath);
+            }
             unzCloseCurrentFile(uf);
             success = false;
             break;
         }
+        if (storage_preallocate(outFile, fileInfo.uncompressed_size)) {
+            uint64_t held = fileInfo.uncompressed_size < claimed ? fileInfo.uncompressed_size : claimed;
+            storage_release(held);
+            claimed -= held;
+        }
 
         int bytesRead;
         while ((bytesRead = unzReadCurrentFile(uf, buffer, EXTRACT_CHUNK_SIZE)) > 0) {
-            if (fwrite(buffer, 1, bytesRead, outFile) != (size_t)bytesRead) {
-                log_error("Failed to write extracted file: %s", destPath);
+            if (!filesink_write(outFile, buffer, bytesRead)) {
                 success = false;
                 break;
             }
+            if (expectedMd5) md5_update(&md5, buffer, bytesRead);
             totalExtracted += bytesRead;
 
             if (progressCb) {
-                if (!progressCb(totalExtracted, totalSize)) {
+                if (!progressCb(totalExtracted, (uint32_t)totalSize)) {
                     log_info("Extraction cancelled by user");
                     success = false;
                     break;
@@ -145,17 +177,19 @@ bool zip_extract(const char *zipPath, const char *destDir, ExtractProgressCb pro
             }
         }
 
-        fclose(outFile);
-        unzCloseCurrentFile(uf);
+        // Buffered data reaches the card on close, so a full card can fail here
+        if (!filesink_close(outFile)) success = false;
+        // minizip checks the entry's CRC32 as it inflates and reports a mismatch on close
+        int closeResult = unzCloseCurrentFile(uf);
 
-        if (!success) {
-            remove(destPath);
-            break;
-        }
+        if (!success) break;
 
         if (bytesRead < 0) {
             log_error("Error reading from zip: %s", filename);
-            remove(destPath);
+            success = false;
+        } else if (closeResult == UNZ_CRCERROR) {
+            log_error("CRC mismatch in zip entry: %s", filename);
+            corrupt = true;
             success = false;
         }
 
@@ -165,12 +199,24 @@ bool zip_extract(const char *zipPath, const char *destDir, ExtractProgressCb pro
     } while (unzGoToNextFile(uf) == UNZ_OK);
 
     free(buffer);
+
+    if (success && expectedMd5) {
+        char actual[MD5_HEX_LEN];
+        md5_final_hex(&md5, actual);
+        if (strcasecmp(actual, expectedMd5) != 0) {
+            log_error("Extracted contents MD5 %s, expected %s", actual, expectedMd5);
+            corrupt = true;
+            success = false;
+        }
+    }
+    release_files(&created, !success);
     unzClose(uf);
+    storage_release(claimed);
 
     if (success) {
         remove(zipPath);
         log_info("Extraction complete, zip deleted");
     }
 
-    return success;
+    return success ? ZIP_EXTRACT_OK : corrupt ? ZIP_EXTRACT_CORRUPT : ZIP_EXTRACT_FAILED;
 }
@@ -12,10 +12,19 @@
 // extracted: bytes extracted so far, total: total uncompressed size
 typedef bool (*ExtractProgressCb)(uint32_t extracted, uint32_t total);
 
+typedef enum {
+    ZIP_EXTRACT_OK,
+    ZIP_EXTRACT_FAILED,   // Unreadable archive, write error or cancellation
+    ZIP_EXTRACT_CORRUPT,  // An entry failed its CRC32, or the contents didn't match expectedMd5
+    ZIP_EXTRACT_NO_SPACE, // The uncompressed contents don't fit on the card; nothing was written
+} ZipExtractResult;
+
 // Extract all files from a zip archive into destDir.
-// Deletes the zip file on success.
-// Returns true on success, false on failure or cancellation.
-bool zip_extract(const char *zipPath, const char *destDir, ExtractProgressCb progressCb);
+// expectedMd5 (may be NULL) is checked against every entry's data concatenated in archive order.
+// Space for the uncompressed contents is claimed from the storage module before anything is written.
+// Deletes the zip file on success. A failed extraction leaves no extracted files behind.
+ZipExtractResult zip_extract(const char *zipPath, const char *destDir, ExtractProgressCb progressCb,
+                             const char *expectedMd5);
 
 // Check if a filename has a .zip extension (case-insensitive)
 bool zip_is_zip_file(const char *filename);
@@ -0,0 +1,398 @@
+/*
+ * Zip stream module - Extract a zip archive as it arrives, without the central directory
+ */
+
+#include "zipstream.h"
+#include "log.h"
+#include "md5.h"
+#include "storage.h"
+#include "filesink.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <zlib.h>
+
+#define ZIPSTREAM_OUT_SIZE (64 * 1024)
+#define ZIPSTREAM_PATH_LEN 768
+#define ZIPSTREAM_META_SIZE 1024 // File name + extra field; longer headers are unsupported
+
+#define SIG_LOCAL_HEADER 0x04034b50
+#define SIG_CENTRAL_HEADER 0x02014b50
+#define SIG_END_OF_CENTRAL 0x06054b50
+#define SIG_DATA_DESCRIPTOR 0x08074b50
+
+#define LOCAL_HEADER_SIZE 30
+#define FLAG_ENCRYPTED 0x0001
+#define FLAG_DATA_DESCRIPTOR 0x0008
+#define METHOD_STORED 0
+#define METHOD_DEFLATED 8
+#define EXTRA_ZIP64 0x0001
+
+typedef enum { PHASE_HEADER, PHASE_META, PHASE_DATA, PHASE_DESCRIPTOR } Phase;
+
+struct ZipStream {
+    char destDir[ZIPSTREAM_PATH_LEN];
+    Phase phase;
+    ZipStreamResult result;
+
+    // Bytes collected for the header, name/extra or data descriptor being parsed
+    uint8_t scratch[ZIPSTREAM_META_SIZE];
+    size_t scratchLen;
+    size_t scratchWant;
+
+    // Current entry, from its local header
+    uint16_t flags;
+    uint16_t method;
+    uint32_t crc;
+    uint32_t compressedSize;
+    uint32_t uncompressedSize;
+    uint16_t nameLen;
+    uint16_t extraLen;
+    uint32_t remaining; // Compressed bytes left (unknown with a data descriptor)
+
+    z_stream inflater;
+    bool inflaterActive;
+    FileSink *out; // NULL for skipped entries and directories
+    char outPath[ZIPSTREAM_PATH_LEN];
+    uint32_t claimed; // Free space claimed for the open entry, given back once preallocated or when it closes
+    uint32_t outCrc;
+    uint32_t outSize;
+    uint8_t *outBuf;
+    Md5Context contentMd5; // Every entry's uncompressed bytes, in archive order
+
+    char **created; // Files written so far, deleted again unless kept
+    int createdCount;
+    int createdCap;
+    uint32_t written;
+};
+
+static uint16_t read_u16(const uint8_t *p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t read_u32(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+bool zipstream_entry_path(const char *destDir, const char *name, char *out, size_t outSize) {
+    // Reject path traversal (Zip Slip)
+    if (strstr(name, "..") != NULL) {
+        log_error("Zip entry contains path traversal, skipping: %s", name);
+        return false;
+    }
+    int len = snprintf(out, outSize, "%s/%s", destDir, name);
+    if (len < 0 || (size_t)len >= outSize) {
+        log_error("Path too long, skipping: %s/%s", destDir, name);
+        return false;
+    }
+    return true;
+}
+
+void zipstream_make_parent_dirs(const char *filePath) {
+    char tmp[ZIPSTREAM_PATH_LEN];
+    snprintf(tmp, sizeof(tmp), "%s", filePath);
+
+    for (char *p = tmp + 1; *p; p++) {
+        if (*p == '/') {
+            *p = '\0';
+            mkdir(tmp, 0755);
+            *p = '/';
+        }
+    }
+}
+
+ZipStream *zipstream_open(const char *destDir) {
+    ZipStream *zs = calloc(1, sizeof(ZipStream));
+    if (!zs) return NULL;
+    zs->outBuf = malloc(ZIPSTREAM_OUT_SIZE);
+    if (!zs->outBuf) {
+        free(zs);
+        return NULL;
+    }
+    snprintf(zs->destDir, sizeof(zs->destDir), "%s", destDir);
+    zs->phase = PHASE_HEADER;
+    zs->scratchWant = 4;
+    zs->result = ZIPSTREAM_OK;
+    md5_init(&zs->contentMd5);
+    return zs;
+}
+
+static bool remember_file(ZipStream *zs, const char *path) {
+    if (zs->createdCount == zs->createdCap) {
+        int cap = zs->createdCap ? zs->createdCap * 2 : 8;
+        char **grown = realloc(zs->created, cap * sizeof(char *));
+        if (!grown) return false;
+        zs->created = grown;
+        zs->createdCap = cap;
+    }
+    size_t len = strlen(path) + 1;
+    char *copy = malloc(len);
+    if (!copy) return false;
+    memcpy(copy, path, len);
+    zs->created[zs->createdCount++] = copy;
+    return true;
+}
+
+// Collect bytes into scratch until scratchWant are present. Returns bytes consumed.
+static size_t collect(ZipStream *zs, const uint8_t *data, size_t len) {
+    size_t take = zs->scratchWant - zs->scratchLen;
+    if (take > len) take = len;
+    memcpy(zs->scratch + zs->scratchLen, data, take);
+    zs->scratchLen += take;
+    return take;
+}
+
+static void expect(ZipStream *zs, Phase phase, size_t want) {
+    zs->phase = phase;
+    zs->scratchLen = 0;
+    zs->scratchWant = want;
+}
+
+static ZipStreamResult parse_header(ZipStream *zs) {
+    uint32_t sig = read_u32(zs->scratch);
+    if (zs->scratchWant == 4) {
+        if (sig == SIG_CENTRAL_HEADER || sig == SIG_END_OF_CENTRAL) return ZIPSTREAM_DONE;
+        if (sig != SIG_LOCAL_HEADER) {
+            log_debug("Zip stream: unexpected signature %08lx", (unsigned long)sig);
+            return ZIPSTREAM_UNSUPPORTED;
+        }
+        zs->scratchWant = LOCAL_HEADER_SIZE;
+        return ZIPSTREAM_OK;
+    }
+
+    const uint8_t *h = zs->scratch;
+    zs->flags = read_u16(h + 6);
+    zs->method = read_u16(h + 8);
+    zs->crc = read_u32(h + 14);
+    zs->compressedSize = read_u32(h + 18);
+    zs->uncompressedSize = read_u32(h + 22);
+    zs->nameLen = read_u16(h + 26);
+    zs->extraLen = read_u16(h + 28);
+
+    bool descriptor = zs->flags & FLAG_DATA_DESCRIPTOR;
+    if ((zs->flags & FLAG_ENCRYPTED) || (zs->method != METHOD_STORED && zs->method != METHOD_DEFLATED) ||
+        (descriptor && zs->method == METHOD_STORED) || zs->compressedSize == 0xFFFFFFFF ||
+        zs->uncompressedSize == 0xFFFFFFFF || (size_t)zs->nameLen + zs->extraLen > sizeof(zs->scratch) - 1) {
+        log_debug("Zip stream: unsupported entry (flags %04x, method %d)", zs->flags, zs->method);
+        return ZIPSTREAM_UNSUPPORTED;
+    }
+    expect(zs, PHASE_META, (size_t)zs->nameLen + zs->extraLen);
+    return ZIPSTREAM_OK;
+}
+
+static bool has_zip64_extra(const uint8_t *extra, size_t len) {
+    while (len >= 4) {
+        uint16_t id = read_u16(extra);
+        uint16_t size = read_u16(extra + 2);
+        if (id == EXTRA_ZIP64) return true;
+        if ((size_t)size + 4 > len) break;
+        extra += size + 4;
+        len -= size + 4;
+    }
+    return false;
+}
+
+// Close the entry's file, if any, and give back its space claim
+static bool close_output(ZipStream *zs) {
+    bool closed = filesink_close(zs->out);
+    zs->out = NULL;
+    storage_release(zs->claimed);
+    zs->claimed = 0;
+    return closed;
+}
+
+// Name and extra field are in scratch: open the entry's output
+static ZipStreamResult start_entry(ZipStream *zs) {
+    // A zip64 data descriptor has 8-byte sizes; its length can't be told from the stream
+    if ((zs->flags & FLAG_DATA_DESCRIPTOR) && has_zip64_extra(zs->scratch + zs->nameLen, zs->extraLen)) {
+        return ZIPSTREAM_UNSUPPORTED;
+    }
+
+    char name[ZIPSTREAM_META_SIZE];
+    memcpy(name, zs->scratch, zs->nameLen);
+    name[zs->nameLen] = '\0';
+
+    zs->out = NULL;
+    zs->outCrc = crc32(0L, Z_NULL, 0);
+    zs->outSize = 0;
+    zs->remaining = zs->compressedSize;
+
+    if (zipstream_entry_path(zs->destDir, name, zs->outPath, sizeof(zs->outPath))) {
+        if (zs->nameLen > 0 && name[zs->nameLen - 1] == '/') {
+            mkdir(zs->outPath, 0755);
+        } else {
+            // Claimed alongside the other writers; sizes deferred to a data descriptor read 0 here, so those
+            // entries are caught by the write instead
+            if (!storage_reserve(zs->outPath, zs->uncompressedSize)) return ZIPSTREAM_NO_SPACE;
+            zs->claimed = zs->uncompressedSize;
+            zipstream_make_parent_dirs(zs->outPath);
+            zs->out = filesink_open(zs->outPath, false, 0);
+            if (!zs->out || !remember_file(zs, zs->outPath)) {
+                close_output(zs);
+                remove(zs->outPath);
+                return ZIPSTREAM_ERROR;
+            }
+            // The preallocated file holds the space now; keeping the claim too would count it twice
+            if (storage_preallocate(zs->out, zs->uncompressedSize)) {
+                storage_release(zs->claimed);
+                zs->claimed = 0;
+            }
+        }
+    }
+
+    if (zs->method == METHOD_DEFLATED) {
+        memset(&zs->inflater, 0, sizeof(zs->inflater));
+        if (inflateInit2(&zs->inflater, -MAX_WBITS) != Z_OK) return ZIPSTREAM_ERROR;
+        zs->inflaterActive = true;
+    }
+    expect(zs, PHASE_DATA, 0);
+    return ZIPSTREAM_OK;
+}
+
+static bool write_output(ZipStream *zs, const uint8_t *data, size_t len) {
+    zs->outCrc = crc32(zs->outCrc, data, len);
+    zs->outSize += len;
+    md5_update(&zs->contentMd5, data, len);
+    if (!zs->out) return true;
+    if (!filesink_write(zs->out, data, len)) return false;
+    zs->written += len;
+    return true;
+}
+
+// Close the entry's file and check it against the expected CRC and size
+static ZipStreamResult finish_entry(ZipStream *zs, uint32_t crc, uint32_t size) {
+    if (!close_output(zs)) return ZIPSTREAM_ERROR;
+    if (crc != zs->outCrc || size != zs->outSize) {
+        log_error("Zip entry failed verification: %s", zs->outPath);
+        return ZIPSTREAM_ERROR;
+    }
+    log_debug("Extracted: %s", zs->outPath);
+    expect(zs, PHASE_HEADER, 4);
+    return ZIPSTREAM_OK;
+}
+
+// The entry's data ended: verify now, or read the data descriptor first
+static ZipStreamResult end_of_data(ZipStream *zs) {
+    if (zs->flags & FLAG_DATA_DESCRIPTOR) {
+        expect(zs, PHASE_DESCRIPTOR, 12);
+        return ZIPSTREAM_OK;
+    }
+    return finish_entry(zs, zs->crc, zs->uncompressedSize);
+}
+
+// Consume entry data. Sets *used to the bytes taken from data.
+static ZipStreamResult feed_data(ZipStream *zs, const uint8_t *data, size_t len, size_t *used) {
+    bool sized = !(zs->flags & FLAG_DATA_DESCRIPTOR);
+    size_t avail = sized && len > zs->remaining ? zs->remaining : len;
+
+    if (zs->method == METHOD_STORED) {
+        if (!write_output(zs, data, avail)) return ZIPSTREAM_ERROR;
+        *used = avail;
+        zs->remaining -= avail;
+        return zs->remaining == 0 ? end_of_data(zs) : ZIPSTREAM_OK;
+    }
+
+    z_stream *strm = &zs->inflater;
+    strm->next_in = (Bytef *)data;
+    strm->avail_in = (uInt)avail;
+    int ret = Z_OK;
+    while (ret == Z_OK) {
+        strm->next_out = zs->outBuf;
+        strm->avail_out = ZIPSTREAM_OUT_SIZE;
+        ret = inflate(strm, Z_NO_FLUSH);
+        if (ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR) {
+            log_error("Zip stream: inflate error %d in %s", ret, zs->outPath);
+            return ZIPSTREAM_ERROR;
+        }
+        if (!write_output(zs, zs->outBuf, ZIPSTREAM_OUT_SIZE - strm->avail_out)) return ZIPSTREAM_ERROR;
+        // Z_BUF_ERROR: all input consumed and no more output possible until the next feed
+        if (ret == Z_OK && strm->avail_in == 0 && strm->avail_out != 0) break;
+    }
+
+    *used = avail - strm->avail_in;
+    if (sized) zs->remaining -= *used;
+    if (ret != Z_STREAM_END) {
+        if (sized && zs->remaining == 0) {
+            log_error("Zip stream: deflate data overruns entry %s", zs->outPath);
+            return ZIPSTREAM_ERROR;
+        }
+        return ZIPSTREAM_OK;
+    }
+
+    inflateEnd(strm);
+    zs->inflaterActive = false;
+    if (sized && zs->remaining != 0) {
+        log_error("Zip stream: compressed size mismatch in %s", zs->outPath);
+        return ZIPSTREAM_ERROR;
+    }
+    return end_of_data(zs);
+}
+
+static ZipStreamResult parse_descriptor(ZipStream *zs) {
+    // The signature is optional: 12 bytes without it, 16 with it
+    if (zs->scratchWant == 12 && read_u32(zs->scratch) == SIG_DATA_DESCRIPTOR) {
+        zs->scratchWant = 16;
+        return ZIPSTREAM_OK;
+    }
+    const uint8_t *d = zs->scratch + (zs->scratchWant == 16 ? 4 : 0);
+    return finish_entry(zs, read_u32(d), read_u32(d + 8));
+}
+
+ZipStreamResult zipstream_feed(ZipStream *zs, const uint8_t *data, size_t len) {
+    while (len > 0 && zs->result == ZIPSTREAM_OK) {
+        size_t used = 0;
+        if (zs->phase == PHASE_DATA) {
+            zs->result = feed_data(zs, data, len, &used);
+        } else {
+            used = collect(zs, data, len);
+            if (zs->scratchLen == zs->scratchWant) {
+                if (zs->phase == PHASE_HEADER) {
+                    zs->result = parse_header(zs);
+                } else if (zs->phase == PHASE_META) {
+                    zs->result = start_entry(zs);
+                } else {
+                    zs->result = parse_descriptor(zs);
+                }
+            }
+        }
+        data += used;
+        len -= used;
+
+        // Empty entries have no data to trigger the data phase
+        if (zs->result == ZIPSTREAM_OK && zs->phase == PHASE_DATA && zs->method == METHOD_STORED &&
+            zs->remaining == 0) {
+            zs->result = end_of_data(zs);
+        }
+    }
+    return zs->result;
+}
+
+ZipStreamResult zipstream_finish(ZipStream *zs) {
+    if (zs->result == ZIPSTREAM_OK) {
+        log_error("Zip stream: archive truncated");
+        zs->result = ZIPSTREAM_ERROR;
+    }
+    return zs->result;
+}
+
+uint32_t zipstream_bytes_written(const ZipStream *zs) {
+    return zs->written;
+}
+
+void zipstream_content_md5(ZipStream *zs, char out[MD5_HEX_LEN]) {
+    md5_final_hex(&zs->contentMd5, out);
+}
+
+void zipstream_close(ZipStream *zs, bool keepFiles) {
+    if (!zs) return;
+    if (zs->inflaterActive) inflateEnd(&zs->inflater);
+    close_output(zs);
+    for (int i = 0; i < zs->createdCount; i++) {
+        if (!keepFiles) remove(zs->created[i]);
+        free(zs->created[i]);
+    }
+    free(zs->created);
+    free(zs->outBuf);
+    free(zs);
+}
@@ -0,0 +1,56 @@
+/*
+ * Zip stream module - Extract a zip archive as it arrives, without the central directory
+ *
+ * Walks the local file headers in order and inflates each entry straight to
+ * its destination, so a downloaded archive never has to be stored and re-read.
+ * Archives whose entries can only be delimited with the central directory
+ * (stored entries with data descriptors, zip64, encryption, other methods)
+ * are reported as unsupported so the caller can fall back to zip_extract().
+ */
+
+#ifndef ZIPSTREAM_H
+#define ZIPSTREAM_H
+
+#include "md5.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum {
+    ZIPSTREAM_OK,          // Need more data
+    ZIPSTREAM_DONE,        // Reached the central directory; every entry was extracted and verified
+    ZIPSTREAM_UNSUPPORTED, // Needs the central directory; use zip_extract() on the whole file
+    ZIPSTREAM_ERROR,       // Corrupt data, CRC mismatch or write failure
+    ZIPSTREAM_NO_SPACE,    // An entry is larger than the free space left on the card
+} ZipStreamResult;
+
+typedef struct ZipStream ZipStream;
+
+// Start extracting into destDir. Returns NULL if out of memory.
+ZipStream *zipstream_open(const char *destDir);
+
+// Feed the next bytes of the archive. Once a result other than ZIPSTREAM_OK is returned,
+// further data is ignored and the same result is returned again.
+ZipStreamResult zipstream_feed(ZipStream *zs, const uint8_t *data, size_t len);
+
+// Signal end of input. Returns ZIPSTREAM_DONE only for a complete archive.
+ZipStreamResult zipstream_finish(ZipStream *zs);
+
+// Uncompressed bytes written so far
+uint32_t zipstream_bytes_written(const ZipStream *zs);
+
+// MD5 of every entry's uncompressed data concatenated in archive order, as RomM hashes archives.
+// Call once, after zipstream_finish() returned ZIPSTREAM_DONE.
+void zipstream_content_md5(ZipStream *zs, char out[MD5_HEX_LEN]);
+
+// Free the stream. Unless keepFiles is set, files it created are deleted.
+void zipstream_close(ZipStream *zs, bool keepFiles);
+
+// Build destDir/name for an archive entry, shared with zip_extract(). Returns false (and logs)
+// if the entry must be skipped: the path is too long or escapes destDir.
+bool zipstream_entry_path(const char *destDir, const char *name, char *out, size_t outSize);
+
+// Create every missing directory leading up to filePath
+void zipstream_make_parent_dirs(const char *filePath);
+
+#endif // ZIPSTREAM_H